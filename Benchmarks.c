@@ -0,0 +1,491 @@
+/**
+ * @file Benchmarks.c
+ * @author Joey Hughes
+ * This is the benchmark suite that GreyCodeChimera.c runs with --benchmark. SearchBenchmark.c and KernelBenchmark.c
+ * time copies of the loops, but these run the real search and extrapolation from GreyCodeChimera.c, just on small fixed
+ * slices of the work, so this gets included into it right before main, after everything it uses. The slices are:
+ *   search: every task that starts with the first BENCHMARK_PREFIX_STEPS steps of the lowest code, with one worker and
+ *     no extrapolation. It's timed in seeds a second, which is the same for both engines, and nodes a second, which
+ *     isn't, since the bitset engine counts its forced steps as one node (see SearchStats).
+ *   extrapolate: the first BENCHMARK_SEEDS seeds from 5DigitSeedsAndTheirGroupSize.txt (or --benchmark-seeds PATH),
+ *     all four ways, hashing, hashing least rotations, stabilizer counting, and signature relabelings, in seeds a
+ *     second. The group sizes in the file are how many codes each seed makes, so the totals are checked against them.
+ *   key-table and seq-table: the inserts and contains of the extrapolation's KeyHashTable and the duplicate check's
+ *     SeqHashTable, on random sequences, in operations a second.
+ *   isLower and swapMasks: the kernels from SequenceKernels.c, whichever versions this is compiled with, in calls a second.
+ * Each one is run BENCHMARK_REPEATS times and the fastest is kept, since the slower ones are just the machine being busy.
+ * Each run goes through its slice over and over until it's taken at least BENCHMARK_MIN_SECONDS, and the time is divided
+ * by how many times that was. Otherwise a tiny slice, like the whole 4 digit search, is over in microseconds and its rate
+ * is mostly timer noise, which a baseline comparison would call a regression.
+ *
+ * --benchmark-save PATH writes the rates to PATH, one "name rate" line each, and --benchmark-baseline PATH compares the
+ * rates to a file like that and says how much faster or slower each one is. If any of them are slower by more than
+ * BENCHMARK_TOLERANCE, it says so and exits with a failure, so a change that makes something slower gets caught.
+ * The rates only mean anything against a baseline from the same machine and the same NUM_DIGITS.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <pthread.h>
+
+
+/** How many steps of the lowest code the search slice has set. Can be set in compilation with -DBENCHMARK_PREFIX_STEPS=X. */
+#ifndef BENCHMARK_PREFIX_STEPS
+#if NUM_DIGITS <= 4
+#define BENCHMARK_PREFIX_STEPS 1
+#elif NUM_DIGITS == 5
+#define BENCHMARK_PREFIX_STEPS 8
+#else
+#define BENCHMARK_PREFIX_STEPS 40
+#endif
+#endif
+
+/** How many seeds the extrapolation slice goes through. Can be set in compilation with -DBENCHMARK_SEEDS=X. */
+#ifndef BENCHMARK_SEEDS
+#define BENCHMARK_SEEDS 20000
+#endif
+
+/** The seed file the extrapolation slice reads, if not given with --benchmark-seeds. */
+#define DEFAULT_BENCHMARK_SEED_PATH "5DigitSeedsAndTheirGroupSize.txt"
+
+/** How many random sequences go in the tables. */
+#define BENCHMARK_TABLE_KEYS (1 << 18)
+
+/** How many times the key table and kernel benchmarks go through all their sequences, so they take long enough to time. */
+#define BENCHMARK_PASSES 16
+
+/** How many times each benchmark is run. Can be set in compilation with -DBENCHMARK_REPEATS=X. */
+#ifndef BENCHMARK_REPEATS
+#define BENCHMARK_REPEATS 3
+#endif
+
+/** How long each run of a benchmark has to take at least, in seconds. Can be set in compilation with -DBENCHMARK_MIN_SECONDS=X. */
+#ifndef BENCHMARK_MIN_SECONDS
+#define BENCHMARK_MIN_SECONDS 0.2
+#endif
+
+/** How much slower than the baseline a rate can be before it counts as a regression. Can be set in compilation with -DBENCHMARK_TOLERANCE=X. */
+#ifndef BENCHMARK_TOLERANCE
+#define BENCHMARK_TOLERANCE 0.10
+#endif
+
+/** The most benchmarks there can be results for. */
+#define MAX_BENCHMARKS 16
+
+
+/** The result of one benchmark. */
+typedef struct {
+    /** The name it's saved and compared under. */
+    const char *name;
+    /** What the rate is of, for printing. */
+    const char *unit;
+    /** How many of the unit a second. */
+    double rate;
+} BenchmarkResult;
+
+/** All the results of a run of the suite. */
+typedef struct {
+    /** The results, in the order they were run. */
+    BenchmarkResult results[MAX_BENCHMARKS];
+    /** How many there are. */
+    int count;
+} BenchmarkResults;
+
+/** Adds up the results of the kernels so the compiler can't throw the work away. */
+volatile unsigned long long benchmarkSink;
+
+
+
+/**
+ * (Benchmark) Adds a result, and prints it.
+ * @param results The results to add to.
+ * @param name The name of the benchmark.
+ * @param unit What the rate is of.
+ * @param amount How much of the unit got done.
+ * @param seconds How long the fastest run took, per pass through the slice.
+*/
+void addBenchmarkResult(BenchmarkResults *results, const char *name, const char *unit, double amount, double seconds)
+{
+    BenchmarkResult *result = results->results + results->count++;
+    result->name = name;
+    result->unit = unit;
+    result->rate = amount / seconds;
+    printf(" ---- %-24s %14.3f M %s/s  (%.0f in %f seconds a pass)\n", name, result->rate / 1e6, unit, amount, seconds);
+}
+
+
+
+/**
+ * (Benchmark) Runs the search slice, with one worker on every task that starts with the first BENCHMARK_PREFIX_STEPS
+ * steps of the lowest code. With the default task depth, those tasks are exactly the codes with that prefix.
+ * @param tasks All the tasks.
+ * @param numTasks How many tasks there are.
+ * @param results Where the results go.
+*/
+void benchmarkSearch(CodeSearchTask *tasks, size_t numTasks, BenchmarkResults *results)
+{
+    double bestSeconds = 0;
+    unsigned long long seeds = 0, nodes = 0;
+    int numSliceTasks = 0;
+    for(int r = 0; r < BENCHMARK_REPEATS; r++) {
+        CodeSearchWorker worker;
+        memset(&worker, 0, sizeof(worker));
+        worker.seedArena = createSeedArena(0);
+        worker.batch = acquireSeedBatch(worker.seedArena);
+
+        double start = getWallSeconds(), seconds;
+        int passes = 0;
+        do {
+            numSliceTasks = 0;
+            for(size_t t = 0; t < numTasks; t++) {
+                int i, prefixSteps = tasks[t].numSetSteps < BENCHMARK_PREFIX_STEPS ? tasks[t].numSetSteps : BENCHMARK_PREFIX_STEPS;
+                for(i = 0; i < prefixSteps && tasks[t].setSteps[i] == lowest[i]; i++);
+                if(i < prefixSteps) continue;
+                calculateCodesWithSetStart(&worker, tasks + t, NULL);
+                numSliceTasks++;
+            }
+            passes++;
+        } while((seconds = getWallSeconds() - start) < BENCHMARK_MIN_SECONDS);
+        seconds /= passes;
+
+        if(r == 0 || seconds < bestSeconds) bestSeconds = seconds;
+        seeds = worker.count / passes;
+        nodes = worker.stats.nodes / passes;
+        freeSeedArena(worker.seedArena);
+    }
+    printf(" ------- The search slice is %d tasks with %llu seeds.\n", numSliceTasks, seeds);
+    addBenchmarkResult(results, "search-seeds", "seeds", seeds, bestSeconds);
+    addBenchmarkResult(results, "search-nodes", "nodes", nodes, bestSeconds);
+}
+
+
+
+/**
+ * (Benchmark) Runs the extrapolation slice one way, with one extrapolation thread taking the seeds out of them like a
+ * seed file, the same as Verify.c. The queue is closed before it starts, so it's only the extrapolation being timed
+ * and nothing waits on the queue, however many batches the seeds would take up.
+ * @param seeds The seeds, like a mapped seed file.
+ * @param mode Which way to extrapolate.
+ * @param permutations The table of all n! relabelings.
+ * @param multiplesTable The multiples lookup table, if the extrapolation uses GMP.
+ * @param numGreyCodes Where the number of codes the seeds made goes.
+ * @return How long the fastest run took, per pass through the seeds.
+*/
+double benchmarkExtrapolation(const MappedSeedFile *seeds, ExtrapolationMode mode, const PermutationTable *permutations,
+                              void *multiplesTable, unsigned long long *numGreyCodes)
+{
+    double bestSeconds = 0;
+    SeedQueue *seedQueue = createSeedQueue(1);
+    closeSeedQueue(seedQueue);
+    for(int r = 0; r < BENCHMARK_REPEATS; r++) {
+        double seconds = 0;
+        int passes = 0;
+        do {
+            uint64_t fileCursor = 0;
+            ExtrapolateThreadStruct thread;
+            memset(&thread, 0, sizeof(thread));
+            thread.mode = mode;
+            thread.seedQueue = seedQueue;
+            thread.seedFile = seeds;
+            thread.fileCursor = &fileCursor;
+            thread.fileBatchSize = DEFAULT_EXTRAPOLATE_BATCH;
+            thread.permutations = permutations;
+            thread.quiet = true;
+            #ifndef FIXED_WIDTH_KEYS
+            thread.multiplesTablePointer = (mpz_t *)multiplesTable;
+            #endif
+            pthread_t threadId;
+            pthread_create(&threadId, NULL, &extrapolateSeeds, (void *)&thread);
+            pthread_join(threadId, NULL);
+            seconds += thread.seconds;
+            passes++;
+            *numGreyCodes = thread.numGreyCodes;
+        } while(seconds < BENCHMARK_MIN_SECONDS);
+        seconds /= passes;
+
+        if(r == 0 || seconds < bestSeconds) bestSeconds = seconds;
+    }
+    freeSeedQueue(seedQueue);
+    return bestSeconds;
+}
+
+
+
+/**
+ * (Benchmark) Runs the table benchmarks on random sequences. The KeyHashTable one does the same mix as the extrapolation,
+ * emptying the table, then for n! sequences looking each one up a few times and inserting it. The SeqHashTable one
+ * inserts all of them, half twice, and then looks all of them up.
+ * @param results Where the results go.
+*/
+void benchmarkTables(BenchmarkResults *results)
+{
+    packedSequence *keys = (packedSequence *)malloc(sizeof(packedSequence) * BENCHMARK_TABLE_KEYS);
+    step seq[len];
+    srand(12345);
+    for(int k = 0; k < BENCHMARK_TABLE_KEYS; k++) {
+        for(int i = 0; i < len; i++) seq[i] = rand() % NUM_DIGITS;
+        packSequence(seq, keys[k]);
+    }
+
+    #ifdef FIXED_WIDTH_KEYS
+    // The key table, the size the extrapolation makes it
+    sequenceKey *sequenceKeys = (sequenceKey *)malloc(sizeof(sequenceKey) * BENCHMARK_TABLE_KEYS);
+    for(int k = 0; k < BENCHMARK_TABLE_KEYS; k++)
+        getPackedSequenceKey(keys[k], sequenceKeys + k);
+    KeyHashTable *keyTable = createKeyTable(queueSize * 2);
+    double bestSeconds = 0, operations = 0;
+    unsigned long long found = 0;
+    for(int r = 0; r < BENCHMARK_REPEATS; r++) {
+        double start = getWallSeconds(), seconds;
+        int passes = 0;
+        do {
+            operations = 0;
+            for(int pass = 0; pass < BENCHMARK_PASSES; pass++) {
+                for(int first = 0; first + (int)queueSize <= BENCHMARK_TABLE_KEYS; first += queueSize) {
+                    emptyKeyTable(keyTable);
+                    for(int k = first; k < first + (int)queueSize; k++) {
+                        // A few rotations get looked up for every permutation, and the table has the earlier ones in it
+                        found += keyHashContains(keyTable, sequenceKeys[k]);
+                        found += keyHashContains(keyTable, sequenceKeys[first + (k - first) / 2]);
+                        found += keyHashContains(keyTable, sequenceKeys[k ^ 1]);
+                        keyHashInsert(keyTable, sequenceKeys[k]);
+                    }
+                    operations += queueSize * 4;
+                }
+            }
+            passes++;
+        } while((seconds = getWallSeconds() - start) < BENCHMARK_MIN_SECONDS);
+        seconds /= passes;
+        if(r == 0 || seconds < bestSeconds) bestSeconds = seconds;
+    }
+    benchmarkSink += found;
+    addBenchmarkResult(results, "key-table", "operations", operations, bestSeconds);
+    freeKeyTable(keyTable);
+    free(sequenceKeys);
+    #endif
+
+    // The shared table from --check-duplicates, started small like there
+    double bestSeqSeconds = 0;
+    unsigned long long added = 0;
+    for(int r = 0; r < BENCHMARK_REPEATS; r++) {
+        double start = getWallSeconds(), seconds;
+        int passes = 0;
+        do {
+            SeqHashTable *seqTable = createSeqTable(12);
+            for(int k = 0; k < BENCHMARK_TABLE_KEYS; k++) {
+                added += seqHashInsertIfNotContains(seqTable, keys[k]);
+                added += seqHashInsertIfNotContains(seqTable, keys[k / 2]);
+            }
+            for(int k = 0; k < BENCHMARK_TABLE_KEYS; k++)
+                added += seqHashContains(seqTable, keys[k]);
+            freeSeqTable(seqTable);
+            passes++;
+        } while((seconds = getWallSeconds() - start) < BENCHMARK_MIN_SECONDS);
+        seconds /= passes;
+        if(r == 0 || seconds < bestSeqSeconds) bestSeqSeconds = seconds;
+    }
+    benchmarkSink += added;
+    addBenchmarkResult(results, "seq-table", "operations", 3.0 * BENCHMARK_TABLE_KEYS, bestSeqSeconds);
+    free(keys);
+}
+
+
+
+/**
+ * (Benchmark) Runs the kernel benchmarks, on random sequences like KernelBenchmark.c, but only the versions this is
+ * compiled with.
+ * @param results Where the results go.
+*/
+void benchmarkKernels(BenchmarkResults *results)
+{
+    const int numSequences = 1024, rounds = BENCHMARK_PASSES * 1024;
+    stepMask (*masks)[len * 2] = malloc(sizeof(stepMask) * len * 2 * numSequences);
+    stepMask (*others)[len] = malloc(sizeof(stepMask) * len * numSequences);
+    step swapsA[numSequences], swapsB[numSequences];
+    srand(12345);
+    for(int s = 0; s < numSequences; s++) {
+        for(int i = 0; i < len * 2; i++) masks[s][i] = 1 << (rand() % NUM_DIGITS);
+        // The others match for a random stretch first, since that's the case isLower has to loop for
+        int same = rand() % len;
+        for(int i = 0; i < len; i++) others[s][i] = i < same ? masks[s][i] : (stepMask)(1 << (rand() % NUM_DIGITS));
+        swapsA[s] = rand() % NUM_DIGITS;
+        swapsB[s] = rand() % NUM_DIGITS;
+    }
+    double calls = (double)rounds * numSequences;
+
+    double bestSeconds = 0;
+    unsigned long long lowerCount = 0;
+    for(int r = 0; r < BENCHMARK_REPEATS; r++) {
+        double start = getWallSeconds(), seconds;
+        int passes = 0;
+        do {
+            for(int round = 0; round < rounds; round++)
+                for(int s = 0; s < numSequences; s++)
+                    lowerCount += isLower(masks[s], others[s]);
+            passes++;
+        } while((seconds = getWallSeconds() - start) < BENCHMARK_MIN_SECONDS);
+        seconds /= passes;
+        if(r == 0 || seconds < bestSeconds) bestSeconds = seconds;
+    }
+    benchmarkSink += lowerCount;
+    addBenchmarkResult(results, "isLower", "calls", calls, bestSeconds);
+
+    for(int r = 0; r < BENCHMARK_REPEATS; r++) {
+        double start = getWallSeconds(), seconds;
+        int passes = 0;
+        do {
+            for(int round = 0; round < rounds; round++)
+                for(int s = 0; s < numSequences; s++)
+                    swapMasks(masks[s], 1 << swapsA[s], 1 << swapsB[s], len * 2);
+            passes++;
+        } while((seconds = getWallSeconds() - start) < BENCHMARK_MIN_SECONDS);
+        seconds /= passes;
+        if(r == 0 || seconds < bestSeconds) bestSeconds = seconds;
+    }
+    benchmarkSink += masks[0][0];
+    addBenchmarkResult(results, "swapMasks", "calls", calls, bestSeconds);
+
+    free(masks);
+    free(others);
+}
+
+
+
+/**
+ * (Benchmark) Compares the results to a baseline file of "name rate" lines, and prints how each one did.
+ * @param results The results.
+ * @param path The baseline file.
+ * @return How many of the results got slower than the baseline by more than BENCHMARK_TOLERANCE, or -1 if the
+ *         baseline can't be read.
+*/
+int compareBenchmarkBaseline(const BenchmarkResults *results, const char *path)
+{
+    FILE *file = fopen(path, "r");
+    if(file == NULL) {
+        perror(path);
+        return -1;
+    }
+    double baseline[MAX_BENCHMARKS];
+    for(int b = 0; b < results->count; b++) baseline[b] = -1;
+    char line[256], name[128];
+    double rate;
+    while(fgets(line, sizeof(line), file) != NULL) {
+        if(line[0] == '#' || sscanf(line, "%127s %lf", name, &rate) != 2) continue;
+        for(int b = 0; b < results->count; b++)
+            if(strcmp(name, results->results[b].name) == 0) baseline[b] = rate;
+    }
+    fclose(file);
+
+    int regressions = 0;
+    printf("\n ------- Compared to %s:\n", path);
+    for(int b = 0; b < results->count; b++) {
+        if(baseline[b] <= 0) {
+            printf(" ---- %-24s not in the baseline\n", results->results[b].name);
+            continue;
+        }
+        double ratio = results->results[b].rate / baseline[b];
+        bool regressed = ratio < 1 - BENCHMARK_TOLERANCE;
+        regressions += regressed;
+        printf(" ---- %-24s %6.3fx %s\n", results->results[b].name, ratio, regressed ? "\e[31mslower\e[0m" : "");
+    }
+    return regressions;
+}
+
+
+
+/**
+ * (Benchmark) Writes the results to a file of "name rate" lines that can be used as a baseline later.
+ * @param results The results.
+ * @param path Where to write them.
+ * @return True if they were written.
+*/
+bool saveBenchmarkResults(const BenchmarkResults *results, const char *path)
+{
+    FILE *file = fopen(path, "w");
+    if(file == NULL) {
+        perror(path);
+        return false;
+    }
+    fprintf(file, "# GreyCodeChimera --benchmark, %d digits, %s search, %d repeats\n", NUM_DIGITS,
+        #ifdef BITSET_SEARCH
+        "bitset",
+        #else
+        "flags",
+        #endif
+        BENCHMARK_REPEATS);
+    for(int b = 0; b < results->count; b++)
+        fprintf(file, "%s %f\n", results->results[b].name, results->results[b].rate);
+    fclose(file);
+    return true;
+}
+
+
+
+/**
+ * (Benchmark) Runs the whole suite, then saves the results and compares them to a baseline, if asked.
+ * @param tasks All the search tasks.
+ * @param numTasks How many tasks there are.
+ * @param permutations The table of all n! relabelings.
+ * @param multiplesTable The multiples lookup table, if the extrapolation uses GMP, or NULL.
+ * @param seedPath The text file of seeds and group sizes for the extrapolation slice.
+ * @param savePath Where to save the results, or NULL.
+ * @param baselinePath The baseline to compare to, or NULL.
+ * @return True if everything worked and nothing got slower than the baseline.
+*/
+bool runBenchmarks(CodeSearchTask *tasks, size_t numTasks, const PermutationTable *permutations, void *multiplesTable,
+                   const char *seedPath, const char *savePath, const char *baselinePath)
+{
+    BenchmarkResults results;
+    results.count = 0;
+    printf(" ------- Benchmarking the %s search and the extrapolation, the fastest of %d runs each...\n\n",
+        #ifdef BITSET_SEARCH
+        "bitset",
+        #else
+        "flags",
+        #endif
+        BENCHMARK_REPEATS);
+
+    benchmarkSearch(tasks, numTasks, &results);
+
+    // Both ways of extrapolating, if there are seeds for this many digits
+    SeedTextFile seedText;
+    bool ok = true;
+    bool haveSeeds = readSeedTextFile(seedPath, BENCHMARK_SEEDS, &seedText);
+    if(haveSeeds && seedText.file.count == 0) {
+        freeSeedTextFile(&seedText);
+        haveSeeds = false;
+    }
+    if(haveSeeds) {
+        int numSeeds = (int)seedText.file.count;
+        unsigned long long totalCodes = seedText.totalCodes;
+        const ExtrapolationMode modes[4] = {EXTRAPOLATE_HASHING, EXTRAPOLATE_CANONICAL, EXTRAPOLATE_STABILIZER, EXTRAPOLATE_SIGNATURE};
+        const char *names[4] = {"extrapolate-hashing", "extrapolate-canonical", "extrapolate-stabilizer", "extrapolate-signature"};
+        for(int m = 0; m < 4; m++) {
+            unsigned long long numGreyCodes;
+            double seconds = benchmarkExtrapolation(&(seedText.file), modes[m], permutations, multiplesTable, &numGreyCodes);
+            if(numGreyCodes != totalCodes) {
+                printf(" ---- \e[31m%s made %llu codes from the first %d seeds in %s, but it should be %llu!\e[0m\n",
+                    names[m], numGreyCodes, numSeeds, seedPath, totalCodes);
+                ok = false;
+            }
+            addBenchmarkResult(&results, names[m], "seeds", numSeeds, seconds);
+        }
+        freeSeedTextFile(&seedText);
+    } else
+        printf(" ---- Skipping the extrapolation, %s isn't a file of %d digit seeds.\n", seedPath, NUM_DIGITS);
+
+    benchmarkTables(&results);
+    benchmarkKernels(&results);
+
+    if(savePath != NULL && saveBenchmarkResults(&results, savePath))
+        printf("\n ------- Saved the results to %s.\n", savePath);
+    if(baselinePath != NULL) {
+        int regressions = compareBenchmarkBaseline(&results, baselinePath);
+        if(regressions > 0)
+            printf("\n ------- \e[31m%d of them got slower by more than %.0f%%!\e[0m\n", regressions, BENCHMARK_TOLERANCE * 100);
+        ok = ok && regressions == 0;
+    }
+    return ok;
+}
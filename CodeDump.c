@@ -0,0 +1,289 @@
+/**
+ * @file CodeDump.c
+ * @author Joey Hughes
+ * This is the code dump for GreyCodeChimera.c, for getting raw files of codes out of the search for analysis, like
+ * the XDigits_Y.bin files that Old/main.c used to make. With --dump-codes PATH every whole code the search reaches gets
+ * written out, and with --dump-seeds PATH just the seeds. Each search worker has its own CodeDump writing to its own
+ * file, PATH.N for worker N, so the workers never wait on each other.
+ * By default each code is len bytes, one digit number per step, the same as Old/main.c, so Old/SeedSearch2.c and the
+ * like can read them. --dump-packed writes them as packedSequences instead, the same as the seeds in a seed file.
+ * A dump has two big aligned blocks. The worker fills one while a writer thread writes the other out (compressing it
+ * first with --dump-compress), so all the search does per code is copy it into memory. It only waits if it fills a
+ * whole block before the writer is done with the last one.
+ * Keep in mind that the search skips partial codes once they have a lower rotation, so "every code" is every code that
+ * gets past that, not every grey code there is. --dump-prefix picks which prefix of codes get dumped.
+*/
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#ifdef CODE_DUMP_ZLIB
+    #include <zlib.h>
+#endif
+
+#ifndef GREY_CODE_TYPES_DEFINED
+    #include "GreyCodeTypes.h"
+#endif
+#include "PackedSequence.c"
+
+
+/** How many bytes each block of a dump is. Can be set in compilation with -DCODE_DUMP_BLOCK_SIZE=X. */
+#ifndef CODE_DUMP_BLOCK_SIZE
+#define CODE_DUMP_BLOCK_SIZE (4 << 20)
+#endif
+
+/** What the blocks are aligned to, a page. */
+#define CODE_DUMP_ALIGNMENT 4096
+
+
+/** How a dump is set up. The same for every worker's dump. */
+typedef struct {
+    /** Where to write the dumps. Each worker adds .N to it. */
+    const char *path;
+    /** Whether to only dump the seeds, instead of every code. */
+    bool seedsOnly;
+    /** Whether to write the codes as packedSequences instead of a byte per step. */
+    bool packed;
+    /** Whether to compress the dumps with zlib, into gzip files. Needs -DCODE_DUMP_ZLIB. */
+    bool compress;
+    /** The steps, as stepMasks, that a code has to start with to get dumped. */
+    stepMask prefix[len];
+    /** How many steps are in the prefix, 0 for every code. */
+    int prefixLen;
+} CodeDumpOptions;
+
+/** One worker's dump. */
+typedef struct {
+    /** How it's set up. */
+    const CodeDumpOptions *options;
+    /** The file's path, for the error messages. */
+    char *path;
+    /** The file being written. */
+    int fd;
+    /** How many bytes each code takes up. */
+    size_t recordSize;
+    /** How many bytes of each block get used, a whole number of codes. */
+    size_t blockUse;
+    /** The two blocks. */
+    unsigned char *blocks[2];
+    /** Which block the worker is filling. */
+    int current;
+    /** How many bytes of the current block are filled. */
+    size_t fill;
+    /** The block handed to the writer, or NULL if it's done with it. */
+    unsigned char *pending;
+    /** How many bytes of the pending block to write. */
+    size_t pendingSize;
+    /** Lock for pending and closing. */
+    pthread_mutex_t lock;
+    /** Signaled when a block is handed to the writer, when the writer is done with one, and when closing. */
+    pthread_cond_t changed;
+    /** Set once there are no more blocks coming. */
+    bool closing;
+    /** The writer thread. */
+    pthread_t writer;
+    /** How many codes have been dumped. */
+    unsigned long long numCodes;
+    /** Whether writing has failed, so it doesn't keep complaining. */
+    bool failed;
+    #ifdef CODE_DUMP_ZLIB
+    /** The compressor, when compressing. */
+    z_stream zlib;
+    /** Where the compressed bytes go before they're written, one block long. */
+    unsigned char *compressed;
+    #endif
+} CodeDump;
+
+
+
+/**
+ * Writes all of some bytes to the dump's file.
+ * @param dump The dump.
+ * @param bytes The bytes.
+ * @param size How many.
+*/
+static void writeCodeDumpBytes(CodeDump *dump, const unsigned char *bytes, size_t size)
+{
+    while(size && !dump->failed) {
+        ssize_t written = write(dump->fd, bytes, size);
+        if(written <= 0) {
+            perror(dump->path);
+            dump->failed = true;
+            break;
+        }
+        bytes += written;
+        size -= written;
+    }
+}
+
+
+
+#ifdef CODE_DUMP_ZLIB
+/**
+ * Compresses some bytes into the dump's gzip stream and writes out whatever comes out.
+ * @param dump The dump.
+ * @param bytes The bytes, or NULL to finish the stream.
+ * @param size How many.
+*/
+static void compressCodeDumpBytes(CodeDump *dump, const unsigned char *bytes, size_t size)
+{
+    int flush = bytes != NULL ? Z_NO_FLUSH : Z_FINISH;
+    dump->zlib.next_in = (Bytef *)bytes;
+    dump->zlib.avail_in = (uInt)size;
+    do {
+        dump->zlib.next_out = dump->compressed;
+        dump->zlib.avail_out = CODE_DUMP_BLOCK_SIZE;
+        deflate(&(dump->zlib), flush);
+        writeCodeDumpBytes(dump, dump->compressed, CODE_DUMP_BLOCK_SIZE - dump->zlib.avail_out);
+    } while(dump->zlib.avail_out == 0);
+}
+#endif
+
+
+
+/**
+ * The writer thread of a dump. Waits for a block, writes it out, and says it's done with it, until the dump is closed.
+ * @param context The CodeDump.
+ * @return Nothing, but a void * return type is necessary to make the thread.
+*/
+static void *writeCodeDump(void *context)
+{
+    CodeDump *dump = (CodeDump *)context;
+    pthread_mutex_lock(&(dump->lock));
+    while(true) {
+        while(dump->pending == NULL && !dump->closing)
+            pthread_cond_wait(&(dump->changed), &(dump->lock));
+        if(dump->pending == NULL) break;
+        pthread_mutex_unlock(&(dump->lock));
+
+        #ifdef CODE_DUMP_ZLIB
+        if(dump->options->compress) compressCodeDumpBytes(dump, dump->pending, dump->pendingSize);
+        else
+        #endif
+        writeCodeDumpBytes(dump, dump->pending, dump->pendingSize);
+
+        pthread_mutex_lock(&(dump->lock));
+        dump->pending = NULL;
+        pthread_cond_broadcast(&(dump->changed));
+    }
+    pthread_mutex_unlock(&(dump->lock));
+    return NULL;
+}
+
+
+
+/**
+ * Opens a worker's dump and starts its writer.
+ * @param options How it's set up.
+ * @param workerIndex Which worker it's for, added onto the path.
+ * @return Pointer to the new CodeDump, or NULL if the file couldn't be made.
+*/
+CodeDump *openCodeDump(const CodeDumpOptions *options, int workerIndex)
+{
+    CodeDump *dump = (CodeDump *)calloc(1, sizeof(CodeDump));
+    dump->options = options;
+    dump->path = (char *)malloc(strlen(options->path) + 16);
+    sprintf(dump->path, "%s.%d", options->path, workerIndex);
+    if((dump->fd = open(dump->path, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0) {
+        perror(dump->path);
+        free(dump->path);
+        free(dump);
+        return NULL;
+    }
+
+    dump->recordSize = options->packed ? PACKED_SEQUENCE_BYTES : len;
+    dump->blockUse = CODE_DUMP_BLOCK_SIZE - (CODE_DUMP_BLOCK_SIZE % dump->recordSize);
+    for(int b = 0; b < 2; b++)
+        if(posix_memalign((void **)(dump->blocks + b), CODE_DUMP_ALIGNMENT, CODE_DUMP_BLOCK_SIZE) != 0)
+            dump->blocks[b] = (unsigned char *)malloc(CODE_DUMP_BLOCK_SIZE);
+    #ifdef CODE_DUMP_ZLIB
+    if(options->compress) {
+        deflateInit2(&(dump->zlib), Z_BEST_SPEED, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY); // + 16 for a gzip header
+        dump->compressed = (unsigned char *)malloc(CODE_DUMP_BLOCK_SIZE);
+    }
+    #endif
+    pthread_mutex_init(&(dump->lock), NULL);
+    pthread_cond_init(&(dump->changed), NULL);
+    pthread_create(&(dump->writer), NULL, &writeCodeDump, (void *)dump);
+    return dump;
+}
+
+
+
+/**
+ * Hands the block being filled to the writer, waiting if it isn't done with the other one yet, and starts on the other.
+ * @param dump The dump.
+*/
+static void swapCodeDumpBlocks(CodeDump *dump)
+{
+    pthread_mutex_lock(&(dump->lock));
+    while(dump->pending != NULL)
+        pthread_cond_wait(&(dump->changed), &(dump->lock));
+    dump->pending = dump->blocks[dump->current];
+    dump->pendingSize = dump->fill;
+    pthread_cond_broadcast(&(dump->changed));
+    pthread_mutex_unlock(&(dump->lock));
+    dump->current ^= 1;
+    dump->fill = 0;
+}
+
+
+
+/**
+ * Dumps a code the search reached, if it has the prefix.
+ * @param dump The worker's dump.
+ * @param test The code, as stepMasks.
+*/
+static inline void appendCodeDump(CodeDump *dump, const stepMask *test)
+{
+    const CodeDumpOptions *options = dump->options;
+    if(options->prefixLen && memcmp(test, options->prefix, sizeof(stepMask) * options->prefixLen) != 0) return;
+
+    if(dump->fill + dump->recordSize > dump->blockUse) swapCodeDumpBlocks(dump);
+    unsigned char *record = dump->blocks[dump->current] + dump->fill;
+    if(options->packed)
+        packStepMasks(test, record);
+    else
+        for(int j = 0; j < len; j++) record[j] = (unsigned char)__builtin_ctz(test[j]);
+    dump->fill += dump->recordSize;
+    dump->numCodes++;
+}
+
+
+
+/**
+ * Writes out the rest of a dump, stops its writer, and closes and frees it.
+ * @param dump The dump to close.
+ * @return How many codes were dumped to it.
+*/
+unsigned long long closeCodeDump(CodeDump *dump)
+{
+    if(dump->fill) swapCodeDumpBlocks(dump);
+    pthread_mutex_lock(&(dump->lock));
+    dump->closing = true;
+    pthread_cond_broadcast(&(dump->changed));
+    pthread_mutex_unlock(&(dump->lock));
+    pthread_join(dump->writer, NULL);
+
+    #ifdef CODE_DUMP_ZLIB
+    if(dump->options->compress) {
+        compressCodeDumpBytes(dump, NULL, 0);
+        deflateEnd(&(dump->zlib));
+        free(dump->compressed);
+    }
+    #endif
+    if(close(dump->fd) != 0) perror(dump->path);
+
+    unsigned long long numCodes = dump->numCodes;
+    pthread_mutex_destroy(&(dump->lock));
+    pthread_cond_destroy(&(dump->changed));
+    free(dump->blocks[0]);
+    free(dump->blocks[1]);
+    free(dump->path);
+    free(dump);
+    return numCodes;
+}
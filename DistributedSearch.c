@@ -0,0 +1,497 @@
+/**
+ * @file DistributedSearch.c
+ * @author Joey Hughes
+ * This is the code for splitting the code search across a bunch of machines over plain TCP for GreyCodeChimera.c. One
+ * machine runs as the coordinator, which never searches anything itself, and the rest run as workers. The work units
+ * are ranges of the search tasks, which are the same on every machine as long as they were all compiled the same way.
+ * Each worker asks for a unit, searches and extrapolates it locally with all its cores, and sends back how many seeds
+ * and codes it got, then gets another one. The coordinator just adds up the results.
+ * If a worker's connection drops, whatever unit it had goes back to be handed out again. If a unit has been out longer
+ * than the unit timeout, it can also be handed out again to a worker with nothing to do, in case the machine it's on
+ * is stuck, and whichever result comes back first is kept.
+ * Every message is the same size, a DistributedMessage of 64 bit numbers sent big endian, so the machines don't all
+ * have to be the same kind.
+ * This needs _POSIX_C_SOURCE to be defined before the system headers are included, for the sockets.
+*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+#include <poll.h>
+#include <netdb.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+
+/** The most prefix classes a result can have seed counts for. The same as MAX_PREFIX_CLASSES in PrefixClasses.c. */
+#define DISTRIBUTED_MAX_CLASSES 64
+
+/** How many 64 bit numbers are in every message. */
+#define DISTRIBUTED_MESSAGE_FIELDS (8 + DISTRIBUTED_MAX_CLASSES)
+
+/** How many bytes every message is on the wire. */
+#define DISTRIBUTED_MESSAGE_BYTES (DISTRIBUTED_MESSAGE_FIELDS * 8)
+
+/** How many workers the coordinator can have connected at once. */
+#define DISTRIBUTED_MAX_CLIENTS 1024
+
+/** How many seconds a worker waits before asking again when there's nothing to hand out yet. */
+#define DISTRIBUTED_WAIT_SECONDS 1
+
+
+/** The kinds of messages. Workers send the first three, the coordinator sends the rest. */
+typedef enum {
+    /** A worker just connected. Has its numDigits, taskDepth, and totalTasks so the coordinator can check they match. */
+    MESSAGE_HELLO = 1,
+    /** A worker has a result for the unit in firstTask and numTasks. */
+    MESSAGE_RESULT,
+    /** A worker has nothing to do and is asking for a unit again after being told to wait. */
+    MESSAGE_REQUEST,
+    /** The coordinator is handing out the unit in firstTask and numTasks. */
+    MESSAGE_WORK,
+    /** The coordinator has nothing to hand out right now, but not all the units are done. */
+    MESSAGE_WAIT,
+    /** Every unit is done, the worker can stop. */
+    MESSAGE_DONE,
+    /** The worker doesn't match the coordinator, like being compiled for a different number of digits. */
+    MESSAGE_MISMATCH
+} DistributedMessageType;
+
+/** What a worker gets from searching and extrapolating some tasks. */
+typedef struct {
+    /** How many seeds were found. */
+    unsigned long long numSeeds;
+    /** How many grey codes they extrapolate to. */
+    unsigned long long numGreyCodes;
+    /** How many seeds were found in each prefix class. */
+    unsigned long long classSeeds[DISTRIBUTED_MAX_CLASSES];
+} DistributedResult;
+
+/** One message between the coordinator and a worker. */
+typedef struct {
+    /** A DistributedMessageType. */
+    uint64_t type;
+    /** The number of digits the sender was compiled for. */
+    uint64_t numDigits;
+    /** How many steps the sender's tasks have set. */
+    uint64_t taskDepth;
+    /** How many tasks the sender's search is split into. */
+    uint64_t totalTasks;
+    /** The first task of the unit, for MESSAGE_WORK and MESSAGE_RESULT. */
+    uint64_t firstTask;
+    /** How many tasks are in the unit, for MESSAGE_WORK and MESSAGE_RESULT. */
+    uint64_t numTasks;
+    /** The result, for MESSAGE_RESULT. */
+    DistributedResult result;
+} DistributedMessage;
+
+/** What the coordinator knows about a search the workers have to match. */
+typedef struct {
+    /** The number of digits. */
+    uint64_t numDigits;
+    /** How many steps every task has set. */
+    uint64_t taskDepth;
+    /** How many tasks there are. */
+    uint64_t totalTasks;
+} DistributedSearchShape;
+
+/** Where a work unit is at, for the coordinator. */
+typedef struct {
+    /** The first task of the unit. */
+    uint64_t firstTask;
+    /** How many tasks are in it. */
+    uint64_t numTasks;
+    /** True once a result for it has come back. */
+    bool done;
+    /** How many workers are working on it right now. 0 means it's waiting to be handed out (or done). */
+    int numAssigned;
+    /** When it was last handed out. */
+    time_t assignedTime;
+} DistributedUnit;
+
+/** One connected worker, for the coordinator. */
+typedef struct {
+    /** The socket, or -1 if this slot is free. */
+    int fd;
+    /** The unit it's working on, or -1. */
+    long long unit;
+    /** The message being read from it, since it can come in pieces. */
+    uint8_t inBuffer[DISTRIBUTED_MESSAGE_BYTES];
+    /** How much of the message has been read. */
+    size_t inLength;
+} DistributedClient;
+
+
+
+/**
+ * Turns a message into its bytes on the wire.
+ * @param message The message.
+ * @param bytes Where the DISTRIBUTED_MESSAGE_BYTES bytes are written.
+*/
+void encodeDistributedMessage(const DistributedMessage *message, uint8_t *bytes)
+{
+    uint64_t fields[DISTRIBUTED_MESSAGE_FIELDS] = {message->type, message->numDigits, message->taskDepth, message->totalTasks,
+        message->firstTask, message->numTasks, message->result.numSeeds, message->result.numGreyCodes};
+    for(int c = 0; c < DISTRIBUTED_MAX_CLASSES; c++)
+        fields[8 + c] = message->result.classSeeds[c];
+
+    // Big endian, one byte at a time
+    for(int f = 0; f < DISTRIBUTED_MESSAGE_FIELDS; f++)
+        for(int b = 0; b < 8; b++)
+            bytes[(f * 8) + b] = (uint8_t)(fields[f] >> (56 - (b * 8)));
+}
+
+
+
+/**
+ * Turns the bytes on the wire back into a message.
+ * @param bytes The DISTRIBUTED_MESSAGE_BYTES bytes.
+ * @param message Where the message is written.
+*/
+void decodeDistributedMessage(const uint8_t *bytes, DistributedMessage *message)
+{
+    uint64_t fields[DISTRIBUTED_MESSAGE_FIELDS];
+    for(int f = 0; f < DISTRIBUTED_MESSAGE_FIELDS; f++) {
+        fields[f] = 0;
+        for(int b = 0; b < 8; b++)
+            fields[f] = (fields[f] << 8) | bytes[(f * 8) + b];
+    }
+
+    message->type = fields[0];
+    message->numDigits = fields[1];
+    message->taskDepth = fields[2];
+    message->totalTasks = fields[3];
+    message->firstTask = fields[4];
+    message->numTasks = fields[5];
+    message->result.numSeeds = fields[6];
+    message->result.numGreyCodes = fields[7];
+    for(int c = 0; c < DISTRIBUTED_MAX_CLASSES; c++)
+        message->result.classSeeds[c] = fields[8 + c];
+}
+
+
+
+/**
+ * Sends a message, making a new one from the parts.
+ * @param fd The socket.
+ * @param type The DistributedMessageType.
+ * @param shape The numDigits, taskDepth, and totalTasks to put in it.
+ * @param firstTask The first task of the unit, or 0.
+ * @param numTasks How many tasks are in the unit, or 0.
+ * @param result The result to put in it, or NULL for none.
+ * @return True if it was sent, false if the connection is gone.
+*/
+bool sendDistributedMessage(int fd, DistributedMessageType type, const DistributedSearchShape *shape,
+                            uint64_t firstTask, uint64_t numTasks, const DistributedResult *result)
+{
+    DistributedMessage message;
+    memset(&message, 0, sizeof(message));
+    message.type = type;
+    message.numDigits = shape->numDigits;
+    message.taskDepth = shape->taskDepth;
+    message.totalTasks = shape->totalTasks;
+    message.firstTask = firstTask;
+    message.numTasks = numTasks;
+    if(result != NULL) message.result = *result;
+
+    uint8_t bytes[DISTRIBUTED_MESSAGE_BYTES];
+    encodeDistributedMessage(&message, bytes);
+    size_t sent = 0;
+    while(sent < DISTRIBUTED_MESSAGE_BYTES) {
+        ssize_t n = send(fd, bytes + sent, DISTRIBUTED_MESSAGE_BYTES - sent, MSG_NOSIGNAL);
+        if(n <= 0) return false;
+        sent += n;
+    }
+    return true;
+}
+
+
+
+/**
+ * Reads a whole message, waiting for it.
+ * @param fd The socket.
+ * @param message Where the message is written.
+ * @return True if a message was read, false if the connection is gone.
+*/
+bool receiveDistributedMessage(int fd, DistributedMessage *message)
+{
+    uint8_t bytes[DISTRIBUTED_MESSAGE_BYTES];
+    size_t received = 0;
+    while(received < DISTRIBUTED_MESSAGE_BYTES) {
+        ssize_t n = recv(fd, bytes + received, DISTRIBUTED_MESSAGE_BYTES - received, 0);
+        if(n <= 0) return false;
+        received += n;
+    }
+    decodeDistributedMessage(bytes, message);
+    return true;
+}
+
+
+
+/**
+ * (Coordinator) Hands out a unit to a worker, or tells it to wait or that everything is done.
+ * Units that have never been handed out (or whose worker went away) go first. If there aren't any, the oldest unit
+ * that has been out longer than the timeout is handed out again.
+ * @param client The worker.
+ * @param units All the units.
+ * @param numUnits How many units there are.
+ * @param numDone How many units are done.
+ * @param unitTimeout How many seconds a unit can be out before it's handed out again, 0 for never.
+ * @param shape The search shape, to put in the message.
+ * @return True if the message was sent, false if the connection is gone.
+*/
+static bool assignDistributedUnit(DistributedClient *client, DistributedUnit *units, uint64_t numUnits, uint64_t numDone,
+                                  int unitTimeout, const DistributedSearchShape *shape)
+{
+    if(numDone == numUnits) return sendDistributedMessage(client->fd, MESSAGE_DONE, shape, 0, 0, NULL);
+
+    long long chosen = -1;
+    time_t now = time(NULL);
+    for(uint64_t u = 0; u < numUnits && chosen < 0; u++)
+        if(!units[u].done && units[u].numAssigned == 0) chosen = u;
+    if(chosen < 0 && unitTimeout > 0)
+        for(uint64_t u = 0; u < numUnits; u++)
+            if(!units[u].done && now - units[u].assignedTime >= unitTimeout
+                    && (chosen < 0 || units[u].assignedTime < units[chosen].assignedTime))
+                chosen = u;
+
+    if(chosen < 0) return sendDistributedMessage(client->fd, MESSAGE_WAIT, shape, 0, 0, NULL);
+
+    client->unit = chosen;
+    units[chosen].numAssigned++;
+    units[chosen].assignedTime = now;
+    return sendDistributedMessage(client->fd, MESSAGE_WORK, shape, units[chosen].firstTask, units[chosen].numTasks, NULL);
+}
+
+
+
+/**
+ * (Coordinator) Runs the coordinator. Listens on the port, hands out units of unitTasks tasks to every worker that
+ * connects, and adds up the results until every unit is done.
+ * @param port The TCP port to listen on.
+ * @param shape The search shape, which every worker has to match.
+ * @param unitTasks How many tasks go in each work unit.
+ * @param unitTimeout How many seconds a unit can be out before it's handed out again, 0 for never.
+ * @param total Where the total of all the results is written.
+ * @return True if every unit was done, false if the port couldn't be listened on.
+*/
+bool runDistributedCoordinator(int port, const DistributedSearchShape *shape, uint64_t unitTasks, int unitTimeout,
+                               DistributedResult *total)
+{
+    memset(total, 0, sizeof(DistributedResult));
+    if(unitTasks < 1) unitTasks = 1;
+
+    // Listen on every address
+    int listenFd = socket(AF_INET6, SOCK_STREAM, 0);
+    int family = AF_INET6;
+    if(listenFd < 0) {
+        listenFd = socket(AF_INET, SOCK_STREAM, 0);
+        family = AF_INET;
+    }
+    int on = 1;
+    setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    int bound;
+    if(family == AF_INET6) {
+        struct sockaddr_in6 address;
+        memset(&address, 0, sizeof(address));
+        address.sin6_family = AF_INET6;
+        address.sin6_addr = in6addr_any;
+        address.sin6_port = htons(port);
+        bound = bind(listenFd, (struct sockaddr *)&address, sizeof(address));
+    } else {
+        struct sockaddr_in address;
+        memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_ANY);
+        address.sin_port = htons(port);
+        bound = bind(listenFd, (struct sockaddr *)&address, sizeof(address));
+    }
+    if(listenFd < 0 || bound != 0 || listen(listenFd, 64) != 0) {
+        perror("coordinator");
+        if(listenFd >= 0) close(listenFd);
+        return false;
+    }
+
+    // Split the tasks into units
+    uint64_t numUnits = (shape->totalTasks + unitTasks - 1) / unitTasks;
+    DistributedUnit *units = (DistributedUnit *)calloc(numUnits, sizeof(DistributedUnit));
+    for(uint64_t u = 0; u < numUnits; u++) {
+        units[u].firstTask = u * unitTasks;
+        units[u].numTasks = (u == numUnits - 1) ? shape->totalTasks - units[u].firstTask : unitTasks;
+    }
+    uint64_t numDone = 0;
+
+    DistributedClient *clients = (DistributedClient *)malloc(sizeof(DistributedClient) * DISTRIBUTED_MAX_CLIENTS);
+    struct pollfd *pollFds = (struct pollfd *)malloc(sizeof(struct pollfd) * (DISTRIBUTED_MAX_CLIENTS + 1));
+    for(int i = 0; i < DISTRIBUTED_MAX_CLIENTS; i++)
+        clients[i].fd = -1;
+    int numClients = 0;
+
+    printf(" ------- Coordinating %llu units of %llu tasks on port %d...\n\n", (unsigned long long)numUnits,
+        (unsigned long long)unitTasks, port);
+
+    while(numDone < numUnits) {
+        // Wait for a new worker or a message, waking up every so often to hand out timed out units to waiting workers
+        pollFds[0].fd = listenFd;
+        pollFds[0].events = POLLIN;
+        for(int i = 0; i < numClients; i++) {
+            pollFds[i + 1].fd = clients[i].fd;
+            pollFds[i + 1].events = POLLIN;
+        }
+        if(poll(pollFds, numClients + 1, 1000) < 0) continue;
+
+        // Messages from the workers
+        for(int i = 0; i < numClients; i++) {
+            DistributedClient *client = clients + i;
+            if(!pollFds[i + 1].revents) continue;
+
+            bool connected = true;
+            ssize_t n = recv(client->fd, client->inBuffer + client->inLength, DISTRIBUTED_MESSAGE_BYTES - client->inLength, 0);
+            if(n <= 0) connected = false;
+            else client->inLength += n;
+
+            if(connected && client->inLength == DISTRIBUTED_MESSAGE_BYTES) {
+                DistributedMessage message;
+                decodeDistributedMessage(client->inBuffer, &message);
+                client->inLength = 0;
+
+                if(message.numDigits != shape->numDigits || message.taskDepth != shape->taskDepth
+                        || message.totalTasks != shape->totalTasks) {
+                    fprintf(stderr, "A worker for %llu digits with %llu tasks of %llu set steps doesn't match, dropping it.\n",
+                        (unsigned long long)message.numDigits, (unsigned long long)message.totalTasks,
+                        (unsigned long long)message.taskDepth);
+                    sendDistributedMessage(client->fd, MESSAGE_MISMATCH, shape, 0, 0, NULL);
+                    connected = false;
+                } else {
+                    // Take the result if it's for the unit this worker has, and nobody else beat it to it
+                    if(message.type == MESSAGE_RESULT && client->unit >= 0) {
+                        DistributedUnit *unit = units + client->unit;
+                        unit->numAssigned--;
+                        if(!unit->done && message.firstTask == unit->firstTask && message.numTasks == unit->numTasks) {
+                            unit->done = true;
+                            numDone++;
+                            total->numSeeds += message.result.numSeeds;
+                            total->numGreyCodes += message.result.numGreyCodes;
+                            for(int c = 0; c < DISTRIBUTED_MAX_CLASSES; c++)
+                                total->classSeeds[c] += message.result.classSeeds[c];
+                            printf(" ------- Unit %lld/%llu done: %llu seeds, %llu codes.\n", client->unit + 1,
+                                (unsigned long long)numUnits, message.result.numSeeds, message.result.numGreyCodes);
+                        }
+                        client->unit = -1;
+                    }
+                    if(client->unit < 0)
+                        connected = assignDistributedUnit(client, units, numUnits, numDone, unitTimeout, shape);
+                }
+            }
+
+            // If the worker is gone, its unit goes back to be handed out again
+            if(!connected) {
+                if(client->unit >= 0) {
+                    units[client->unit].numAssigned--;
+                    if(!units[client->unit].done)
+                        printf(" ------- Lost the worker on unit %lld, handing it out again.\n", client->unit + 1);
+                }
+                close(client->fd);
+                clients[i] = clients[numClients - 1];
+                pollFds[i + 1] = pollFds[numClients];
+                numClients--;
+                i--;
+            }
+        }
+
+        // New worker, after the messages so pollFds still lines up with the clients up there
+        if((pollFds[0].revents & POLLIN) && numClients < DISTRIBUTED_MAX_CLIENTS) {
+            int fd = accept(listenFd, NULL, NULL);
+            if(fd >= 0) {
+                clients[numClients].fd = fd;
+                clients[numClients].unit = -1;
+                clients[numClients].inLength = 0;
+                numClients++;
+            }
+        }
+    }
+
+    // Everything is done, let every worker that's still there know
+    for(int i = 0; i < numClients; i++) {
+        sendDistributedMessage(clients[i].fd, MESSAGE_DONE, shape, 0, 0, NULL);
+        close(clients[i].fd);
+    }
+    close(listenFd);
+    free(clients);
+    free(pollFds);
+    free(units);
+    return true;
+}
+
+
+
+/**
+ * (Worker) Runs a worker. Connects to the coordinator and runs the units it hands out until it says everything is done.
+ * @param host The coordinator's host name or address.
+ * @param port The coordinator's TCP port.
+ * @param shape The search shape of this worker, which has to match the coordinator's.
+ * @param runUnit The function that searches and extrapolates a unit. Gets the first task, how many tasks, the context,
+ *                and where to write the result.
+ * @param context Passed through to runUnit untouched.
+ * @return True if every unit was done, false if the connection couldn't be made or was lost.
+*/
+bool runDistributedWorker(const char *host, int port, const DistributedSearchShape *shape,
+                          void (*runUnit)(uint64_t, uint64_t, void *, DistributedResult *), void *context)
+{
+    // Connect to the coordinator, trying every address the host has
+    char portString[16];
+    sprintf(portString, "%d", port);
+    struct addrinfo hints, *addresses, *address;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    int error = getaddrinfo(host, portString, &hints, &addresses);
+    if(error != 0) {
+        fprintf(stderr, "%s: %s\n", host, gai_strerror(error));
+        return false;
+    }
+    int fd = -1;
+    for(address = addresses; address != NULL && fd < 0; address = address->ai_next) {
+        fd = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+        if(fd >= 0 && connect(fd, address->ai_addr, address->ai_addrlen) != 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(addresses);
+    if(fd < 0) {
+        fprintf(stderr, "Couldn't connect to the coordinator at %s:%d\n", host, port);
+        return false;
+    }
+
+    // Run whatever it hands out
+    DistributedMessage message;
+    bool ok = sendDistributedMessage(fd, MESSAGE_HELLO, shape, 0, 0, NULL);
+    while(ok && (ok = receiveDistributedMessage(fd, &message))) {
+        if(message.type == MESSAGE_WORK) {
+            DistributedResult result;
+            memset(&result, 0, sizeof(result));
+            printf(" ------- Working on tasks %llu to %llu...\n", (unsigned long long)message.firstTask,
+                (unsigned long long)(message.firstTask + message.numTasks - 1));
+            runUnit(message.firstTask, message.numTasks, context, &result);
+            ok = sendDistributedMessage(fd, MESSAGE_RESULT, shape, message.firstTask, message.numTasks, &result);
+        } else if(message.type == MESSAGE_WAIT) {
+            sleep(DISTRIBUTED_WAIT_SECONDS);
+            ok = sendDistributedMessage(fd, MESSAGE_REQUEST, shape, 0, 0, NULL);
+        } else if(message.type == MESSAGE_MISMATCH) {
+            fprintf(stderr, "The coordinator is for %llu digits with %llu tasks of %llu set steps, this worker doesn't match.\n",
+                (unsigned long long)message.numDigits, (unsigned long long)message.totalTasks,
+                (unsigned long long)message.taskDepth);
+            ok = false;
+        } else break;
+    }
+    close(fd);
+
+    if(!ok) fprintf(stderr, "Lost the connection to the coordinator.\n");
+    return ok;
+}
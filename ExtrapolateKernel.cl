@@ -0,0 +1,66 @@
+/**
+ * @file ExtrapolateKernel.cl
+ * @author Joey Hughes
+ * This is the OpenCL kernel for extrapolating seeds on a GPU, see GpuExtrapolation.c. It's countCodesByStabilizer from
+ * GreyCodeChimera.c with one work item per seed: unpack the seed, then for every rotation build up the one relabeling
+ * that could map it back onto the seed, step by step, and count the rotations where it works. Everything fits in
+ * private memory, so there's no hash table or big numbers at all. The host builds it with NUM_DIGITS,
+ * PACKED_SEQUENCE_BYTES and CODES_PER_SEED_ORBIT (n! * 2^n) set to match the program.
+*/
+
+/** The length of a sequence. 2^n */
+#define len (1 << NUM_DIGITS)
+
+/** How many bits each step takes up in a packed seed. */
+#define BITS_PER_STEP 3
+
+/** The mask that takes a step out of the bottom of some packed bits. */
+#define PACKED_STEP_MASK ((1 << BITS_PER_STEP) - 1)
+
+
+
+/**
+ * Finds how many grey codes each seed in a batch makes.
+ * @param seeds The packed seeds, PACKED_SEQUENCE_BYTES each, one after another like in a seed file.
+ * @param numSeeds How many seeds are in the batch. The work items past it do nothing.
+ * @param codes Where the number of codes each seed makes goes, by its index in the batch.
+*/
+__kernel void countSeedCodes(__global const uchar *seeds, const uint numSeeds, __global ulong *codes)
+{
+    const uint seedIndex = get_global_id(0);
+    if(seedIndex >= numSeeds) return;
+
+    // Unpack the seed twice over, so every rotation can be read straight through
+    uchar doubled[len * 2];
+    __global const uchar *bytePtr = seeds + (size_t)seedIndex * PACKED_SEQUENCE_BYTES;
+    uint bits = 0;
+    int numBits = 0;
+    for(int i = 0; i < len; i++) {
+        if(numBits < BITS_PER_STEP) {
+            bits = (bits << 8) | *(bytePtr++);
+            numBits += 8;
+        }
+        numBits -= BITS_PER_STEP;
+        doubled[i] = doubled[i + len] = (bits >> numBits) & PACKED_STEP_MASK;
+    }
+
+    // Count the rotations that have a relabeling back onto the seed
+    uchar relabel[NUM_DIGITS];
+    ulong stabilizerSize = 0;
+    for(int rotation = 0; rotation < len; rotation++) {
+        for(int d = 0; d < NUM_DIGITS; d++) relabel[d] = NUM_DIGITS;
+        uint usedLabels = 0;
+        int i;
+        for(i = 0; i < len; i++) {
+            uchar from = doubled[rotation + i], to = doubled[i];
+            if(relabel[from] == NUM_DIGITS) {
+                if(usedLabels & (1u << to)) break;
+                relabel[from] = to;
+                usedLabels |= (1u << to);
+            } else if(relabel[from] != to) break;
+        }
+        if(i == len) stabilizerSize++;
+    }
+
+    codes[seedIndex] = CODES_PER_SEED_ORBIT / stabilizerSize;
+}
@@ -0,0 +1,285 @@
+/**
+ * @file GpuExtrapolation.c
+ * @author Joey Hughes
+ * This is the OpenCL side of extrapolating seeds on a GPU, for GreyCodeChimera.c compiled with -DGPU_EXTRAPOLATION
+ * (and linked with -lOpenCL). The kernel is in ExtrapolateKernel.cl, which is read and built when the program starts,
+ * and counts each seed's stabilizer the same way EXTRAPOLATE_STABILIZER does, one work item per seed.
+ * A GpuExtrapolator is the device and the built kernel, shared by everything. Each thread feeding the GPU has its own
+ * GpuStream, which is a command queue with two slots of buffers, so one batch of seeds can be copied over, counted,
+ * and copied back while the thread is gathering the next batch from the seed queue or the seed file.
+*/
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifndef GREY_CODE_TYPES_DEFINED
+    #include "GreyCodeTypes.h"
+#endif
+
+#define CL_TARGET_OPENCL_VERSION 120
+#ifdef __APPLE__
+    #include <OpenCL/opencl.h>
+#else
+    #include <CL/cl.h>
+#endif
+
+
+/** Where the kernel is read from, if not given with --gpu-kernel. Can be set in compilation with -DDEFAULT_GPU_KERNEL_PATH=X. */
+#ifndef DEFAULT_GPU_KERNEL_PATH
+#define DEFAULT_GPU_KERNEL_PATH "ExtrapolateKernel.cl"
+#endif
+
+/** How many seeds go to the GPU at a time, if not given with --gpu-batch. Can be set in compilation with -DDEFAULT_GPU_BATCH=X. */
+#ifndef DEFAULT_GPU_BATCH
+#define DEFAULT_GPU_BATCH 65536
+#endif
+
+/** How many slots of buffers each stream has. One is being gathered while the other is on the GPU. */
+#define GPU_STREAM_SLOTS 2
+
+
+/** The device and the built kernel, shared by every stream. */
+typedef struct {
+    /** The OpenCL context on the device. */
+    cl_context context;
+    /** The device, the first GPU found, or the first device of any kind if there's no GPU. */
+    cl_device_id device;
+    /** The kernel program, built for this many digits. */
+    cl_program program;
+    /** The most seeds a stream sends at a time. */
+    size_t batchSeeds;
+    /** The name of the device, for printing. */
+    char deviceName[256];
+} GpuExtrapolator;
+
+/** One thread's queue to the GPU, with two slots so the copying and counting of one batch overlaps gathering the next. */
+typedef struct {
+    /** The extrapolator this stream is on. */
+    const GpuExtrapolator *gpu;
+    /** The in order command queue. */
+    cl_command_queue queue;
+    /** The stream's own kernel, since the arguments can't be set on a shared one from more than one thread. */
+    cl_kernel kernel;
+    /** The seeds on the GPU, for each slot. */
+    cl_mem seedBuffers[GPU_STREAM_SLOTS];
+    /** The codes each seed makes on the GPU, for each slot. */
+    cl_mem codeBuffers[GPU_STREAM_SLOTS];
+    /** Where the seeds are gathered on the host before they go over, for each slot. */
+    packedSequence *staging[GPU_STREAM_SLOTS];
+    /** Where the codes each seed makes are copied back to, for each slot. */
+    cl_ulong *codes[GPU_STREAM_SLOTS];
+    /** Set once the codes of each slot are copied back. */
+    cl_event done[GPU_STREAM_SLOTS];
+    /** How many seeds are in each slot. */
+    size_t numSeeds[GPU_STREAM_SLOTS];
+} GpuStream;
+
+
+
+/**
+ * Checks the result of an OpenCL call. The GPU only gets used for whole runs, and a batch that didn't get counted
+ * would make the total wrong, so any failure after the setup is the end of the program.
+ * @param error What the call returned.
+ * @param what What the call was, for the message.
+*/
+static void checkGpuError(cl_int error, const char *what)
+{
+    if(error == CL_SUCCESS) return;
+    fprintf(stderr, "OpenCL error %d in %s\n", error, what);
+    exit(EXIT_FAILURE);
+}
+
+
+
+/**
+ * Reads the whole kernel file into a string.
+ * @param path The kernel file.
+ * @return The source, to be freed, or NULL if it couldn't be read.
+*/
+static char *readGpuKernelSource(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if(file == NULL) {
+        perror(path);
+        return NULL;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char *source = (char *)malloc(size + 1);
+    size_t read = fread(source, 1, size, file);
+    fclose(file);
+    source[read] = '\0';
+    return source;
+}
+
+
+
+/**
+ * Finds a device, then reads and builds the kernel for it.
+ * @param kernelPath Where ExtrapolateKernel.cl is.
+ * @param batchSeeds The most seeds a stream sends at a time.
+ * @param codesPerOrbit n! * len, the codes a seed with nothing in its stabilizer but the identity makes.
+ * @return Pointer to the new GpuExtrapolator, or NULL if there's no device or the kernel didn't build.
+*/
+GpuExtrapolator *createGpuExtrapolator(const char *kernelPath, size_t batchSeeds, unsigned long long codesPerOrbit)
+{
+    // Find a GPU on any platform, or any device at all if there isn't one
+    cl_platform_id platforms[16];
+    cl_uint numPlatforms = 0;
+    cl_device_id device = NULL;
+    if(clGetPlatformIDs(16, platforms, &numPlatforms) != CL_SUCCESS || numPlatforms == 0) {
+        fprintf(stderr, "There aren't any OpenCL platforms\n");
+        return NULL;
+    }
+    if(numPlatforms > 16) numPlatforms = 16;
+    for(cl_uint p = 0; p < numPlatforms && device == NULL; p++)
+        if(clGetDeviceIDs(platforms[p], CL_DEVICE_TYPE_GPU, 1, &device, NULL) != CL_SUCCESS) device = NULL;
+    for(cl_uint p = 0; p < numPlatforms && device == NULL; p++)
+        if(clGetDeviceIDs(platforms[p], CL_DEVICE_TYPE_ALL, 1, &device, NULL) != CL_SUCCESS) device = NULL;
+    if(device == NULL) {
+        fprintf(stderr, "There aren't any OpenCL devices\n");
+        return NULL;
+    }
+
+    char *source = readGpuKernelSource(kernelPath);
+    if(source == NULL) return NULL;
+
+    GpuExtrapolator *gpu = (GpuExtrapolator *)calloc(1, sizeof(GpuExtrapolator));
+    gpu->device = device;
+    gpu->batchSeeds = batchSeeds;
+    clGetDeviceInfo(device, CL_DEVICE_NAME, sizeof(gpu->deviceName) - 1, gpu->deviceName, NULL);
+
+    cl_int error;
+    gpu->context = clCreateContext(NULL, 1, &device, NULL, NULL, &error);
+    checkGpuError(error, "clCreateContext");
+    const char *sources[1] = {source};
+    gpu->program = clCreateProgramWithSource(gpu->context, 1, sources, NULL, &error);
+    checkGpuError(error, "clCreateProgramWithSource");
+    free(source);
+
+    // The kernel gets the sizes from here, so it always matches how the program was compiled
+    char options[256];
+    snprintf(options, sizeof(options), "-DNUM_DIGITS=%d -DPACKED_SEQUENCE_BYTES=%d -DCODES_PER_SEED_ORBIT=%lluUL",
+        NUM_DIGITS, PACKED_SEQUENCE_BYTES, codesPerOrbit);
+    if(clBuildProgram(gpu->program, 1, &device, options, NULL, NULL) != CL_SUCCESS) {
+        size_t logSize = 0;
+        clGetProgramBuildInfo(gpu->program, device, CL_PROGRAM_BUILD_LOG, 0, NULL, &logSize);
+        char *log = (char *)malloc(logSize + 1);
+        clGetProgramBuildInfo(gpu->program, device, CL_PROGRAM_BUILD_LOG, logSize, log, NULL);
+        log[logSize] = '\0';
+        fprintf(stderr, "%s didn't build:\n%s\n", kernelPath, log);
+        free(log);
+        clReleaseProgram(gpu->program);
+        clReleaseContext(gpu->context);
+        free(gpu);
+        return NULL;
+    }
+    return gpu;
+}
+
+
+
+/**
+ * Frees the extrapolator. Every stream on it should be freed first.
+ * @param gpu The extrapolator to free.
+*/
+void freeGpuExtrapolator(GpuExtrapolator *gpu)
+{
+    clReleaseProgram(gpu->program);
+    clReleaseContext(gpu->context);
+    free(gpu);
+}
+
+
+
+/**
+ * Creates a stream on the extrapolator, with its own queue, kernel, and both slots of buffers.
+ * @param gpu The extrapolator.
+ * @return Pointer to the new GpuStream.
+*/
+GpuStream *createGpuStream(const GpuExtrapolator *gpu)
+{
+    cl_int error;
+    GpuStream *stream = (GpuStream *)calloc(1, sizeof(GpuStream));
+    stream->gpu = gpu;
+    stream->queue = clCreateCommandQueue(gpu->context, gpu->device, 0, &error);
+    checkGpuError(error, "clCreateCommandQueue");
+    stream->kernel = clCreateKernel(gpu->program, "countSeedCodes", &error);
+    checkGpuError(error, "clCreateKernel");
+    for(int slot = 0; slot < GPU_STREAM_SLOTS; slot++) {
+        stream->seedBuffers[slot] = clCreateBuffer(gpu->context, CL_MEM_READ_ONLY, sizeof(packedSequence) * gpu->batchSeeds, NULL, &error);
+        checkGpuError(error, "clCreateBuffer");
+        stream->codeBuffers[slot] = clCreateBuffer(gpu->context, CL_MEM_WRITE_ONLY, sizeof(cl_ulong) * gpu->batchSeeds, NULL, &error);
+        checkGpuError(error, "clCreateBuffer");
+        stream->staging[slot] = (packedSequence *)malloc(sizeof(packedSequence) * gpu->batchSeeds);
+        stream->codes[slot] = (cl_ulong *)malloc(sizeof(cl_ulong) * gpu->batchSeeds);
+    }
+    return stream;
+}
+
+
+
+/**
+ * Sends a batch of seeds over in one of the stream's slots and starts counting them. Returns right away, the codes
+ * are waited on with finishGpuBatch. The seeds have to stay put until then.
+ * @param stream The stream.
+ * @param slot Which slot to use. It can't have a batch in it already.
+ * @param seeds The packed seeds, either the slot's staging buffer or a piece of a mapped seed file.
+ * @param numSeeds How many seeds, at most the extrapolator's batchSeeds.
+*/
+void launchGpuBatch(GpuStream *stream, int slot, const packedSequence *seeds, size_t numSeeds)
+{
+    cl_uint count = (cl_uint)numSeeds;
+    size_t globalSize = numSeeds;
+    stream->numSeeds[slot] = numSeeds;
+    checkGpuError(clEnqueueWriteBuffer(stream->queue, stream->seedBuffers[slot], CL_FALSE, 0, sizeof(packedSequence) * numSeeds,
+                                       seeds, 0, NULL, NULL), "clEnqueueWriteBuffer");
+    checkGpuError(clSetKernelArg(stream->kernel, 0, sizeof(cl_mem), stream->seedBuffers + slot), "clSetKernelArg");
+    checkGpuError(clSetKernelArg(stream->kernel, 1, sizeof(cl_uint), &count), "clSetKernelArg");
+    checkGpuError(clSetKernelArg(stream->kernel, 2, sizeof(cl_mem), stream->codeBuffers + slot), "clSetKernelArg");
+    checkGpuError(clEnqueueNDRangeKernel(stream->queue, stream->kernel, 1, NULL, &globalSize, NULL, 0, NULL, NULL),
+                  "clEnqueueNDRangeKernel");
+    checkGpuError(clEnqueueReadBuffer(stream->queue, stream->codeBuffers[slot], CL_FALSE, 0, sizeof(cl_ulong) * numSeeds,
+                                      stream->codes[slot], 0, NULL, stream->done + slot), "clEnqueueReadBuffer");
+    clFlush(stream->queue);
+}
+
+
+
+/**
+ * Waits for the batch in one of the stream's slots to be counted and copied back.
+ * @param stream The stream.
+ * @param slot The slot. If there's no batch in it, this does nothing.
+ * @return The codes each seed in the batch makes, numSeeds[slot] of them, or NULL if there was no batch. They're good
+ *         until the slot is launched again.
+*/
+const cl_ulong *finishGpuBatch(GpuStream *stream, int slot)
+{
+    if(stream->done[slot] == NULL) return NULL;
+    checkGpuError(clWaitForEvents(1, stream->done + slot), "clWaitForEvents");
+    clReleaseEvent(stream->done[slot]);
+    stream->done[slot] = NULL;
+    return stream->codes[slot];
+}
+
+
+
+/**
+ * Frees the stream. Every batch launched on it should be finished first.
+ * @param stream The stream to free.
+*/
+void freeGpuStream(GpuStream *stream)
+{
+    for(int slot = 0; slot < GPU_STREAM_SLOTS; slot++) {
+        clReleaseMemObject(stream->seedBuffers[slot]);
+        clReleaseMemObject(stream->codeBuffers[slot]);
+        free(stream->staging[slot]);
+        free(stream->codes[slot]);
+    }
+    clReleaseKernel(stream->kernel);
+    clReleaseCommandQueue(stream->queue);
+    free(stream);
+}
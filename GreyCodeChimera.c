@@ -13,7 +13,77 @@
  * The NUM_DIGITS macro will default to 4, but usually you want to set this in compilation with the DNUM_DIGITS=X flag
  * (of course replacing the X with the number of digits, like 4 or 5, really anything >= 4 will work, it will just stop being very useful past 5 or 6 lol.)
  * The -DRUNTIME flag is optional, if you include it then the program outputs runtime information, or basically just how long the program took to run.
- * I always used this flag, but it's technically optional if you want to not use it.
+ * I always used this flag, but it's technically optional if you want to not use it. Running with --time does the same thing without recompiling.
+ * To get one binary that does every digit count instead of one per digit count, see GreyCodeDigits.c.
+ * The -DSTABILIZER_EXTRAPOLATION flag is optional too, it switches the extrapolation from hashing all the permutations of
+ * each seed to counting the seed's stabilizer, which gets the same totals way faster. -DCANONICAL_EXTRAPOLATION keeps
+ * the hashing, but only hashes the least rotation of each relabeling instead of looking up every one of its rotations.
+ * -DSIGNATURE_EXTRAPOLATION only tries the relabelings that keep how many times each digit flips, which for most seeds
+ * is just the identity (see SeedSignatures.c).
+ * When running it, there are a couple options:
+ *   --digits N says how many digits to do. In a build with just one NUM_DIGITS it has to be that one, and in the one
+ *     binary for every digit count from GreyCodeDigits.c it picks which one runs.
+ *   --seeds PATH saves every seed to a binary seed file at PATH as they're found (see SeedStore.c), with a checkpoint
+ *     of where the search is at PATH.ckpt every so often, so a long run that dies doesn't lose all its seeds.
+ *   --checkpoint-interval SECONDS sets how often those checkpoints are taken, the default is every minute.
+ *   --resume PATH picks a search that was saving to PATH back up from its last checkpoint. The tasks that were done
+ *     are skipped, the ones that were partway done carry on from where they were, and the seeds after the checkpoint
+ *     are thrown away and found again. It has to be compiled the same way so the tasks are the same.
+ *   --extrapolate PATH skips the search and just extrapolates the seeds in the seed file at PATH.
+ *   --extrapolate-batch N sets how many seeds each extrapolation thread takes out of a seed file at a time, the default
+ *     is 256. Smaller evens out the threads better, bigger means less fighting over the cursor.
+ *   --threads N runs N search workers and N extrapolation threads instead of one of each per core. If it isn't given,
+ *     the GREY_CODE_THREADS environment variable is used, if that's set.
+ *   --search-threads N and --extrapolate-threads N set the two separately, on top of --threads.
+ *   --task-depth N sets how many steps each search task has set, instead of SEARCH_TASK_DEPTH (see below). It can go
+ *     up to 4 less than the length of a code. Resuming and distributed searches need the same as they started with.
+ *   --search-only just searches and counts the seeds, without extrapolating them. With --seeds, the seed file can be
+ *     extrapolated later with --extrapolate, on a different machine or with a different build.
+ *   --progress SECONDS prints how far the search has gotten every so often, 0 for never. The default is every minute
+ *     at 6 digits or more, and never below that.
+ *   --time prints how long the run took, like compiling with -DRUNTIME does. The times are wall clock times, with the
+ *     CPU time of every thread added up after the total.
+ *   --benchmark runs the benchmarks in Benchmarks.c instead, on small slices of the search and extrapolation, and
+ *     --benchmark-save PATH and --benchmark-baseline PATH save the results and compare them to ones saved before.
+ *   --stats PATH writes a line of JSON to PATH every --stats-interval SECONDS (10 by default), with what every search
+ *     worker (nodes, pruned partial codes, whole codes, seeds) and extrapolation thread (seeds, relabelings hashed,
+ *     codes, time waiting) has counted so far. The last line has "final":true and how long each stage took.
+ *   --verify-extrapolation PATH and --verify-search PATH check the extrapolation and the search seed by seed against
+ *     a text file of seeds and their group sizes, like 5DigitSeedsAndTheirGroupSize.txt (see Verify.c), and exit with a
+ *     failure if anything doesn't match. Worth running after changing either of them.
+ *   --check-duplicates puts every seed the workers find in one shared table (see SequenceHashTable.c) and says if any
+ *     seed gets found twice, which would mean the tasks overlap. Good to run once after changing how the search is split.
+ *   --numa pins the search workers and extrapolation threads to the NUMA nodes of the machine, split evenly, so each
+ *     worker's seeds are stored on its own node and mostly extrapolated there too (see NumaPlacement.c). Only worth it
+ *     on machines with more than one socket.
+ *   --dump-codes PATH writes every whole code the search reaches to PATH.N for worker N, a byte per step like the
+ *     XDigits_Y.bin files from Old/main.c, and --dump-seeds PATH does the same with just the seeds (see CodeDump.c).
+ *     --dump-prefix DIGITS only dumps the codes that start with DIGITS, like 01020, --dump-packed writes them as
+ *     packedSequences instead, and --dump-compress gzips them, if compiled with -DCODE_DUMP_ZLIB and linked with -lz.
+ *   --bucket-signatures sorts the seed file by the seeds' signatures, how many times each digit flips, so seeds that keep
+ *     the same relabelings are together for -DSIGNATURE_EXTRAPOLATION (see SeedSignatures.c), and says how many
+ *     signatures there are. With --seeds or --resume it's done once the run is over, and with --extrapolate before.
+ *     With --search-only, that makes the search just write out the seeds bucketed by signature.
+ *   --count skips the seeds altogether and just counts the codes by meeting in the middle (see MeetInTheMiddle.c),
+ *     which is a good cross-check on the total. Only up to 5 digits.
+ * To split the search over a bunch of machines (see DistributedSearch.c), compile it the same way on all of them, then:
+ *   --coordinator PORT runs the coordinator on one machine, which hands out units of --unit-tasks N tasks and adds up
+ *     the results, and hands a unit out again after --unit-timeout SECONDS if its worker hasn't gotten back yet.
+ *   --worker HOST:PORT runs a worker on every other machine, which searches and extrapolates the units it's handed.
+ *   Setting --task-depth (or -DSEARCH_TASK_DEPTH=X) deeper makes more, smaller tasks, if the units are too big.
+ * Setting -DPREFIX_CLASS_STEPS=X changes how many steps the prefix classes have set (see PrefixClasses.c). More set steps
+ * means more classes and a more even split, but the classes and so the tasks change, so checkpoints and distributed
+ * workers all have to use the same.
+ * Setting -DBITSET_SEARCH switches the code search to the bitset engine (see searchCodesBitset), which finds the same
+ * seeds without the flags array, for up to 6 digits. SearchBenchmark.c times the two against each other.
+ * Setting -DGPU_EXTRAPOLATION (and linking with -lOpenCL) adds an OpenCL backend that counts the seeds' stabilizers on
+ * a GPU instead of the extrapolation threads (see GpuExtrapolation.c), with these options:
+ *   --gpu extrapolates on the GPU. Each of the --extrapolate-threads (1 by default) feeds it batches of seeds from the
+ *     seed queue or seed file, gathering the next batch while the last one is on the GPU.
+ *   --gpu-kernel PATH is where ExtrapolateKernel.cl is, if it isn't in the directory the program is run from.
+ *   --gpu-batch N sets how many seeds go to the GPU at a time, the default is 65536.
+ * Adding -mavx2 (or -march=native) uses the AVX2 versions of the relabel, swap and compare loops in SequenceKernels.c, which
+ * is a good bit faster if the machine has it.
  * Make sure you have the gmp library for big numbers in a place where gcc can link it.
  * O2 is fastest, while O1 is second fastest and O3 ends up the slowest, I think.
  * 
@@ -21,68 +91,351 @@
  * though, sorry :/.
 */
 
+/** For fsync, pwrite, mmap and the like with -std=c99. Has to be before any of the system headers. */
+#define _POSIX_C_SOURCE 200809L
+/** For pinning threads to cores with pthread_setaffinity_np, see NumaPlacement.c. */
+#define _GNU_SOURCE
+
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 #include <time.h>
 #include <pthread.h>
+#include <unistd.h>
+#ifdef CODE_DUMP_ZLIB
+    #include <zlib.h> // Has to be before GreyCodeTypes.h, since it names parameters len
+#endif
 #ifndef GREY_CODE_TYPES_DEFINED
     #include "GreyCodeTypes.h"
 #endif
 #include "GMPHashTable.c"
-#include "ThreadSequenceCheckers.c"
+#include "KeyHashTable.c"
+#include "PrefixClasses.c"
+#include "WorkStealingPool.c"
+#include "NumaPlacement.c"
+#include "SeedQueue.c"
+#include "SeedStore.c"
+#include "CodeDump.c"
+#include "SequenceHashTable.c"
+#include "PermutationTable.c"
+#include "SeedSignatures.c"
+#include "SequenceKernels.c"
+#include "DistributedSearch.c"
+#include "MeetInTheMiddle.c"
+#ifdef GPU_EXTRAPOLATION
+    #include "GpuExtrapolation.c"
+#endif
+
+#if MAX_PREFIX_CLASSES > DISTRIBUTED_MAX_CLASSES
+#error "A distributed result can't hold the seed counts of every prefix class"
+#endif
+
+#if defined(BITSET_SEARCH) && NUM_DIGITS > 6
+#error "The bitset search keeps the reached numbers in one 64 bit word, so it only goes up to 6 digits"
+#endif
 
 
 /* The value of a stepMask that changes the highest order bit. */
 #define LAST_DIGIT_STEP (1 << (NUM_DIGITS - 1))
 
-/** The thread count is how many threads are made. */
-#define THREAD_COUNT_CODE_SEARCH 5
+/** How many steps each code search task has set, if not given with --task-depth. The classes' set steps are extended out
+ * to this many steps to split the search into lots of small tasks for the work-stealing pool. Can be set in compilation
+ * with -DSEARCH_TASK_DEPTH=X. */
+#ifndef SEARCH_TASK_DEPTH
+#define SEARCH_TASK_DEPTH (NUM_DIGITS * 2)
+#endif
+
+/** How many seconds between checkpoints when saving the seeds, if not given with --checkpoint-interval. Can be set in compilation with -DDEFAULT_CHECKPOINT_INTERVAL=X. */
+#ifndef DEFAULT_CHECKPOINT_INTERVAL
+#define DEFAULT_CHECKPOINT_INTERVAL 60
+#endif
+
+/** How many tasks go in each work unit of a distributed search, if not given with --unit-tasks. Can be set in compilation with -DDEFAULT_WORK_UNIT_TASKS=X. */
+#ifndef DEFAULT_WORK_UNIT_TASKS
+#define DEFAULT_WORK_UNIT_TASKS 16
+#endif
+
+/** How many seeds an extrapolation thread takes out of a seed file at a time, if not given with --extrapolate-batch. Can be set in compilation with -DDEFAULT_EXTRAPOLATE_BATCH=X. */
+#ifndef DEFAULT_EXTRAPOLATE_BATCH
+#define DEFAULT_EXTRAPOLATE_BATCH 256
+#endif
+
+/** How many seconds between progress reports from the search, if not given with --progress. 0 is never. Can be set in compilation with -DDEFAULT_PROGRESS_INTERVAL=X. */
+#ifndef DEFAULT_PROGRESS_INTERVAL
+#define DEFAULT_PROGRESS_INTERVAL (NUM_DIGITS >= 6 ? 60 : 0)
+#endif
+
+/** How many seconds between lines of stats with --stats, if not given with --stats-interval. Can be set in compilation with -DDEFAULT_STATS_INTERVAL=X. */
+#ifndef DEFAULT_STATS_INTERVAL
+#define DEFAULT_STATS_INTERVAL 10
+#endif
+
+/** Whether to print how long the run took if --time isn't given. On if compiled with -DRUNTIME. */
+#ifdef RUNTIME
+#define DEFAULT_SHOW_RUNTIME true
+#else
+#define DEFAULT_SHOW_RUNTIME false
+#endif
+
+/** The deepest a task can go. The last three steps are forced and skipAdding steps back over them, so the task's set
+ * steps have to stop before that. */
+#define MAX_TASK_DEPTH (len - 4)
 
-/** How many threads to split the large extrapolation into. */
-#define THREAD_COUNT_EXTRAPOLATION 4
+/** The task depth used if not given with --task-depth. */
+#define TASK_DEPTH (SEARCH_TASK_DEPTH < MAX_TASK_DEPTH ? SEARCH_TASK_DEPTH : MAX_TASK_DEPTH)
 
 /** This macro does the log base 2 of the given number. Used to go from the step representation to the digit number representation. */
 #define log2(x) (__builtin_ctz(x))
 
 
 
-/** The struct passed into each of the code searching threads. Also used to return out the final count of seeds and the reference to the seed list. */
+/** One task of the code search. It is one of the prefix classes with some more steps set after it, and the task is done
+ * once the search would have to change one of those set steps. */
 typedef struct {
-    /** Passing in, how many steps are set. When returned, then number of codes that were found. */
-    unsigned long long count;
-    /** Only used for passing in. Passes in the steps that are preset and once the last one of these is changed the thread is done. */
+    /** The class this task belongs to. */
+    PrefixClass *prefixClass;
+    /** The steps that are set for this task. Starts with the class's set steps. */
     stepMask setSteps[len];
-    /** Pointer to the array that holds all the sequence pointers. This is allocated in each thread and accessed by the main thread. */
-    seqPtrArray seeds;
-    /** Pointer to the function that will be used to check if a sequence is a child of seed from a lower thread. */
-    bool (*checkStepsLower)(stepMask *);
-    /** How many steps ahead the checkSteps function looks. So that the thread knows how late in the sequence it can call. */
-    int stepsBack;
-    /** Checks if the steps ahead of the pointer could be swapped to have the same set start as the thread. Always looks forward the num of setSteps - 1 */
-    bool (*checkStepsIn)(stepMask *);
-    /** Used to pass in a pointer to the queue so it only has to be made once. */
-    stepMask (*queueStepPointer)[2];
-    /** How long the queue of extra steps is. For some it will be (n-3)! and for others (n-4)! */
-    unsigned long long queueLen;
-} CodeSearchThreadStruct;
+    /** How many steps are set. At least the class's number of set steps, and at most the task depth. */
+    int numSetSteps;
+} CodeSearchTask;
+
+/** The rotations of a partial code in the search that could still turn out lower than it, relabeled to the class's set
+ * start. For every step of the code there's the list of rotations and relabelings that are the same as the code up to
+ * that step, so each new step only has to look at the ones from the step before. */
+typedef struct {
+    /** The relabeling for every rotation and extra swap, indexed by rotation * queueLen + extra swap, then by digit number. */
+    stepMask (*relabels)[NUM_DIGITS];
+    /** All the lists, one after another. Each is the indices into relabels that still match. */
+    int *live;
+    /** Where the list for each step starts in live. The list for a step ends where the next one starts. len + 1 long. */
+    int *liveStart;
+} PartialCodeMatches;
+
+/** What a code search worker counts besides its seeds, for the stats. The search keeps its own copy while it runs and
+ * adds it into the worker's after every code, so the stats writer can read them without slowing the search down. */
+typedef struct {
+    /** How many partial codes the search went through, one for every step it marked and every whole code. The bitset
+     * search fills in the last three steps at once and counts that as one, so its counts are lower than the other's. */
+    unsigned long long nodes;
+    /** How many partial codes were thrown out for having a lower rotation or window signature. */
+    unsigned long long pruned;
+    /** How many whole grey codes were reached, seeds or not. */
+    unsigned long long codes;
+} SearchStats;
+
+/** The struct for each code search worker. The tasks each worker runs all add their seeds to the worker's current batch,
+ * which gets pushed to the seed queue once it's full. */
+typedef struct {
+    /** The batch the worker is filling. Allocated by the worker and handed off to the seed queue. */
+    SeedBatch *batch;
+    /** The queue that full batches are pushed to for the extrapolation threads. */
+    SeedQueue *seedQueue;
+    /** How many seeds this worker has found in total. */
+    unsigned long long count;
+    /** How many seeds this worker has found in each of the prefix classes. */
+    unsigned long long classSeeds[MAX_PREFIX_CLASSES];
+    /** The arena this worker's batches come from. */
+    SeedArena *seedArena;
+    /** The seed file every worker appends to, or NULL if the seeds aren't being saved. */
+    SeedStore *seedStore;
+    /** How many of the seeds in the current batch have been appended to the seed file already. */
+    unsigned long long storedInBatch;
+    /** Lock around the published position. The checkpointer holds every worker's lock while it takes a checkpoint. */
+    pthread_mutex_t publishLock;
+    /** Where this worker was the last time it published. Every seed it found before this is in the seed file. */
+    SearchPosition published;
+    /** Which tasks are done, shared by all the workers. A worker marks its task while holding its publishLock. */
+    uint8_t *completedTasks;
+    /** Bumped by the checkpointer for every checkpoint. Once a worker sees it change, it publishes at its next code. */
+    unsigned int *checkpointEpoch;
+    /** The value of checkpointEpoch the last time this worker published. */
+    unsigned int seenEpoch;
+    /** Every seed any worker has found, shared by all of them, or NULL if not checking for duplicates. */
+    SeqHashTable *seenSeeds;
+    /** How many of this worker's seeds another worker (or this one) had already found. Should always be 0. */
+    unsigned long long duplicates;
+    /** Everything else this worker has counted, see SearchStats. */
+    SearchStats stats;
+    /** The NUMA node the worker is pinned to, and its arena is on. 0 if not placing the threads. */
+    int numaNode;
+    /** The worker's dump of the codes or seeds it finds, or NULL if not dumping them. */
+    CodeDump *codeDump;
+} CodeSearchWorker;
+
+/** Everything the code search workers share, passed through the work-stealing pool as its context. */
+typedef struct {
+    /** The list of all the tasks. */
+    CodeSearchTask *tasks;
+    /** How many tasks there are. */
+    size_t numTasks;
+    /** How many steps every task was split out to, for the checkpoints. */
+    int taskDepth;
+    /** How many tasks have been run so far, for the progress reports. */
+    size_t tasksRun;
+    /** One struct per worker. */
+    CodeSearchWorker *workers;
+    /** How many workers there are. */
+    int numWorkers;
+    /** The seed file every worker appends to, or NULL if the seeds aren't being saved. */
+    SeedStore *seedStore;
+    /** Which tasks are done, numTasks long. When resuming, the ones done before the checkpoint are already set. */
+    uint8_t *completedTasks;
+    /** When resuming, the code each task was at in the checkpoint, or NULL for the ones that weren't partway done. NULL if not resuming. */
+    const step **resumePositions;
+    /** Bumped for every checkpoint, see CodeSearchWorker. */
+    unsigned int checkpointEpoch;
+    /** How many seconds between checkpoints. */
+    int checkpointInterval;
+    /** How many seconds between progress reports, 0 for none. */
+    int progressInterval;
+    /** Lock for stopping the checkpointer and the progress reporter. */
+    pthread_mutex_t checkpointLock;
+    /** Broadcast to wake the checkpointer and the progress reporter up early when the search is done. */
+    pthread_cond_t checkpointStop;
+    /** Set once the search is done and the checkpointer and progress reporter should stop. */
+    bool searchDone;
+    /** The NUMA nodes to pin the workers to, or NULL to not pin them. */
+    const NumaTopology *numa;
+} CodeSearchContext;
+
+/** The ways the extrapolation can find how many codes each seed makes. */
+typedef enum {
+    /** Apply every one of the n! swaps and hash every rotation of every one, counting the unique permutations. */
+    EXTRAPOLATE_HASHING,
+    /** Count the rotations that can be relabeled back into the seed, which is the size of its stabilizer. No hashing. */
+    EXTRAPOLATE_STABILIZER,
+    /** Apply every one of the n! swaps like hashing, but turn each one into its least rotation and hash only that. */
+    EXTRAPOLATE_CANONICAL,
+    /** Only try the relabelings that keep the seed's signature, and count the ones that map it onto a rotation of itself. */
+    EXTRAPOLATE_SIGNATURE,
+    #ifdef GPU_EXTRAPOLATION
+    /** Count the stabilizer like EXTRAPOLATE_STABILIZER, but on the GPU, see extrapolateSeedsGpu. */
+    EXTRAPOLATE_GPU
+    #endif
+} ExtrapolationMode;
+
+/** The extrapolation mode that is used. Hashing by default, stabilizer counting if compiled with -DSTABILIZER_EXTRAPOLATION,
+ * hashing the least rotations if compiled with -DCANONICAL_EXTRAPOLATION, or only the relabelings that keep the
+ * signature if compiled with -DSIGNATURE_EXTRAPOLATION. */
+#ifdef STABILIZER_EXTRAPOLATION
+#define DEFAULT_EXTRAPOLATION_MODE EXTRAPOLATE_STABILIZER
+#elif defined(CANONICAL_EXTRAPOLATION)
+#define DEFAULT_EXTRAPOLATION_MODE EXTRAPOLATE_CANONICAL
+#elif defined(SIGNATURE_EXTRAPOLATION)
+#define DEFAULT_EXTRAPOLATION_MODE EXTRAPOLATE_SIGNATURE
+#else
+#define DEFAULT_EXTRAPOLATION_MODE EXTRAPOLATE_HASHING
+#endif
 
 /** The struct passed in to each of the extrapolation threads. Also used to return out the final tally of gray codes. */
 typedef struct {
-    /** For passing in the list of seeds to extrapolate for. */
-    seqPtrArray seeds;
-    /** For passing in how many seeds to extrapolate, or how far to go in the array. */
-    unsigned long long numSeedsToExtrapolate;
-    /** Returns the amount of grey codes extrapolated. */
+    /** Which way to extrapolate each seed. */
+    ExtrapolationMode mode;
+    /** The queue the seed batches to extrapolate are popped from, if not extrapolating from a seed file. */
+    SeedQueue *seedQueue;
+    /** The mapped seed file to extrapolate before moving on to the seed queue, or NULL to just use the queue. */
+    const MappedSeedFile *seedFile;
+    /** The index of the next seed in the file that hasn't been handed out to a thread yet, shared by all the threads. */
+    uint64_t *fileCursor;
+    /** How many seeds to take out of the file at a time. */
+    uint64_t fileBatchSize;
+    /** The index of the next seed to extrapolate in the seed file, from the seeds this thread took. */
+    uint64_t nextFileSeed;
+    /** The index just after the last seed this thread took from the seed file. */
+    uint64_t endFileSeed;
+    /** The batch being extrapolated, when using the seed queue. */
+    SeedBatch *batch;
+    /** Pointer to the next seed in the batch. */
+    packedSequence *seedPtr;
+    /** Returns how many seeds this thread extrapolated. Kept up to date after every seed, for the stats. */
+    unsigned long long numSeeds;
+    /** Returns how many relabelings of its seeds this thread hashed. Always 0 counting stabilizers. Kept up to date too. */
+    unsigned long long numPermutations;
+    /** Returns how many seconds this thread took, start to finish. */
+    double seconds;
+    /** Returns how many of those seconds it spent waiting on the seed queue. */
+    double waitSeconds;
+    /** Returns the amount of grey codes extrapolated. Kept up to date too. */
     unsigned long long numGreyCodes;
-    /** Used to pass in a pointer to the queue so it only has to be made once. */
-    step (*queueStepPointer)[2];
+    /** Whether to not print the thread's total at the end, for the benchmarks. */
+    bool quiet;
+    /** Where the number of codes each seed from the seed file makes goes, by its index in the file, or NULL to not keep
+     * them. Every thread shares the same array, and each seed's spot is only written by the thread that took it. */
+    unsigned long long *seedCodes;
+    /** Used to pass in a pointer to the table of all the relabelings so it only has to be made once. */
+    const PermutationTable *permutations;
+    #ifndef FIXED_WIDTH_KEYS
     /** Used to pass in a pointer to the multiples lookup table so it only has to be made once. */
     mpz_t *multiplesTablePointer;
-    /** Simple boolean for if the function should call pthread_exit after it's done or not. */
-    bool exitOrNo;
+    #endif
+    /** The NUMA nodes to pin the thread to, or NULL to not pin it. */
+    const NumaTopology *numa;
+    /** The node the thread is pinned to, whose batches it pops first. 0 if not placing the threads. */
+    int numaNode;
+    #ifdef GPU_EXTRAPOLATION
+    /** The GPU to extrapolate on with EXTRAPOLATE_GPU. */
+    const GpuExtrapolator *gpu;
+    #endif
 } ExtrapolateThreadStruct;
 
+/** Everything a distributed worker needs to search and extrapolate the units it's handed, passed through as the context. */
+typedef struct {
+    /** The list of all the tasks. The units are ranges of these. */
+    CodeSearchTask *tasks;
+    /** How many search workers to use. */
+    int numWorkers;
+    /** How many extrapolation threads to use. */
+    int numExtrapolateThreads;
+    /** The table of all n! relabelings for the extrapolation. */
+    const PermutationTable *permutations;
+    #ifndef FIXED_WIDTH_KEYS
+    /** The multiples lookup table for the extrapolation. */
+    mpz_t *multiplesTablePointer;
+    #endif
+    /** The NUMA nodes to pin the threads to, or NULL to not pin them. */
+    const NumaTopology *numa;
+} DistributedWorkerContext;
+
+/** The stages of a run, for the stats. The extrapolation goes alongside the search, so its stage is just what's left of
+ * it after the search is done. */
+typedef enum {
+    STAGE_SETUP,
+    STAGE_SEARCH,
+    STAGE_EXTRAPOLATE,
+    STAGE_DONE,
+    NUM_RUN_STAGES
+} RunStage;
+
+/** The names of the stages in the stats. */
+const char *runStageNames[NUM_RUN_STAGES] = {"setup", "search", "extrapolate", "done"};
+
+/** Everything the stats writer needs. main fills it in as the run goes along, see writeRunStats. */
+typedef struct {
+    /** Where to write the lines, or NULL if the stats aren't being written. Only the wall times get kept then. */
+    FILE *file;
+    /** How many seconds between lines. */
+    int interval;
+    /** The wall time the run started at, see getWallSeconds. Every time in the stats is from this. */
+    double startSeconds;
+    /** When each stage started. The ones that get skipped start and end at the same time. */
+    double stageStarts[NUM_RUN_STAGES];
+    /** Which stage the run is in now. */
+    int stage;
+    /** The search, once it's started, or NULL if there isn't one. */
+    CodeSearchContext *searchContext;
+    /** The extrapolation threads. */
+    ExtrapolateThreadStruct *extrapolateThreads;
+    /** How many extrapolation threads there are. */
+    int numExtrapolateThreads;
+    /** Lock for stopping the writer. */
+    pthread_mutex_t lock;
+    /** Signaled to wake the writer up early when the run is done. */
+    pthread_cond_t stop;
+    /** Set once the run is done and the writer should stop. */
+    bool done;
+} RunStats;
+
 
 
 /** This global variable is generated and written to in main and used by each of the threads so they don't have to all compute it again. */
@@ -93,6 +446,20 @@ unsigned long long queueSize;
 
 
 
+/**
+ * Gets the time in seconds, for timing the threads. Unlike clock(), this is the actual time that went by, not the CPU
+ * time of every thread added up.
+ * @return The time in seconds from the monotonic clock.
+*/
+double getWallSeconds()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + (now.tv_nsec / 1e9);
+}
+
+
+
 /**
  * (Extrapolating) Calculates the sequence number for the given sequence. Will set rtn to 0 first.
  * @param sequence The sequence to get the number for.
@@ -113,40 +480,70 @@ void getSequenceNumber(step *sequence, sequenceNum rtn)
 
 
 /**
- * (Extrapolating) Performs a swap in a sequence. Goes through the sequence and whenever it sees a, it writes b and when it sees b it writes a.
- * @param seq The sequence array.
- * @param a The first step digit number to swap.
- * @param b The other step digit number to swap.
- * @param limit How many steps to look at. For normal sequences is len.
+ * (Extrapolating) Finds the rotation of a sequence that's the lowest, step by step, so every rotation of a sequence has
+ * the same one. This is for the GMP sequenceNums, the fixed width keys just use getLeastRotationKey. It's the two
+ * pointer way of doing it: i and j are the two rotations that could still be the lowest, and they're compared k steps
+ * in until they differ. Whichever one is higher can't be the lowest, and neither can any of the k rotations after it,
+ * since each one of those is beaten by the same rotation after the other, so it jumps past them all. That makes it at
+ * most about 2 * len comparisons, instead of comparing all len rotations.
+ * @param doubled The sequence twice, 2 * len steps long, so every rotation can be read straight through.
+ * @return Where the lowest rotation starts, from 0 to len - 1.
 */
-void swap(step *seq, step a, step b, int limit)
+static inline int getLeastRotation(const step *doubled)
 {
-    while(limit) {
-        if(*seq == a) *seq = b;
-        else if(*seq == b) *seq = a;
-        seq++;
-        limit--;
+    int i = 0, j = 1, k = 0;
+    while(i < len && j < len && k < len) {
+        step a = doubled[i + k], b = doubled[j + k];
+        if(a == b) {
+            k++;
+            continue;
+        }
+        if(a > b) i += k + 1;
+        else j += k + 1;
+        if(i == j) j++;
+        k = 0;
     }
+    return i < j ? i : j;
 }
 
 
 
 /**
- * (Seed Searching) Performs a swap in a sequence of stepMasks. Goes through the sequence and whenever it sees a,
- * it writes b and when it sees b it writes a.
- * @param seq The sequence array.
- * @param a The first step digit number to swap.
- * @param b The other step digit number to swap.
- * @param limit How many steps to look at. For normal sequences is len.
+ * (Extrapolating) Finds how many grey codes a seed makes by counting its stabilizer instead of hashing its permutations.
+ * The codes a seed makes are everything reachable by one of the n! relabelings and one of the len rotations, so there are
+ * n! * len / (the number of (relabeling, rotation) pairs that map the seed back onto itself). Every digit shows up in a
+ * grey code, so for each rotation there's at most one relabeling that could work, and it gets built up step by step as
+ * the rotation is walked. Most rotations fail within the first few steps.
+ * This only counts relabelings and rotations, the same as the search does, so reversals are not part of the group.
+ * @param seq The seed, len steps long.
+ * @return The number of grey codes the seed makes.
 */
-void swapMasks(stepMask *seq, stepMask a, stepMask b, int limit)
+unsigned long long countCodesByStabilizer(const step *seq)
 {
-    while(limit) {
-        if(*seq == a) *seq = b;
-        else if(*seq == b) *seq = a;
-        seq++;
-        limit--;
+    step doubled[len * 2];                 // The seed twice so every rotation can be read straight through.
+    step relabel[NUM_DIGITS];              // The relabeling being built up for the current rotation. NUM_DIGITS means not set yet.
+    unsigned int usedLabels;               // Bitmask of the digits that something has been relabeled to already.
+    unsigned long long stabilizerSize = 0; // How many rotations have a relabeling that maps them back onto the seed.
+    int i;
+
+    memcpy(doubled, seq, sizeof(step) * len);
+    memcpy(doubled + len, seq, sizeof(step) * len);
+
+    for(const step *rotation = doubled; rotation < doubled + len; rotation++) {
+        memset(relabel, NUM_DIGITS, sizeof(relabel));
+        usedLabels = 0;
+        for(i = 0; i < len; i++) {
+            if(relabel[rotation[i]] == NUM_DIGITS) {
+                // First time seeing this digit, it has to be relabeled to the seed's digit, if that one's free
+                if(usedLabels & (1 << seq[i])) break;
+                relabel[rotation[i]] = seq[i];
+                usedLabels |= (1 << seq[i]);
+            } else if(relabel[rotation[i]] != seq[i]) break;
+        }
+        if(i == len) stabilizerSize++;
     }
+
+    return (queueSize * len) / stabilizerSize;
 }
 
 
@@ -154,14 +551,14 @@ void swapMasks(stepMask *seq, stepMask a, stepMask b, int limit)
 /**
  * This is a recursive function that will add the necessary swaps to the queue to go through all the possible permutations.
  * This function returns how many total swaps were added to the queue.
- * This function takes in a queue of steps, not stepMasks.
+ * This function takes in a queue of stepMasks, not steps.
  * @param n How many digits to be swapping. 2 is the base case of just one swap, 3 is swapping to get all permutations of 3 digits, etc.
  * @param queueIndexToAddFrom The index in the queue where new swaps should be added.
  * @param queue Reference to the queue array.
  * @param indicesToSwap Essentially the parameters of this function. Which digit numbers to swap. Length of this should equal n.
  * @return The total amount of swaps added to the queue during the calling of this function.
 */
-int addQueueSwaps(int n, int queueIndexToAddFrom, step (*queue)[2], unsigned int indicesToSwap[])
+int addQueueSwapsMasks(int n, int queueIndexToAddFrom, stepMask (*queue)[2], unsigned int indicesToSwap[])
 {   
     // Base case of n == 2, just one swap
     if(n == 2) {
@@ -185,7 +582,7 @@ int addQueueSwaps(int n, int queueIndexToAddFrom, step (*queue)[2], unsigned int
     for(int i = n - 1; i > 0; i--) {
 
         // Do the recursive call, getting all the swaps for one layer down
-        currentIndexToAddFrom += addQueueSwaps(n - 1, currentIndexToAddFrom, queue, recursiveIndices);
+        currentIndexToAddFrom += addQueueSwapsMasks(n - 1, currentIndexToAddFrom, queue, recursiveIndices);
 
         // Otherwise, we add a swap from i to i-1
         queue[currentIndexToAddFrom][0] = indicesToSwap[i];
@@ -197,7 +594,7 @@ int addQueueSwaps(int n, int queueIndexToAddFrom, step (*queue)[2], unsigned int
     }
 
     // Do one last adding of swaps for when i = 0
-    currentIndexToAddFrom += addQueueSwaps(n - 1, currentIndexToAddFrom, queue, recursiveIndices);
+    currentIndexToAddFrom += addQueueSwapsMasks(n - 1, currentIndexToAddFrom, queue, recursiveIndices);
 
     // Now we have added all the swaps we were going to, go ahead and return how many we added
     return (currentIndexToAddFrom - queueIndexToAddFrom);
@@ -206,153 +603,313 @@ int addQueueSwaps(int n, int queueIndexToAddFrom, step (*queue)[2], unsigned int
 
 
 /**
- * This is a recursive function that will add the necessary swaps to the queue to go through all the possible permutations.
- * This function returns how many total swaps were added to the queue.
- * This function takes in a queue of stepMasks, not steps.
- * @param n How many digits to be swapping. 2 is the base case of just one swap, 3 is swapping to get all permutations of 3 digits, etc.
- * @param queueIndexToAddFrom The index in the queue where new swaps should be added.
- * @param queue Reference to the queue array.
- * @param indicesToSwap Essentially the parameters of this function. Which digit numbers to swap. Length of this should equal n.
- * @return The total amount of swaps added to the queue during the calling of this function.
+ * (Code Search) Publishes where a search worker is, for the checkpoints. Appends every seed in the worker's batch that
+ * isn't in the seed file yet, then records the position, all while holding the worker's publishLock. So at any time,
+ * the seed file has exactly the seeds each worker found up to its published position.
+ * @param worker The worker publishing.
+ * @param test The code the worker just finished with, or NULL if the task is done.
+ * @param taskDone True if the worker just finished its whole task.
 */
-int addQueueSwapsMasks(int n, int queueIndexToAddFrom, stepMask (*queue)[2], unsigned int indicesToSwap[])
-{   
-    // Base case of n == 2, just one swap
-    if(n == 2) {
-        queue[queueIndexToAddFrom][0] = indicesToSwap[0];
-        queue[queueIndexToAddFrom][1] = indicesToSwap[1];
-        return 1;
-    } else if(n <= 1) return 0; // if n less than 2, no swaps.
+void publishSearchPosition(CodeSearchWorker *worker, const stepMask *test, bool taskDone)
+{
+    pthread_mutex_lock(&(worker->publishLock));
+
+    // Save the seeds that are new since last time
+    appendSeedsToStore(worker->seedStore, worker->batch->seeds + worker->storedInBatch, worker->batch->count - worker->storedInBatch);
+    worker->storedInBatch = worker->batch->count;
+
+    // Then where we are
+    if(taskDone) {
+        worker->completedTasks[worker->published.taskIndex] = 1;
+        worker->published.taskIndex = -1;
+        worker->published.hasPosition = 0;
+    } else {
+        for(int i = 0; i < len; i++)
+            worker->published.position[i] = log2(test[i]);
+        worker->published.hasPosition = 1;
+    }
+    worker->seenEpoch = __atomic_load_n(worker->checkpointEpoch, __ATOMIC_RELAXED);
 
-    // Otherwise, we are n >= 3, so we do recursion
-    // Initialize the index to add from to be the one we know is safe
-    int currentIndexToAddFrom = queueIndexToAddFrom;
+    pthread_mutex_unlock(&(worker->publishLock));
+}
 
-    // Initialize the new parameters to be all the ones we were given but leaving out the last one.
-    unsigned int recursiveIndices[n - 1];
-    for(int i = 0; i < n - 1; i++) {
-        recursiveIndices[i] = indicesToSwap[i];
+
+
+/**
+ * (Code Search) Checks if the partial code in the test, up to and including position, already has a rotation that can be
+ * relabeled to be lower than it, whatever the rest of the code turns out to be. If so, none of the codes that start
+ * like this are seeds, so the search doesn't have to look at any of them. It only compares steps that are already there
+ * and doesn't wrap around, so it never skips anything the seed check at the end would have kept.
+ * Every position's list of matches has to be made, in order, before the next one is checked.
+ * @param prefixClass The class of the task being searched.
+ * @param matches The lists of matches, which the list for this position is written to.
+ * @param test The test array, set up to position.
+ * @param equalities The equalities of each step in the test, from getStepEqualities, set up to position.
+ * @param position The step that was just set.
+ * @return True if the partial code has a lower rotation, so it can be skipped.
+*/
+static inline bool isPartialCodeLower(const PrefixClass *prefixClass, PartialCodeMatches *matches, const stepMask *test,
+                                      const unsigned int *equalities, int position)
+{
+    const int numSetSteps = prefixClass->numSetSteps;
+    const int queueLen = prefixClass->queueLen;
+    const int digit = log2(test[position]);                                   // The digit of the new step
+    int *live = matches->live;
+    int next = matches->liveStart[position];                                  // Where the next match for this position goes
+
+    // Carry on the matches from the last position, comparing the new step
+    if(position > 0) {
+        for(int m = matches->liveStart[position - 1]; m < matches->liveStart[position]; m++) {
+            stepMask relabeled = matches->relabels[live[m]][digit];
+            stepMask original = test[position - live[m] / queueLen];
+            if(relabeled < original) return true;
+            if(relabeled == original) live[next++] = live[m];
+        }
     }
 
-    // Recurse through all the values in the indices to swap, 
-    //    each of them getting a turn being left out of the recursive call, starting with the last one.
-    for(int i = n - 1; i > 0; i--) {
+    // Then the rotation whose first step to compare is this one, if it can be relabeled to the class's set start
+    int rotation = position - numSetSteps;
+    if(rotation >= 0 && getWindowSignature(equalities + position - 1) == prefixClass->signature) {
+        stepMask relabel[1 << NUM_DIGITS];
+        for(int d = 0; d < NUM_DIGITS; d++)
+            relabel[1 << d] = 1 << d;
+        for(int i = 0; i < numSetSteps; i++)
+            if(relabel[test[rotation + i]] != prefixClass->setSteps[i])
+                swapRelabel(relabel, relabel[test[rotation + i]], prefixClass->setSteps[i]);
+
+        // The same extra swaps as the seed check, one after another
+        for(int extra = 0; extra < queueLen; extra++) {
+            if(extra) swapRelabel(relabel, prefixClass->queueStepPointer[extra][0], prefixClass->queueStepPointer[extra][1]);
+            // No rotation and no swaps is just the code itself
+            if(!rotation && !extra) continue;
+
+            int match = rotation * queueLen + extra;
+            for(int d = 0; d < NUM_DIGITS; d++)
+                matches->relabels[match][d] = relabel[1 << d];
+            stepMask relabeled = relabel[test[position]];
+            if(relabeled < test[numSetSteps]) return true;
+            if(relabeled == test[numSetSteps]) live[next++] = match;
+        }
+    }
 
-        // Do the recursive call, getting all the swaps for one layer down
-        currentIndexToAddFrom += addQueueSwapsMasks(n - 1, currentIndexToAddFrom, queue, recursiveIndices);
+    matches->liveStart[position + 1] = next;
+    return false;
+}
 
-        // Otherwise, we add a swap from i to i-1
-        queue[currentIndexToAddFrom][0] = indicesToSwap[i];
-        queue[currentIndexToAddFrom][1] = indicesToSwap[i - 1];
-        currentIndexToAddFrom++;
 
-        // Then, switch i and i-1 in the recursive indices so now i is being included again in the swaps the next loop.
-        recursiveIndices[i - 1] = indicesToSwap[i];
+
+/**
+ * (Code Search) Checks if a whole code the search found is a seed, which is when none of its rotations can be relabeled
+ * to be lower than it. Nothing is swapped, the swaps are done on the relabeling instead and the rotation is relabeled
+ * as it's compared, so most of the checks are over after a few steps. Shared by both searches.
+ * @param prefixClass The class of the task being searched.
+ * @param test The whole code, with the class's set steps after it again for looking across the rotation.
+ * @param equalities The equalities of the code's steps, from getStepEqualities. The ones for the windows that reach
+ *                   across the rotation get added on the end.
+ * @param specialChecks Whether the class has lower checks to do, the same as its hasLower.
+ * @return True if it's a seed.
+*/
+static inline __attribute__((always_inline)) bool isSeedCode(const PrefixClass *prefixClass, const stepMask *test,
+                                                             unsigned int *equalities, const bool specialChecks)
+{
+    const int numSetSteps = PREFIX_CLASS_STEPS;
+    stepMask relabel[1 << NUM_DIGITS];                                         // The relabeling of the digits that takes a rotation to the class's set start, indexed by stepMask.
+    stepMask (*qPtr)[2];                                                       // Pointer to inside the queue.
+
+    // Get the equalities of the windows that reach across the rotation, and if we are a special class, do an extra
+    //    check on them. There could be something that reaches across a rotation.
+    for(int i = len - 1; i < len + numSetSteps - 1; i++) {
+        equalities[i] = getStepEqualities(test + i, numSetSteps - 1);
+        if(specialChecks && isLowerSignature(prefixClass, getWindowSignature(equalities + i))) return false;
     }
 
-    // Do one last adding of swaps for when i = 0
-    currentIndexToAddFrom += addQueueSwapsMasks(n - 1, currentIndexToAddFrom, queue, recursiveIndices);
+    for(int rotation = 0; rotation < len; rotation++) {
 
-    // Now we have added all the swaps we were going to, go ahead and return how many we added
-    return (currentIndexToAddFrom - queueIndexToAddFrom);
+        // Go through rotations until finding a start that could be swapped
+        if(getWindowSignature(equalities + rotation + numSetSteps - 1) != prefixClass->signature) continue;
+
+        // Now make the relabeling that takes it to the class's set start
+        for(int d = 0; d < NUM_DIGITS; d++)
+            relabel[1 << d] = 1 << d;
+        for(int i = 0; i < numSetSteps; i++)
+            if(relabel[test[rotation + i]] != prefixClass->setSteps[i])
+                swapRelabel(relabel, relabel[test[rotation + i]], prefixClass->setSteps[i]);
+
+        // Now it matches the start of the class, which is the start of the test too. Check if the rest is lower.
+        if(isRelabelLower(test, rotation, relabel, numSetSteps)) return false;
+
+        // Do all the extra swaps we have to do (if any)
+        qPtr = prefixClass->queueStepPointer + 1;
+        while(qPtr - prefixClass->queueStepPointer < prefixClass->queueLen) {
+            // We have an extra swap to do. Do the swap, then check if it's lower
+            swapRelabel(relabel, (*qPtr)[0], (*qPtr)[1]);
+            if(isRelabelLower(test, rotation, relabel, numSetSteps)) return false;
+            qPtr++; // Increment
+        }
+    }
+    return true;
 }
 
 
 
 /**
- * This function returns true if the first argument, beingTested, is lower in terms
- * of sequence number than the second argument, original. If they are equal, false
- * is returned, as it is not strictly lower.
- * @param beingTested The first sequence.
- * @param original The second sequence.
- * @return True if the first is lower than the second. If true, the second is not a seed.
- */
-bool isLower(stepMask *beingTested, stepMask *original)
+ * (Code Search) Adds what the search has counted since last time into the worker's stats, and starts the count over.
+ * Each one is stored in one go, so the stats writer never sees half of an update.
+ * @param worker The CodeSearchWorker running the search.
+ * @param counts What the search has counted.
+*/
+static inline void addSearchStats(CodeSearchWorker *worker, SearchStats *counts)
 {
-    register int limit = len;
-    while(limit && *beingTested == *original) {
-        original++;
-        beingTested++;
-        limit--;
-    }
-    return limit && *beingTested < *original;
+    __atomic_store_n(&(worker->stats.nodes), worker->stats.nodes + counts->nodes, __ATOMIC_RELAXED);
+    __atomic_store_n(&(worker->stats.pruned), worker->stats.pruned + counts->pruned, __ATOMIC_RELAXED);
+    __atomic_store_n(&(worker->stats.codes), worker->stats.codes + counts->codes, __ATOMIC_RELAXED);
+    memset(counts, 0, sizeof(SearchStats));
 }
 
 
 
+/**
+ * (Code Search) Adds a seed the search found to the worker's batch and counts it. Once the batch is full, it's handed
+ * off to the extrapolation threads and a new one is started.
+ * @param worker The CodeSearchWorker that found the seed.
+ * @param prefixClass The class of the task the seed was found in.
+ * @param test The seed.
+*/
+static inline void addSeed(CodeSearchWorker *worker, const PrefixClass *prefixClass, const stepMask *test)
+{
+    unsigned long long *classSeeds = worker->classSeeds + prefixClass->classIndex; // The worker's count of seeds for this class.
+
+    // Pack it into the next spot in the batch
+    packStepMasks(test, worker->batch->seeds[worker->batch->count]);
+
+    // If checking for duplicates, make sure nobody found it already
+    if(worker->seenSeeds != NULL && !seqHashInsertIfNotContains(worker->seenSeeds, worker->batch->seeds[worker->batch->count])) {
+        // All in one printf so the other workers' lines don't get mixed in
+        char digits[len * 2];
+        for(int j = 0; j < len; j++) {
+            digits[j * 2] = '0' + log2(test[j]);
+            digits[j * 2 + 1] = j != len - 1 ? ',' : '\0';
+        }
+        worker->duplicates++;
+        printf("Seed found twice: %s\n", digits);
+    }
+
+    // If only dumping the seeds, this is where they go
+    if(worker->codeDump != NULL && worker->codeDump->options->seedsOnly) appendCodeDump(worker->codeDump, test);
+
+    // A new seed has been added to the batch, increase the counts.
+    worker->batch->count++;
+    __atomic_store_n(&(worker->count), worker->count + 1, __ATOMIC_RELAXED);
+    (*classSeeds)++;
+
+    // If the batch is full, save it, then hand it off to the extrapolation threads and start a new one. If nothing's
+    //    extrapolating, the same batch just gets filled again.
+    if(worker->batch->count == SEED_BATCH_SIZE) {
+        if(worker->seedStore != NULL) publishSearchPosition(worker, test, false);
+        if(worker->seedQueue != NULL) {
+            pushSeedBatch(worker->seedQueue, worker->batch);
+            worker->batch = acquireSeedBatch(worker->seedArena);
+        } else
+            worker->batch->count = 0;
+        worker->storedInBatch = 0;
+    }
+}
 
 
 
 /**
- * (Code Search) This function calculates the count of how many grey codes begin with a given start step number. This is used
- * as the function ran by several threads. The parameter is a void pointer that initially points to the step number 
- * to start at, but at the end is used to return the final count for this digit.
- * @param threadVal The pointer to the CodeSearchThreadStruct for this thread. The count variable should hold the specific stepMask for this thread.
- * @return Nothing, but a void * return type is necessary to make the thread. 
+ * (Code Search) This function finds all the seeds that begin with the given task's set steps, and adds them to the
+ * worker's seed list. It's always inlined into calculateCodesWithSetStart with specialChecks as a constant, so there's a
+ * copy of the search for the classes with lower checks and one for the lowest class without any, and neither one has
+ * to check which it is on every step. Everything else about it is fixed by NUM_DIGITS and PREFIX_CLASS_STEPS.
+ * @param worker The CodeSearchWorker running this task. Its seed list and counts are added to.
+ * @param task The CodeSearchTask to search. Once one of its set steps would change, the task is done.
+ * @param resumeFrom The last code that was finished with in this task before a checkpoint, as digit numbers, to carry
+ *                   on from right after it. NULL to start the task from the beginning.
+ * @param specialChecks Whether the class has lower checks to do, the same as its hasLower.
 */
-void *calculateCodesWithSetStart(void *threadVal)
+static inline __attribute__((always_inline)) void searchCodesWithSetStart(CodeSearchWorker *worker, const CodeSearchTask *task,
+                                                                         const step *resumeFrom, const bool specialChecks)
 {
     // Variables
-    CodeSearchThreadStruct *threadStruct = ((CodeSearchThreadStruct *)threadVal); // Recasting to a different kind of pointer for convenience.
-    stepMask test[len + threadStruct->stepsBack];                              // The step array. This holds steps, which are unsigned characters, that represent which binary digit is being switched during that step.
+    const PrefixClass *prefixClass  = task->prefixClass;                       // The prefix class of this task, which the seed checks are done with.
+    const int numSetSteps           = PREFIX_CLASS_STEPS;                      // The number of set steps for this class.
+    stepMask test[len + PREFIX_CLASS_STEPS];                                   // The step array. This holds steps, which are unsigned characters, that represent which binary digit is being switched during that step. The class's set steps are after the end again, for looking across a rotation.
     stepMask *sptr                  = test;                                    // Pointer to a step within the test array. Used for looping through
-    stepMask * const testEnd        = test + len + threadStruct->stepsBack;    // Pointer to just after the test array
+    unsigned int equalities[len + PREFIX_CLASS_STEPS];                         // Which of the steps before each step in the test are the same as it, for the window signatures.
     int bffr[len + 1];                                                         // This is the buffer that holds the values generated by actually performing the grey code sequence for testing it.
     int * const buf                 = bffr + 1;                                // Pointer to the "start" of the grey code. Since the first 0 never changes, but is used when calculating values, we start the pointer one val in.
     int *bptr                       = buf;                                     // Pointer to within the buffer. Used for looping through.
     int * const bufEndPtr           = buf + len - 1;                           // Points to the ending 0 in valid grey codes.
     bool flags[len]                 = {};                                      // This keeps track of if a number (the number of the index) has been reached in the sequence yet or not
-    int numSetSteps                 = threadStruct->count;                     // The number of set steps for this thread.
-    int setStepsCounter;                                                       // Counter used in looping to count to numSetSteps.
-    stepMask * const limitStep      = test + numSetSteps - 1;                  // This is which step is being limited, as in when it changes then this thread is done and returns its count.
-    step *copyingSeq;                                                          // Pointer to the start of an allocated that is being copied into.
-    step *arraySeqPtr;                                                         // Pointer to inside an allocated sequence. Used to copy in the log2s of test.
-    stepMask *testCopyPtr;                                                     // Pointer to inside test that is used to copy the log2s of the stepMasks into the allocated sequence.
-    bool specialChecks              = threadStruct->checkStepsLower != NULL;   // boolean for if the special checks should be done or not.
-    stepMask sequenceCopy[len * 2];                                            // Array to hold the sequence twice to do rotations.
-    stepMask *permPtr;                                                         // Pointer in the test for seeds that finds relevant rotations (Starting with 0)
-    stepMask (*qPtr)[2];                                                       // Pointer to inside the queue.
-    
-
-    // Allocate the array that the seeds will be held in
-    int seedListCapacity = 256;            // The total capacity of the array. If this is reached, the array is reallocated.
-    int seedListSize = 0;                  // The size of the array, as in the actual number of elements held, and the number of sequences found.
-    threadStruct->seeds = (sequence **)malloc(sizeof(sequence *) * seedListCapacity);
+    stepMask * const firstFreeStep  = test + task->numSetSteps;                // The first step the task is allowed to change. Once the search backs up past this, the task is done.
+    PartialCodeMatches matches;                                                // The rotations that could still be lower than the partial code, for skipping it early.
+    SearchStats counts              = {};                                      // What's been counted since the last code, for the worker's stats.
 
     // The first value of the buffer is an unchanging 0
     bffr[0] = 0;
 
+    // Room for every rotation and extra swap to match at every step, which is way more than there ever are
+    matches.relabels = malloc(sizeof(*matches.relabels) * len * prefixClass->queueLen);
+    matches.live = malloc(sizeof(int) * ((len * (len + 1)) / 2) * prefixClass->queueLen);
+    matches.liveStart = malloc(sizeof(int) * (len + 1));
+    matches.liveStart[0] = 0;
+
     // Initialize the test to the set steps, then the lowest array after that.
-    stepMask limitStepValue = threadStruct->setSteps[numSetSteps - 1];
-    step limitStepLog = log2(limitStepValue);
-    memcpy(test, threadStruct->setSteps, sizeof(stepMask) * numSetSteps);
-    memcpy(test + numSetSteps, lowest, (len - numSetSteps) * sizeof(stepMask));
-    memcpy(test + len, threadStruct->setSteps, sizeof(stepMask) * (threadStruct->stepsBack));
+    memcpy(test, task->setSteps, sizeof(stepMask) * task->numSetSteps);
+    memcpy(test + task->numSetSteps, lowest, (len - task->numSetSteps) * sizeof(stepMask));
+    memcpy(test + len, prefixClass->setSteps, sizeof(stepMask) * numSetSteps);
 
     // I can start the loop already past the set start to eliminate the need to check 
-    //    if we are far enough in the test array to do the backwards thread checks
-    while(sptr - test < numSetSteps) {
+    //    if we are far enough in the test array to do the backwards class checks
+    while(sptr < firstFreeStep) {
 
         // Calculate the next number in the sequence.
         *bptr = *(bptr - 1) ^ (*sptr);
 
         // It's guaranteed valid, mark the number
         flags[*bptr] = true;
+        equalities[sptr - test] = getStepEqualities(sptr, sptr - test < numSetSteps - 1 ? sptr - test : numSetSteps - 1);
+
+        // If even the set steps have a lower rotation, there aren't any seeds in this task at all
+        if(isPartialCodeLower(prefixClass, &matches, test, equalities, sptr - test)) goto taskDone;
 
         // Go to the next step
         sptr++;
         bptr++;
     }
+
+    // If resuming, put the code from the checkpoint in test, and rebuild the buffer and the flags from it the same way.
+    //    It's a valid code, so it can go straight to skipAdding to increment past it like it was just found.
+    if(resumeFrom != NULL) {
+        for(int i = 0; i < len; i++)
+            test[i] = 1 << resumeFrom[i];
+        while(sptr < test + len - 1) {
+            *bptr = *(bptr - 1) ^ (*sptr);
+            equalities[sptr - test] = getStepEqualities(sptr, numSetSteps - 1);
+            // The checkpoint could be from before the search skipped partial codes, so skip from here if it would have
+            if(isPartialCodeLower(prefixClass, &matches, test, equalities, sptr - test)) goto increment;
+            flags[*bptr] = true;
+            sptr++;
+            bptr++;
+        }
+        *bptr = 0;
+        goto skipAdding;
+    }
     
-    // Loop until the limit step is changed from the starting value. Then we know we have all the codes with that set step.
-    while(*limitStep == limitStepValue) {
+    // Loop until one of the set steps would have to change. Then we know we have all the codes with the task's set steps.
+    while(true) {
 
         // -- Checking if it is a valid grey code sequence.
         // For every changed value in the steps, until reaching a 0.
         while(true) {
             
-            // Do the special thread-specific check.
-            if(specialChecks && (threadStruct->checkStepsLower(sptr))) goto increment;
+            // Do the special class-specific check, on the window of steps ending here.
+            equalities[sptr - test] = getStepEqualities(sptr, numSetSteps - 1);
+            if(specialChecks && isLowerSignature(prefixClass, getWindowSignature(equalities + (sptr - test)))) {
+                counts.pruned++;
+                goto increment;
+            }
 
             // Calculate the next number in the sequence.
             *bptr = *(bptr - 1) ^ (*sptr);
@@ -365,8 +922,15 @@ void *calculateCodesWithSetStart(void *threadVal)
             // Check if this number has already been reached.
             if(flags[*bptr]) goto increment;
 
+            // Check if what there is of the code so far already has a lower rotation, then none of its codes are seeds.
+            if(isPartialCodeLower(prefixClass, &matches, test, equalities, sptr - test)) {
+                counts.pruned++;
+                goto increment;
+            }
+
             // If it has passed all that, it's valid, mark the number as reached.
             flags[*bptr] = true;
+            counts.nodes++;
 
             // Go to the next step
             sptr++;
@@ -374,85 +938,21 @@ void *calculateCodesWithSetStart(void *threadVal)
         }
         
         // 0 has been reached, there were no duplicates and it's the right length, so we have reached a valid grey code.
-        // If we are a special thread, do an extra check. There could be something that reaches across a rotation.
-        if(specialChecks) {
-            testCopyPtr = sptr;
-            while(testCopyPtr < testEnd)
-                if(threadStruct->checkStepsLower(testCopyPtr++))
-                    goto skipAdding;
-        }
-        
-        // Check if it is has a lower permutation. If so, skip adding it as it is not a seed.
-        memcpy(sequenceCopy, test, sizeof(stepMask) * len);
-        memcpy(sequenceCopy + len, sequenceCopy, sizeof(stepMask) * len); // Copy again into the second half
-        permPtr = sequenceCopy;
-        while(permPtr - sequenceCopy < len) {
-
-            // Go through rotations until finding a start that could be swapped
-            if(!threadStruct->checkStepsIn(permPtr)) {
-                permPtr++;
-                continue;
-            }
-
-            // Now swap until it matches the threads set start
-            for(setStepsCounter = 0; setStepsCounter < numSetSteps; setStepsCounter++)
-                if(permPtr[setStepsCounter] != threadStruct->setSteps[setStepsCounter])
-                    swapMasks(sequenceCopy, permPtr[setStepsCounter], threadStruct->setSteps[setStepsCounter], len * 2);
-            
-            // Now it matches the start of the thread. Check if it is lower.
-            if(isLower(permPtr, test)) goto skipAdding;
-
-            // Do all the extra swaps we have to do (if any)
-            qPtr = threadStruct->queueStepPointer + 1;
-            while(qPtr - threadStruct->queueStepPointer < threadStruct->queueLen) {
-                // We have an extra swap to do. Do the swap, then check if it's lower
-                swapMasks(sequenceCopy, (*qPtr)[0], (*qPtr)[1], len * 2);
-                if(isLower(permPtr, test)) goto skipAdding;
-                qPtr++; // Increment
-            }
-
-            permPtr++; // Increment
-        }
-
-        // If here, then it is officially a new seed.
-        // Make sure the array has room, resize if necessary
-        if(seedListSize == seedListCapacity) {
-            seedListCapacity *= 2;
-            threadStruct->seeds = (seqPtrArray)realloc(threadStruct->seeds, sizeof(sequence *) * seedListCapacity);
-        }
-
-        // Now allocate for the seed and copy it over
-        threadStruct->seeds[seedListSize] = (sequence *)malloc(sizeof(sequence));
-        testCopyPtr = test;
-        copyingSeq = *(threadStruct->seeds[seedListSize]);
-        for(arraySeqPtr = copyingSeq; arraySeqPtr - copyingSeq < len; arraySeqPtr++, testCopyPtr++)
-            *arraySeqPtr = log2(*testCopyPtr);
-        
-        // A new seed has been added to the array, increase the size.
-        seedListSize++;
-
-        #if NUM_DIGITS == 6
-        // For printing out the number of seeds intermittently in 6 digits
-        if((numSetSteps == 5 && 
-                    ((limitStepLog == 0 && (seedListSize & 0x7FFFF) == 0) ||
-                    (limitStepLog == 1 && (seedListSize & 0x7FFFF) == 0) ||
-                    (limitStepLog == 3 && (seedListSize & 0x01FF) == 0)
-                    )) 
-                || (numSetSteps == 4 &&
-                    ((limitStepLog == 0 && (seedListSize & 0x0FF) == 0) ||
-                    (limitStepLog == 3 && (seedListSize & 0x07F) == 0)
-                    ))) {
-
-            printf("Thr[%d,%d]Seed:%10d: ", numSetSteps, limitStepLog, seedListSize); 
-            for(int j = 0; j < len; j++) printf(j != len - 1 ? "%d," : "%d\n", copyingSeq[j]);
-        }
-        #endif
-            
+        //    If dumping every code, dump it. If it's a seed, add it.
+        counts.nodes++;
+        counts.codes++;
+        if(worker->codeDump != NULL && !worker->codeDump->options->seedsOnly) appendCodeDump(worker->codeDump, test);
+        if(!isSeedCode(prefixClass, test, equalities, specialChecks)) goto skipAdding;
+        addSeed(worker, prefixClass, test);
 
         // Now to increment. The last three steps in a cyclical grey code are forced, so we will start incrementing three steps back
         //    That means that we can just step the pointers back three steps and let the below incrementing take over
         //    The 0 flag is never actually set to true, so it doesn't need to be reset.
         skipAdding:
+        addSearchStats(worker, &counts);
+        // If a checkpoint is coming up, let it know where we are. This is the only place the whole code is done with.
+        if(worker->seedStore != NULL && __atomic_load_n(worker->checkpointEpoch, __ATOMIC_RELAXED) != worker->seenEpoch)
+            publishSearchPosition(worker, test, false);
         sptr -= 3;   
         flags[*(--bptr)] = false;
         flags[*(--bptr)] = false;
@@ -466,6 +966,9 @@ void *calculateCodesWithSetStart(void *threadVal)
             sptr--;
             flags[*(--bptr)] = false;
         }
+
+        // If that would change one of the set steps, the task is done.
+        if(sptr < firstFreeStep) break;
         (*sptr) <<= 1;
 
         // If we have incremented it to the same as the previous, increment it again.
@@ -476,158 +979,1334 @@ void *calculateCodesWithSetStart(void *threadVal)
         
     }
 
-    // Print the final statistics
-    printf(" ---- Seeds found was %d with %d digits in thread [%d,%d]. \n\n", seedListSize, NUM_DIGITS, numSetSteps, limitStepLog);
+    taskDone:
+    addSearchStats(worker, &counts);
+    free(matches.relabels);
+    free(matches.live);
+    free(matches.liveStart);
+}
 
-    // Return the number of seeds found.
-    threadStruct->count = seedListSize;
 
-    // Exit the thread
-    pthread_exit(NULL);
-    return NULL;
-}
+
+#ifdef BITSET_SEARCH
+/** Every number a code goes through, one bit each, for the bitset search. */
+#define ALL_NUMBERS_VISITED (len == 64 ? ~0ULL : (1ULL << (len & 63)) - 1)
+
+/** One frame of the bitset search's stack, for each position in the code. */
+typedef struct {
+    /** The number the code is at before this position's step. */
+    int value;
+    /** The steps left to try at this position, one bit each. */
+    stepMask untried;
+} SearchFrame;
 
 
 
 /**
- * This is a thread function for extrapolating seeds. Takes in a pointer to a ExtrapolateThreadStruct which has the list
- * of seeds to extrapolate from and how many to extrapolate, and passes out through it the final tally.
- * @param threadVal The ExtrapolateThreadStruct.
- * @return Nothing, but a void * return type is necessary to make the thread.
+ * (Code Search) Gets the steps from the number value to a number that hasn't been reached yet, as a stepMask with a
+ * bit set for each one. visited always has 0 in it, so this never goes back to 0 early, and the step just before always
+ * goes back to a reached number, so it's never the same step twice either.
+ * @param visited The numbers that have been reached, one bit each.
+ * @param value The number the code is at.
+ * @return The unvisited steps.
 */
-void *extrapolateSeeds(void *threadVal)
+static inline stepMask getUnvisitedSteps(uint64_t visited, int value)
 {
+    stepMask steps = 0;
+    for(int d = 0; d < NUM_DIGITS; d++)
+        steps |= (stepMask)((~visited >> (value ^ (1 << d))) & 1) << d;
+    return steps;
+}
 
-    // Variables
-    ExtrapolateThreadStruct *threadStruct = ((ExtrapolateThreadStruct *)threadVal); // Recasting for convenience
-    sequence localSequence;                                                  // A place on the stack to hold a sequence
-    step *stepPtr;                                                           // Pointer to inside the localSequence
-    GMPHashTable *uniquePermutations = createGMPTable((queueSize * 2) + 1);  // The hash table of unique permutations for the seed, size (3 * n!) + 1.
-    sequenceNum originalRotation;                                            // The original sequence number after swapping before doing rotations.
-    sequenceNum currentRotation;                                             // The variable to do the rotation calculations
-    sequence **seedPtr;                                                      // Pointer to inside the seeds list.
-    step (*qPtr)[2];                                                         // Pointer to inside the queue
-    unsigned long long numGreyCodes  = 0;                                    // The final tally of how many grey codes there are.
-    bool rotationallySymmetric;                                              // Whether or not the seed is rotationally symmetric (half as many rotations per permutation)
-    const int numHalves              = __builtin_ctz(queueSize) + 1;         // The number of times n! can be evenly halved plus one.
-    int halves[numHalves];                                                   // The list of the halves of n!, the number of possible unique permutations.
-    int *currentNextHalf;                                                    // Pointer to the next half to be reached in the halves list.
 
-    // Initialize the sequenceNums
-    mpz_init(currentRotation);
-    mpz_init(originalRotation);
 
-    // Initialize the halves list
-    //    This list will have all of the clean halves of itself plus itself normally at the end.
-    //    For example, if the queueSize was 24, then the array would have (3, 6, 12, 24)
-    for(int i = 0; i < numHalves; i++) {
-        halves[i] = (queueSize >> (numHalves - 1 - i));
+/**
+ * (Code Search) Finishes a code that only has its last three steps left. There are only two numbers left to go through
+ * before getting back to 0. Every step flips the parity of the number, and three steps from the end the code is at an
+ * odd one, so the one left with an odd number of 1s has to be last, right before 0, which means it has to be next to 0.
+ * The even one can never be next to 0, so going to whichever one isn't next to 0 first is the only order that can
+ * work. The two can be more than one bit apart though, and the odd one might not be next to 0 at all, so none of the
+ * three steps are sure to be steps. The return value checks that all three are single bits.
+ * @param visited The numbers that have been reached, one bit each. All but two of them.
+ * @param value The number the code is at.
+ * @param last Where the last three steps go.
+ * @return True if all three are single bits, so it finishes into a whole code.
+*/
+static inline bool completeForcedSteps(uint64_t visited, int value, stepMask *last)
+{
+    uint64_t left = ~visited & ALL_NUMBERS_VISITED;                            // The two numbers left
+    int first = __builtin_ctzll(left);
+    int second = __builtin_ctzll(left & (left - 1));
+
+    // Whichever one isn't next to 0 has to be first.
+    if(second & (second - 1)) {
+        int temp = first;
+        first = second;
+        second = temp;
     }
+    last[0] = value ^ first;
+    last[1] = first ^ second;
+    last[2] = second;
+    return !(last[0] & (last[0] - 1)) && !(last[1] & (last[1] - 1)) && !(last[2] & (last[2] - 1));
+}
 
-    // For each seed
-    seedPtr = threadStruct->seeds;
-    while(seedPtr - threadStruct->seeds < threadStruct->numSeedsToExtrapolate) {
-
-        // openPtr is pointing to the seed to analyze, copy it into localSequence
-        memcpy(localSequence, *(*(seedPtr++)), sizeof(sequence));
-
-        // Check for rotational symmetry
-        rotationallySymmetric = memcmp(localSequence, localSequence + (len/2), sizeof(step) * len/2) == 0;
-
-        // Clear the hashTable
-        emptyGMPTable(uniquePermutations);
-
-        // Reset the half tracker
-        currentNextHalf = halves;
-        // printf("With the sequence: ");
-        // for(int j = 0; j < len; j++) printf(j != len - 1 ? "%d," : "%d\n", localSequence[j]);
 
-        // Enter the loop of swaps
-        qPtr = threadStruct->queueStepPointer;
-        while(qPtr - threadStruct->queueStepPointer < queueSize) {
 
-            // Do the next swap on the localSequence
-            swap(localSequence, *(*qPtr), (*qPtr)[1], len);
-            qPtr++;
+/**
+ * (Code Search) The other search engine, picked with -DBITSET_SEARCH. It finds exactly the same seeds in the same order
+ * as searchCodesWithSetStart, and takes the same checkpoints, but it's a stack of frames instead of the test and buffer
+ * pointers. The numbers that have been reached are in one 64 bit word instead of the flags array, and each frame keeps
+ * the steps left to try at its position as a mask of the unvisited neighbours, and takes the lowest one each time with
+ * ctz. So it never looks at a step that goes back to a reached number, and nothing in the test has to be reset from
+ * the lowest code when a step changes. Once there are three steps left they're filled in by completeForcedSteps.
+ * Only up to 6 digits. Compare the two with SearchBenchmark.c.
+ * @param worker The CodeSearchWorker running this task. Its seed list and counts are added to.
+ * @param task The CodeSearchTask to search. Once one of its set steps would change, the task is done.
+ * @param resumeFrom The last code that was finished with in this task before a checkpoint, as digit numbers, to carry
+ *                   on from right after it. NULL to start the task from the beginning.
+ * @param specialChecks Whether the class has lower checks to do, the same as its hasLower.
+*/
+static inline __attribute__((always_inline)) void searchCodesBitset(CodeSearchWorker *worker, const CodeSearchTask *task,
+                                                                   const step *resumeFrom, const bool specialChecks)
+{
+    // Variables
+    const PrefixClass *prefixClass  = task->prefixClass;                       // The prefix class of this task, which the seed checks are done with.
+    const int numSetSteps           = PREFIX_CLASS_STEPS;                      // The number of set steps for this class.
+    const int firstFree             = task->numSetSteps;                       // The first position the task is allowed to change. Once the search backs up past this, the task is done.
+    const int forced                = len - 3;                                 // The first of the three forced steps at the end.
+    stepMask test[len + PREFIX_CLASS_STEPS];                                   // The steps, with the class's set steps after the end again, the same as the other search.
+    unsigned int equalities[len + PREFIX_CLASS_STEPS];                         // Which of the steps before each step in the test are the same as it, for the window signatures.
+    SearchFrame frames[len];                                                   // The stack, one frame for each position up to the forced steps.
+    uint64_t visited                = 1;                                       // The numbers that have been reached, one bit each. 0 is the start, so it's always there.
+    int position;                                                              // The position of the frame on top of the stack.
+    int value;                                                                 // The number the step being tried goes to.
+    PartialCodeMatches matches;                                                // The rotations that could still be lower than the partial code, for skipping it early.
+    SearchStats counts              = {};                                      // What's been counted since the last code, for the worker's stats.
+
+    // Room for every rotation and extra swap to match at every step, which is way more than there ever are
+    matches.relabels = malloc(sizeof(*matches.relabels) * len * prefixClass->queueLen);
+    matches.live = malloc(sizeof(int) * ((len * (len + 1)) / 2) * prefixClass->queueLen);
+    matches.liveStart = malloc(sizeof(int) * (len + 1));
+    matches.liveStart[0] = 0;
+
+    memcpy(test, task->setSteps, sizeof(stepMask) * task->numSetSteps);
+    memcpy(test + len, prefixClass->setSteps, sizeof(stepMask) * numSetSteps);
+
+    // The set steps are guaranteed valid, so just mark their numbers
+    frames[0].value = 0;
+    for(position = 0; position < firstFree; position++) {
+        frames[position + 1].value = frames[position].value ^ test[position];
+        visited |= 1ULL << frames[position + 1].value;
+        equalities[position] = getStepEqualities(test + position, position < numSetSteps - 1 ? position : numSetSteps - 1);
+
+        // If even the set steps have a lower rotation, there aren't any seeds in this task at all
+        if(isPartialCodeLower(prefixClass, &matches, test, equalities, position)) goto taskDone;
+    }
+    frames[position].untried = getUnvisitedSteps(visited, frames[position].value);
+
+    // If resuming, push the code from the checkpoint back on one step at a time, leaving only the steps after it to try
+    //    at each position. It's a valid code, so then it can go straight to codeDone like it was just found.
+    if(resumeFrom != NULL) {
+        for(; position < forced; position++) {
+            test[position] = 1 << resumeFrom[position];
+            frames[position].untried &= ~((test[position] << 1) - 1);
+            equalities[position] = getStepEqualities(test + position, numSetSteps - 1);
+            // The checkpoint could be from before the search skipped partial codes, so skip from here if it would have
+            if(isPartialCodeLower(prefixClass, &matches, test, equalities, position)) break;
+            frames[position + 1].value = frames[position].value ^ test[position];
+            visited |= 1ULL << frames[position + 1].value;
+            if(position + 1 < forced) frames[position + 1].untried = getUnvisitedSteps(visited, frames[position + 1].value);
+        }
+        if(position == forced) {
+            for(int i = forced; i < len; i++)
+                test[i] = 1 << resumeFrom[i];
+            goto codeDone;
+        }
+    }
 
-            // Calculate it's number in originalRotation, copy to currentRotation
-            getSequenceNumber(localSequence, originalRotation);
-            mpz_set(currentRotation, originalRotation);
+    // Loop until one of the set steps would have to change. Then we know we have all the codes with the task's set steps.
+    while(true) {
 
-            // Do rotations until the number matches one of the previous permutations or until we have exhausted all the rotations
-            stepPtr = localSequence;
-            do {
-                // Check if this rotation is equal to any of the unique permutations
-                //    If we find one that is equal, then this permutation is not unique
-                if(GMPHashContains(uniquePermutations, currentRotation)) goto notUniquePermutation;
+        // If there's nothing left to try here, pop back to the last frame and unmark the number its step went to.
+        if(!frames[position].untried) {
+            visited ^= 1ULL << frames[position].value;
+            if(--position < firstFree) break;
+            continue;
+        }
 
-                // Otherwise, rotate the sequence
-                mpz_mul_ui(currentRotation, currentRotation, NUM_DIGITS);
-                mpz_sub(currentRotation, currentRotation, threadStruct->multiplesTablePointer[*(stepPtr++)]);
-            } while(mpz_cmp(currentRotation, originalRotation) != 0);
+        // Take the lowest step left, so the codes come in the same order as the other search.
+        test[position] = frames[position].untried & -frames[position].untried;
+        frames[position].untried ^= test[position];
 
-            // If none of this swap's rotations matched the previous permutations, then it is a unique permutation,
-            //    add it officially to the list.
-            GMPHashInsert(uniquePermutations, originalRotation);
+        // Do the special class-specific check, on the window of steps ending here.
+        equalities[position] = getStepEqualities(test + position, numSetSteps - 1);
+        if(specialChecks && isLowerSignature(prefixClass, getWindowSignature(equalities + position))) {
+            counts.pruned++;
+            continue;
+        }
 
-            // If it matched one of the rotations, then this swap is the same as a previous, we do not need to add it.
-            notUniquePermutation:
-            if(uniquePermutations->count < *currentNextHalf) continue;
-            // If we have reached a half milestone or gone past.
-            // If blown past the half, we don't need to check anymore, increase.
-            if(uniquePermutations->count > *currentNextHalf) {
-                currentNextHalf++;
+        // Check if what there is of the code so far already has a lower rotation, then none of its codes are seeds.
+        if(isPartialCodeLower(prefixClass, &matches, test, equalities, position)) {
+            counts.pruned++;
+            continue;
+        }
 
-                // If we are past half of the possible unique permutations, we know we will get all of them.
-                if(*currentNextHalf == queueSize) {
-                    uniquePermutations->count = queueSize;
-                    break;
-                }
-            } else 
-                // If we are on that half value, to get to the next we need to double, but if
-                //    the number of permutations left to check is less than that, we can't reach the next,
-                //    so we know they must all be not unique, we can skip them all.
-                if(*currentNextHalf > queueSize - (qPtr - threadStruct->queueStepPointer))
-                    break;
-                
+        // Mark the number and push the frame for the next step.
+        counts.nodes++;
+        value = frames[position].value ^ test[position];
+        visited |= 1ULL << value;
+        position++;
+        frames[position].value = value;
+        if(position < forced) {
+            frames[position].untried = getUnvisitedSteps(visited, value);
+            continue;
         }
 
-        // Now we should have added all the rotations from the unique permutations to the total count, we go onto the next seed.
-        numGreyCodes += uniquePermutations->count * (rotationallySymmetric ? len/2 : len);
+        // Only the forced steps are left. If they finish it into a whole grey code, do the window checks on them, and
+        //    if it's a seed, add it. It's skipped if it isn't one, since the seed check would throw it out anyway.
+        if(!completeForcedSteps(visited, value, test + forced)) goto popForced;
+        counts.nodes++;
+        counts.codes++;
+        for(int i = forced; i < len; i++) {
+            equalities[i] = getStepEqualities(test + i, numSetSteps - 1);
+            if(specialChecks && isLowerSignature(prefixClass, getWindowSignature(equalities + i))) {
+                counts.pruned++;
+                goto codeDone;
+            }
+        }
+        if(worker->codeDump != NULL && !worker->codeDump->options->seedsOnly) appendCodeDump(worker->codeDump, test);
+        if(isSeedCode(prefixClass, test, equalities, specialChecks)) addSeed(worker, prefixClass, test);
+
+        codeDone:
+        addSearchStats(worker, &counts);
+        // If a checkpoint is coming up, let it know where we are. This is the only place the whole code is done with.
+        if(worker->seedStore != NULL && __atomic_load_n(worker->checkpointEpoch, __ATOMIC_RELAXED) != worker->seenEpoch)
+            publishSearchPosition(worker, test, false);
+
+        // Then pop back to the step before the forced ones.
+        popForced:
+        visited ^= 1ULL << frames[forced].value;
+        position = forced - 1;
     }
 
-    // Print the results
-    printf(" ---------- The number of codes extrapolated from this thread was %lld.\n", numGreyCodes);
+    taskDone:
+    addSearchStats(worker, &counts);
+    free(matches.relabels);
+    free(matches.live);
+    free(matches.liveStart);
+}
+#endif
 
-    // Free stuff that needs to be free
-    freeGMPTable(uniquePermutations);
+
+
+/**
+ * (Code Search) This function finds all the seeds that begin with the given task's set steps. This is the function ran by
+ * the work-stealing pool for every task, and it adds the seeds it finds to the worker's seed list. It just picks which
+ * copy of searchCodesWithSetStart (or searchCodesBitset with -DBITSET_SEARCH) to run for the task's class.
+ * @param worker The CodeSearchWorker running this task. Its seed list and counts are added to.
+ * @param task The CodeSearchTask to search. Once one of its set steps would change, the task is done.
+ * @param resumeFrom The last code that was finished with in this task before a checkpoint, as digit numbers, to carry
+ *                   on from right after it. NULL to start the task from the beginning.
+*/
+void calculateCodesWithSetStart(CodeSearchWorker *worker, const CodeSearchTask *task, const step *resumeFrom)
+{
+    #ifdef BITSET_SEARCH
+    if(task->prefixClass->hasLower)
+        searchCodesBitset(worker, task, resumeFrom, true);
+    else
+        searchCodesBitset(worker, task, resumeFrom, false);
+    #else
+    if(task->prefixClass->hasLower)
+        searchCodesWithSetStart(worker, task, resumeFrom, true);
+    else
+        searchCodesWithSetStart(worker, task, resumeFrom, false);
+    #endif
+}
+
+
+
+/**
+ * (Code Search) The function the work-stealing pool calls for every task. Just unpacks the context and runs the search.
+ * @param workerIndex Which worker is running the task.
+ * @param taskIndex Which task to run.
+ * @param context Pointer to the CodeSearchContext.
+*/
+void runCodeSearchTask(int workerIndex, size_t taskIndex, void *context)
+{
+    CodeSearchContext *searchContext = (CodeSearchContext *)context;
+    CodeSearchWorker *worker = searchContext->workers + workerIndex;
+
+    // If resuming, the tasks that were done before the checkpoint are skipped, and the ones that were partway done
+    //    carry on from where they were.
+    __atomic_add_fetch(&(searchContext->tasksRun), 1, __ATOMIC_RELAXED);
+    if(searchContext->completedTasks[taskIndex]) return;
+    const step *resumeFrom = searchContext->resumePositions != NULL ? searchContext->resumePositions[taskIndex] : NULL;
+
+    // If saving, the checkpoints need to know which task this is. Until a code is found there's nothing to resume from,
+    //    other than the code it's resuming from.
+    if(worker->seedStore != NULL) {
+        pthread_mutex_lock(&(worker->publishLock));
+        worker->published.taskIndex = taskIndex;
+        worker->published.hasPosition = resumeFrom != NULL;
+        if(resumeFrom != NULL) memcpy(worker->published.position, resumeFrom, sizeof(step) * len);
+        pthread_mutex_unlock(&(worker->publishLock));
+    }
+
+    calculateCodesWithSetStart(worker, searchContext->tasks + taskIndex, resumeFrom);
+
+    // Save the rest of the seeds from this task and mark it done
+    if(worker->seedStore != NULL) publishSearchPosition(worker, NULL, true);
+}
+
+
+
+/**
+ * (Code Search) The function every worker of the work-stealing pool calls when it starts. If placing the threads, it
+ * pins the worker to its node first, then starts the worker's first batch, so the batches are all allocated and
+ * touched on the worker's node.
+ * @param workerIndex Which worker it is.
+ * @param context Pointer to the CodeSearchContext.
+*/
+void startCodeSearchWorker(int workerIndex, void *context)
+{
+    CodeSearchContext *searchContext = (CodeSearchContext *)context;
+    CodeSearchWorker *worker = searchContext->workers + workerIndex;
+    if(searchContext->numa != NULL) pinThreadToNumaNode(searchContext->numa, worker->numaNode);
+    worker->batch = acquireSeedBatch(worker->seedArena);
+}
+
+
+
+/**
+ * (Code Search) Takes a checkpoint of the search. Holds every worker's publishLock so none of them can publish partway
+ * through, commits the seed file, then writes the checkpoint file with everyone's published position.
+ * @param searchContext The CodeSearchContext of the running search.
+*/
+void takeSearchCheckpoint(CodeSearchContext *searchContext)
+{
+    SearchPosition *positions = (SearchPosition *)malloc(sizeof(SearchPosition) * searchContext->numWorkers);
+    for(int i = 0; i < searchContext->numWorkers; i++) {
+        pthread_mutex_lock(&(searchContext->workers[i].publishLock));
+        positions[i] = searchContext->workers[i].published;
+    }
+
+    uint64_t seedCount = commitSeedStore(searchContext->seedStore);
+    writeSearchCheckpoint(searchContext->seedStore->path, seedCount, searchContext->taskDepth, searchContext->numTasks,
+                          searchContext->completedTasks, searchContext->numWorkers, positions);
+
+    for(int i = searchContext->numWorkers - 1; i >= 0; i--)
+        pthread_mutex_unlock(&(searchContext->workers[i].publishLock));
+    free(positions);
+}
+
+
+
+/**
+ * (Code Search) The thread function for the checkpointer. Takes a checkpoint every checkpointInterval seconds until the
+ * search is done, then bumps the epoch so the workers publish before the next one.
+ * @param context Pointer to the CodeSearchContext.
+ * @return Nothing, but a void * return type is necessary to make the thread.
+*/
+void *checkpointSearch(void *context)
+{
+    CodeSearchContext *searchContext = (CodeSearchContext *)context;
+    struct timespec wakeTime;
+
+    pthread_mutex_lock(&(searchContext->checkpointLock));
+    while(!searchContext->searchDone) {
+        // Let the workers know a checkpoint is coming, then give them the interval to publish
+        __atomic_add_fetch(&(searchContext->checkpointEpoch), 1, __ATOMIC_RELAXED);
+        clock_gettime(CLOCK_REALTIME, &wakeTime);
+        wakeTime.tv_sec += searchContext->checkpointInterval;
+        while(!searchContext->searchDone &&
+                pthread_cond_timedwait(&(searchContext->checkpointStop), &(searchContext->checkpointLock), &wakeTime) == 0);
+        if(searchContext->searchDone) break;
+
+        takeSearchCheckpoint(searchContext);
+    }
+    pthread_mutex_unlock(&(searchContext->checkpointLock));
+    return NULL;
+}
+
+
+
+/**
+ * (Code Search) The thread function for the progress reporter. Every progressInterval seconds until the search is done,
+ * prints how many of the tasks have been run and how many seeds the workers have found so far. The workers' counts are
+ * read without stopping them, so they're only about right, but that's all a progress report needs.
+ * @param context Pointer to the CodeSearchContext.
+ * @return Nothing, but a void * return type is necessary to make the thread.
+*/
+void *reportSearchProgress(void *context)
+{
+    CodeSearchContext *searchContext = (CodeSearchContext *)context;
+    struct timespec wakeTime;
+    double startSeconds = getWallSeconds();
+
+    pthread_mutex_lock(&(searchContext->checkpointLock));
+    while(!searchContext->searchDone) {
+        clock_gettime(CLOCK_REALTIME, &wakeTime);
+        wakeTime.tv_sec += searchContext->progressInterval;
+        while(!searchContext->searchDone &&
+                pthread_cond_timedwait(&(searchContext->checkpointStop), &(searchContext->checkpointLock), &wakeTime) == 0);
+        if(searchContext->searchDone) break;
+
+        unsigned long long seeds = 0;
+        for(int i = 0; i < searchContext->numWorkers; i++)
+            seeds += __atomic_load_n(&(searchContext->workers[i].count), __ATOMIC_RELAXED);
+        double seconds = getWallSeconds() - startSeconds;
+        printf(" ---- %zu of %zu tasks started and %llu seeds found after %.0f seconds, %.0f seeds a second.\n",
+            __atomic_load_n(&(searchContext->tasksRun), __ATOMIC_RELAXED), searchContext->numTasks, seeds, seconds, seeds / seconds);
+    }
+    pthread_mutex_unlock(&(searchContext->checkpointLock));
+    return NULL;
+}
+
+
+
+/**
+ * (Code Search) This is a recursive function that splits a prefix class into tasks. It extends the set steps one step
+ * at a time, trying every step in the same order the search would and rejecting them with the same checks, so the
+ * tasks together cover exactly what the search over the whole class would have.
+ * @param prefixClass The class to split.
+ * @param setSteps The steps set so far. Must have room for len steps.
+ * @param numSetSteps How many steps are set so far.
+ * @param flags Which numbers have been reached by the set steps so far.
+ * @param current The number reached after the last set step.
+ * @param taskDepth How many steps each task has set.
+ * @param tasks The task array to add to, or NULL to just count them.
+ * @param numTasks The number of tasks so far. Incremented for every task added.
+*/
+void addSearchTasks(PrefixClass *prefixClass, stepMask *setSteps, int numSetSteps, bool *flags, int current, 
+                    int taskDepth, CodeSearchTask *tasks, size_t *numTasks)
+{
+    // Once deep enough, this is a task
+    if(numSetSteps >= taskDepth) {
+        if(tasks != NULL) {
+            tasks[*numTasks].prefixClass = prefixClass;
+            tasks[*numTasks].numSetSteps = numSetSteps;
+            memcpy(tasks[*numTasks].setSteps, setSteps, sizeof(stepMask) * numSetSteps);
+        }
+        (*numTasks)++;
+        return;
+    }
+
+    // Otherwise, try every next step
+    for(stepMask next = 1; next <= LAST_DIGIT_STEP; next <<= 1) {
+        if(next == setSteps[numSetSteps - 1]) continue;
+        setSteps[numSetSteps] = next;
+        if(prefixClass->hasLower && isLowerSignature(prefixClass, getStepsSignature(setSteps + numSetSteps))) continue;
+        int reached = current ^ next;
+        if(!reached || flags[reached]) continue;
+
+        flags[reached] = true;
+        addSearchTasks(prefixClass, setSteps, numSetSteps + 1, flags, reached, taskDepth, tasks, numTasks);
+        flags[reached] = false;
+    }
+}
+
+
+
+/**
+ * (Code Search) Splits all the prefix classes into tasks.
+ * @param prefixClasses The array of the prefix classes.
+ * @param numPrefixClasses How many prefix classes there are.
+ * @param taskDepth How many steps each task has set. Classes with more set steps than that are just one task each.
+ * @param tasks The task array to fill in, or NULL to just count them.
+ * @return How many tasks there are.
+*/
+size_t makeSearchTasks(PrefixClass *prefixClasses, int numPrefixClasses, int taskDepth, CodeSearchTask *tasks)
+{
+    size_t numTasks = 0;
+    stepMask setSteps[len];
+    bool flags[len];
+    for(int c = 0; c < numPrefixClasses; c++) {
+        // Mark the numbers reached by the class's set steps
+        int current = 0;
+        memset(flags, false, sizeof(flags));
+        for(int i = 0; i < prefixClasses[c].numSetSteps; i++) {
+            current ^= prefixClasses[c].setSteps[i];
+            flags[current] = true;
+        }
+        memcpy(setSteps, prefixClasses[c].setSteps, sizeof(stepMask) * prefixClasses[c].numSetSteps);
+        addSearchTasks(prefixClasses + c, setSteps, prefixClasses[c].numSetSteps, flags, current, taskDepth, tasks, &numTasks);
+    }
+    return numTasks;
+}
+
+
+
+/**
+ * (Extrapolation) Gets the next seed for an extrapolation thread to extrapolate. If the thread has a seed file, the
+ * seeds are unpacked straight out of the mapping first. The threads all take fileBatchSize seeds at a time from the
+ * shared cursor, so one that gets a run of expensive seeds doesn't hold everyone else up at the end like a fixed slice
+ * would. After that they come out of the batches from the seed queue, and each batch is given back to its arena once
+ * it's done.
+ * @param threadStruct The ExtrapolateThreadStruct of the thread.
+ * @param seq Where the seed is copied to.
+ * @return True if there was a seed, false if there are no more.
+*/
+bool getNextSeed(ExtrapolateThreadStruct *threadStruct, step *seq)
+{
+    if(threadStruct->seedFile != NULL) {
+        // Take some more if out of them, and once the file's all handed out, forget about it
+        if(threadStruct->nextFileSeed == threadStruct->endFileSeed) {
+            uint64_t first = __atomic_fetch_add(threadStruct->fileCursor, threadStruct->fileBatchSize, __ATOMIC_RELAXED);
+            if(first < threadStruct->seedFile->count) {
+                threadStruct->nextFileSeed = first;
+                threadStruct->endFileSeed = first + threadStruct->fileBatchSize < threadStruct->seedFile->count ?
+                    first + threadStruct->fileBatchSize : threadStruct->seedFile->count;
+            } else threadStruct->seedFile = NULL;
+        }
+        if(threadStruct->seedFile != NULL) {
+            unpackSequence(threadStruct->seedFile->seeds[threadStruct->nextFileSeed++], seq);
+            return true;
+        }
+    }
+
+    // Once done with a batch, give it back to its arena and wait for the next one. If there are no more, we are done.
+    while(threadStruct->batch == NULL || threadStruct->seedPtr - threadStruct->batch->seeds == threadStruct->batch->count) {
+        if(threadStruct->batch != NULL) releaseSeedBatch(threadStruct->batch);
+        double waitStart = getWallSeconds();
+        threadStruct->batch = popSeedBatch(threadStruct->seedQueue, threadStruct->numaNode);
+        threadStruct->waitSeconds += getWallSeconds() - waitStart;
+        if(threadStruct->batch == NULL) return false;
+        threadStruct->seedPtr = threadStruct->batch->seeds;
+    }
+
+    // seedPtr is pointing to the next seed, unpack it
+    unpackSequence(*(threadStruct->seedPtr++), seq);
+    return true;
+}
+
+
+
+#ifdef GPU_EXTRAPOLATION
+/**
+ * This is the thread function for extrapolating seeds on the GPU, which extrapolateSeeds hands off to for EXTRAPOLATE_GPU.
+ * The seeds come from the same places as in getNextSeed, first the seed file and then the seed queue, but a whole GPU
+ * batch at a time. Seeds from the file are sent straight from where it's mapped, and seeds from the queue are copied
+ * into the stream's staging buffer and their batches given back right away. Each GPU batch goes in one of the stream's
+ * two slots, and while it's being counted the next one is gathered into the other, so the GPU keeps up with the search.
+ * @param threadVal The ExtrapolateThreadStruct.
+ * @return Nothing, but a void * return type is necessary to make the thread.
+*/
+void *extrapolateSeedsGpu(void *threadVal)
+{
+    ExtrapolateThreadStruct *threadStruct = ((ExtrapolateThreadStruct *)threadVal); // Recasting for convenience
+    GpuStream *stream = createGpuStream(threadStruct->gpu);                  // This thread's queue and buffers on the GPU
+    size_t batchSeeds = threadStruct->gpu->batchSeeds;                       // The most seeds that go over at a time
+    uint64_t firstFileSeed[GPU_STREAM_SLOTS];                                // Where each slot's seeds start in the seed file, UINT64_MAX if from the queue
+    unsigned long long numSeeds = 0;                                         // How many seeds this thread has extrapolated.
+    unsigned long long numGreyCodes = 0;                                     // The final tally of how many grey codes there are.
+    int slot = 0;                                                            // The slot being gathered into
+
+    double startSeconds = getWallSeconds();
+    threadStruct->batch = NULL;
+    threadStruct->seedPtr = NULL;
+    threadStruct->waitSeconds = 0;
+    while(true) {
+        // Take the next piece of the seed file, and once it's all handed out, forget about it
+        const packedSequence *seeds = stream->staging[slot];
+        size_t count = 0;
+        firstFileSeed[slot] = UINT64_MAX;
+        if(threadStruct->seedFile != NULL) {
+            uint64_t first = __atomic_fetch_add(threadStruct->fileCursor, batchSeeds, __ATOMIC_RELAXED);
+            if(first < threadStruct->seedFile->count) {
+                seeds = threadStruct->seedFile->seeds + first;
+                count = first + batchSeeds < threadStruct->seedFile->count ? batchSeeds : threadStruct->seedFile->count - first;
+                firstFileSeed[slot] = first;
+            } else threadStruct->seedFile = NULL;
+        }
+
+        // Otherwise fill the staging buffer from the queue, giving each seed batch back once it's copied
+        while(threadStruct->seedFile == NULL && count < batchSeeds) {
+            if(threadStruct->batch == NULL || threadStruct->seedPtr - threadStruct->batch->seeds == threadStruct->batch->count) {
+                if(threadStruct->batch != NULL) releaseSeedBatch(threadStruct->batch);
+                double waitStart = getWallSeconds();
+                threadStruct->batch = popSeedBatch(threadStruct->seedQueue, threadStruct->numaNode);
+                threadStruct->waitSeconds += getWallSeconds() - waitStart;
+                if(threadStruct->batch == NULL) break;
+                threadStruct->seedPtr = threadStruct->batch->seeds;
+            }
+            size_t take = (threadStruct->batch->seeds + threadStruct->batch->count) - threadStruct->seedPtr;
+            if(take > batchSeeds - count) take = batchSeeds - count;
+            memcpy(stream->staging[slot] + count, threadStruct->seedPtr, sizeof(packedSequence) * take);
+            threadStruct->seedPtr += take;
+            count += take;
+        }
+
+        // Send it over, then add up the other slot's batch while this one is going
+        if(count) launchGpuBatch(stream, slot, seeds, count);
+        int other = (slot + 1) % GPU_STREAM_SLOTS;
+        const cl_ulong *codes = finishGpuBatch(stream, other);
+        if(codes != NULL) {
+            for(size_t i = 0; i < stream->numSeeds[other]; i++) {
+                numGreyCodes += codes[i];
+                if(threadStruct->seedCodes != NULL && firstFileSeed[other] != UINT64_MAX)
+                    threadStruct->seedCodes[firstFileSeed[other] + i] = codes[i];
+            }
+            numSeeds += stream->numSeeds[other];
+            __atomic_store_n(&(threadStruct->numSeeds), numSeeds, __ATOMIC_RELAXED);
+            __atomic_store_n(&(threadStruct->numGreyCodes), numGreyCodes, __ATOMIC_RELAXED);
+        }
+        if(!count) break;
+        slot = other;
+    }
+
+    if(!threadStruct->quiet)
+        printf(" ---------- The number of codes extrapolated on the GPU from this thread was %lld.\n", numGreyCodes);
+
+    freeGpuStream(stream);
+    threadStruct->numGreyCodes = numGreyCodes;
+    threadStruct->numSeeds = numSeeds;
+    threadStruct->numPermutations = 0;
+    threadStruct->seconds = getWallSeconds() - startSeconds;
+    return NULL;
+}
+#endif
+
+
+
+/**
+ * This is a thread function for extrapolating seeds. Takes in a pointer to a ExtrapolateThreadStruct which has the queue
+ * to pop seed batches from (or the seed file to read), and passes out through it the final tally. Keeps going until there
+ * are no more seeds.
+ * @param threadVal The ExtrapolateThreadStruct.
+ * @return Nothing, but a void * return type is necessary to make the thread.
+*/
+void *extrapolateSeeds(void *threadVal)
+{
+
+    // If placing the threads, get onto the node first, so the hash table below is allocated there
+    ExtrapolateThreadStruct *threadStruct = ((ExtrapolateThreadStruct *)threadVal); // Recasting for convenience
+    if(threadStruct->numa != NULL) pinThreadToNumaNode(threadStruct->numa, threadStruct->numaNode);
+    #ifdef GPU_EXTRAPOLATION
+    if(threadStruct->mode == EXTRAPOLATE_GPU) return extrapolateSeedsGpu(threadVal);
+    #endif
+
+    // Variables
+    sequence localSequence;                                                  // A place on the stack to hold a sequence
+    sequence permutedSequence;                                               // The localSequence with its digits relabeled
+    #ifdef FIXED_WIDTH_KEYS
+    KeyHashTable *uniquePermutations = createKeyTable(queueSize * 2);        // The hash table of unique permutations for the seed, 2 * n! rounded up to a power of 2.
+    sequenceKey originalRotation;                                            // The original sequence key after swapping before doing rotations.
+    sequenceKey currentRotation;                                             // The variable to do the rotation calculations
+    #else
+    GMPHashTable *uniquePermutations = createGMPTable((queueSize * 2) + 1);  // The hash table of unique permutations for the seed, size (2 * n!) + 1.
+    sequenceNum originalRotation;                                            // The original sequence number after swapping before doing rotations.
+    sequenceNum currentRotation;                                             // The variable to do the rotation calculations
+    step *stepPtr;                                                           // Pointer to inside the localSequence
+    step doubledSequence[len * 2];                                           // The relabeled sequence twice, to find its least rotation
+    step doubledSeed[len * 2];                                               // The seed twice, to find its least rotation
+    const step *leastSeedRotation;                                           // Pointer to the seed's least rotation inside doubledSeed
+    #endif
+    seedSignature signature;                                                 // How many times each digit flips in the seed
+    unsigned int signaturePattern = ~0u;                                     // The pattern signatureMaps were found for, none yet
+    int numSignatureMaps = 0;                                                // How many relabelings keep that pattern
+    int *signatureMaps = threadStruct->mode == EXTRAPOLATE_SIGNATURE ? (int *)malloc(sizeof(int) * queueSize) : NULL; // Their indices in the table
+    unsigned long long numSeeds      = 0;                                    // How many seeds this thread has extrapolated.
+    unsigned long long numPermutations = 0;                                  // How many relabelings of them have been hashed.
+    const permutationMap *mapPtr;                                            // Pointer to inside the permutation table
+    const permutationMap *mapsEnd = threadStruct->permutations->maps + queueSize; // Just past the last map
+    unsigned long long numGreyCodes  = 0;                                    // The final tally of how many grey codes there are.
+    bool rotationallySymmetric;                                              // Whether or not the seed is rotationally symmetric (half as many rotations per permutation)
+    const int numHalves              = __builtin_ctz(queueSize) + 1;         // The number of times n! can be evenly halved plus one.
+    int halves[numHalves];                                                   // The list of the halves of n!, the number of possible unique permutations.
+    int *currentNextHalf;                                                    // Pointer to the next half to be reached in the halves list.
+
+    #ifndef FIXED_WIDTH_KEYS
+    // Initialize the sequenceNums
+    mpz_init(currentRotation);
+    mpz_init(originalRotation);
+    #endif
+
+    // Initialize the halves list
+    //    This list will have all of the clean halves of itself plus itself normally at the end.
+    //    For example, if the queueSize was 24, then the array would have (3, 6, 12, 24)
+    for(int i = 0; i < numHalves; i++) {
+        halves[i] = (queueSize >> (numHalves - 1 - i));
+    }
+
+    // For each seed
+    double startSeconds = getWallSeconds();
+    threadStruct->batch = NULL;
+    threadStruct->seedPtr = NULL;
+    threadStruct->nextFileSeed = 0;
+    threadStruct->endFileSeed = 0;
+    threadStruct->waitSeconds = 0;
+    while(getNextSeed(threadStruct, localSequence)) {
+        numSeeds++;
+
+        // Stabilizer counting doesn't need any of the hashing below
+        if(threadStruct->mode == EXTRAPOLATE_STABILIZER) {
+            unsigned long long seedCodes = countCodesByStabilizer(localSequence);
+            numGreyCodes += seedCodes;
+            if(threadStruct->seedCodes != NULL && threadStruct->seedFile != NULL)
+                threadStruct->seedCodes[threadStruct->nextFileSeed - 1] = seedCodes;
+            __atomic_store_n(&(threadStruct->numSeeds), numSeeds, __ATOMIC_RELAXED);
+            __atomic_store_n(&(threadStruct->numGreyCodes), numGreyCodes, __ATOMIC_RELAXED);
+            continue;
+        }
+
+        // Check for rotational symmetry
+        rotationallySymmetric = memcmp(localSequence, localSequence + (len/2), sizeof(step) * len/2) == 0;
+
+        // Signature extrapolation only tries the relabelings that keep the seed's signature. Those are found again only
+        //    when the pattern changes, which isn't often in a bucketed seed file.
+        if(threadStruct->mode == EXTRAPOLATE_SIGNATURE) {
+            getSeedSignature(localSequence, signature);
+            unsigned int pattern = getSignaturePattern(signature);
+            if(pattern != signaturePattern) {
+                numSignatureMaps = getSignaturePermutations(threadStruct->permutations, signature, signatureMaps);
+                signaturePattern = pattern;
+            }
+
+            // Count the ones that map the seed onto a rotation of itself, by comparing least rotations. The identity
+            //    always does, and if it's the only one there's nothing to compare.
+            unsigned long long automorphisms = 1;
+            if(numSignatureMaps > 1) {
+                #ifdef FIXED_WIDTH_KEYS
+                getSequenceKey(localSequence, &originalRotation);
+                getLeastRotationKey(&originalRotation);
+                #else
+                memcpy(doubledSeed, localSequence, sizeof(step) * len);
+                memcpy(doubledSeed + len, localSequence, sizeof(step) * len);
+                leastSeedRotation = doubledSeed + getLeastRotation(doubledSeed);
+                #endif
+                for(int k = 1; k < numSignatureMaps; k++) {
+                    relabelSequence(localSequence, threadStruct->permutations->maps[signatureMaps[k]], permutedSequence);
+                    #ifdef FIXED_WIDTH_KEYS
+                    getSequenceKey(permutedSequence, &currentRotation);
+                    getLeastRotationKey(&currentRotation);
+                    if(sequenceKeysEqual(currentRotation, originalRotation)) automorphisms++;
+                    #else
+                    memcpy(doubledSequence, permutedSequence, sizeof(step) * len);
+                    memcpy(doubledSequence + len, permutedSequence, sizeof(step) * len);
+                    if(memcmp(doubledSequence + getLeastRotation(doubledSequence), leastSeedRotation, sizeof(step) * len) == 0)
+                        automorphisms++;
+                    #endif
+                }
+            }
+
+            // Every other relabeling makes a different seed, so it's n! over the ones that don't
+            unsigned long long seedCodes = (queueSize / automorphisms) * (rotationallySymmetric ? len/2 : len);
+            numGreyCodes += seedCodes;
+            if(threadStruct->seedCodes != NULL && threadStruct->seedFile != NULL)
+                threadStruct->seedCodes[threadStruct->nextFileSeed - 1] = seedCodes;
+            numPermutations += numSignatureMaps;
+            __atomic_store_n(&(threadStruct->numSeeds), numSeeds, __ATOMIC_RELAXED);
+            __atomic_store_n(&(threadStruct->numPermutations), numPermutations, __ATOMIC_RELAXED);
+            __atomic_store_n(&(threadStruct->numGreyCodes), numGreyCodes, __ATOMIC_RELAXED);
+            continue;
+        }
+
+        // Clear the hashTable
+        #ifdef FIXED_WIDTH_KEYS
+        emptyKeyTable(uniquePermutations);
+        #else
+        emptyGMPTable(uniquePermutations);
+        #endif
+
+        // Reset the half tracker
+        currentNextHalf = halves;
+        // printf("With the sequence: ");
+        // for(int j = 0; j < len; j++) printf(j != len - 1 ? "%d," : "%d\n", localSequence[j]);
+
+        // Enter the loop of relabelings
+        for(mapPtr = threadStruct->permutations->maps; mapPtr < mapsEnd; mapPtr++) {
+
+            // If canonical, the least rotation of the relabeling stands in for all of its rotations, so it only needs
+            //    the one lookup. Any rotation of it gives the same least rotation.
+            if(threadStruct->mode == EXTRAPOLATE_CANONICAL) {
+                relabelSequence(localSequence, *mapPtr, permutedSequence);
+                #ifdef FIXED_WIDTH_KEYS
+                getSequenceKey(permutedSequence, &originalRotation);
+                getLeastRotationKey(&originalRotation);
+                if(!keyHashContains(uniquePermutations, originalRotation))
+                    keyHashInsert(uniquePermutations, originalRotation);
+                #else
+                // Rotating a GMP number is a multiply and a subtract, so it's found on the steps instead
+                memcpy(doubledSequence, permutedSequence, sizeof(step) * len);
+                memcpy(doubledSequence + len, permutedSequence, sizeof(step) * len);
+                getSequenceNumber(doubledSequence + getLeastRotation(doubledSequence), originalRotation);
+                if(!GMPHashContains(uniquePermutations, originalRotation))
+                    GMPHashInsert(uniquePermutations, originalRotation);
+                #endif
+                goto notUniquePermutation;
+            }
+
+            // Relabel the localSequence with the next map, the first one being the identity
+            relabelSequence(localSequence, *mapPtr, permutedSequence);
+
+            #ifdef FIXED_WIDTH_KEYS
+            // Pack it into originalRotation, copy to currentRotation
+            getSequenceKey(permutedSequence, &originalRotation);
+            currentRotation = originalRotation;
+
+            // Do rotations until the key matches one of the previous permutations or until we have exhausted all the rotations
+            do {
+                // Check if this rotation is equal to any of the unique permutations
+                //    If we find one that is equal, then this permutation is not unique
+                if(keyHashContains(uniquePermutations, currentRotation)) goto notUniquePermutation;
+
+                // Otherwise, rotate the key
+                rotateSequenceKey(&currentRotation);
+            } while(!sequenceKeysEqual(currentRotation, originalRotation));
+
+            // If none of this swap's rotations matched the previous permutations, then it is a unique permutation,
+            //    add it officially to the list.
+            keyHashInsert(uniquePermutations, originalRotation);
+            #else
+            // Calculate it's number in originalRotation, copy to currentRotation
+            getSequenceNumber(permutedSequence, originalRotation);
+            mpz_set(currentRotation, originalRotation);
+
+            // Do rotations until the number matches one of the previous permutations or until we have exhausted all the rotations
+            stepPtr = permutedSequence;
+            do {
+                // Check if this rotation is equal to any of the unique permutations
+                //    If we find one that is equal, then this permutation is not unique
+                if(GMPHashContains(uniquePermutations, currentRotation)) goto notUniquePermutation;
+
+                // Otherwise, rotate the sequence
+                mpz_mul_ui(currentRotation, currentRotation, NUM_DIGITS);
+                mpz_sub(currentRotation, currentRotation, threadStruct->multiplesTablePointer[*(stepPtr++)]);
+            } while(mpz_cmp(currentRotation, originalRotation) != 0);
+
+            // If none of this swap's rotations matched the previous permutations, then it is a unique permutation,
+            //    add it officially to the list.
+            GMPHashInsert(uniquePermutations, originalRotation);
+            #endif
+
+            // If it matched one of the rotations, then this swap is the same as a previous, we do not need to add it.
+            notUniquePermutation:
+            if(uniquePermutations->count < *currentNextHalf) continue;
+            // If we have reached a half milestone or gone past.
+            // If blown past the half, we don't need to check anymore, increase.
+            if(uniquePermutations->count > *currentNextHalf) {
+                currentNextHalf++;
+
+                // If we are past half of the possible unique permutations, we know we will get all of them.
+                if(*currentNextHalf == queueSize) {
+                    uniquePermutations->count = queueSize;
+                    break;
+                }
+            } else 
+                // If we are on that half value, to get to the next we need to double, but if
+                //    the number of permutations left to check is less than that, we can't reach the next,
+                //    so we know they must all be not unique, we can skip them all.
+                if(*currentNextHalf > mapsEnd - (mapPtr + 1))
+                    break;
+                
+        }
+
+        // Now we should have added all the rotations from the unique permutations to the total count, we go onto the next seed.
+        unsigned long long seedCodes = uniquePermutations->count * (rotationallySymmetric ? len/2 : len);
+        numGreyCodes += seedCodes;
+
+        // If keeping each seed's codes and this one came out of the seed file, it was the one just before nextFileSeed
+        if(threadStruct->seedCodes != NULL && threadStruct->seedFile != NULL)
+            threadStruct->seedCodes[threadStruct->nextFileSeed - 1] = seedCodes;
+
+        // Keep the counts up to date for the stats. If the loop stopped early, the map it stopped on was hashed too.
+        numPermutations += mapPtr < mapsEnd ? (mapPtr - threadStruct->permutations->maps) + 1 : queueSize;
+        __atomic_store_n(&(threadStruct->numSeeds), numSeeds, __ATOMIC_RELAXED);
+        __atomic_store_n(&(threadStruct->numPermutations), numPermutations, __ATOMIC_RELAXED);
+        __atomic_store_n(&(threadStruct->numGreyCodes), numGreyCodes, __ATOMIC_RELAXED);
+    }
+
+    // Print the results
+    if(!threadStruct->quiet)
+        printf(" ---------- The number of codes extrapolated from this thread was %lld.\n", numGreyCodes);
+
+    // Free stuff that needs to be free
+    free(signatureMaps);
+    #ifdef FIXED_WIDTH_KEYS
+    freeKeyTable(uniquePermutations);
+    #else
+    freeGMPTable(uniquePermutations);
     mpz_clear(originalRotation);
     mpz_clear(currentRotation);
+    #endif
 
     // Output the number of grey codes
     threadStruct->numGreyCodes = numGreyCodes;
+    threadStruct->numSeeds = numSeeds;
+    threadStruct->numPermutations = numPermutations;
+    threadStruct->seconds = getWallSeconds() - startSeconds;
 
     // Exit
-    if(threadStruct->exitOrNo) pthread_exit(NULL);
+    pthread_exit(NULL);
+    return NULL;
+}
+
+
+
+/**
+ * (Stats) Moves the run on to the next stage, and notes the time. Any stages in between were skipped, so they start
+ * then too.
+ * @param stats The RunStats of the run.
+ * @param stage The stage it's starting.
+*/
+void setRunStage(RunStats *stats, RunStage stage)
+{
+    double now = getWallSeconds() - stats->startSeconds;
+    for(int s = stats->stage + 1; s <= (int)stage; s++)
+        stats->stageStarts[s] = now;
+    __atomic_store_n(&(stats->stage), (int)stage, __ATOMIC_RELEASE);
+}
+
+
+
+/**
+ * (Stats) Writes one JSON line of stats, with what every search worker and extrapolation thread has counted so far. The
+ * threads keep going while it's read, so the counts are all from about the same time, not exactly. The final line also
+ * has how long each stage took and the CPU time.
+ * @param stats The RunStats of the run.
+ * @param cpuSeconds The CPU time used so far, for the final line, or a negative number for the lines before it.
+*/
+void writeStatsLine(RunStats *stats, double cpuSeconds)
+{
+    int stage = __atomic_load_n(&(stats->stage), __ATOMIC_ACQUIRE);
+    FILE *file = stats->file;
+    fprintf(file, "{\"seconds\":%.3f,\"stage\":\"%s\"", getWallSeconds() - stats->startSeconds, runStageNames[stage]);
+
+    // The search workers, once there's a search
+    CodeSearchContext *searchContext = stage >= STAGE_SEARCH ? stats->searchContext : NULL;
+    if(searchContext != NULL) {
+        fprintf(file, ",\"tasks_run\":%zu,\"tasks\":%zu,\"search_threads\":[",
+            __atomic_load_n(&(searchContext->tasksRun), __ATOMIC_RELAXED), searchContext->numTasks);
+        for(int i = 0; i < searchContext->numWorkers; i++) {
+            CodeSearchWorker *worker = searchContext->workers + i;
+            fprintf(file, "%s{\"nodes\":%llu,\"pruned\":%llu,\"codes\":%llu,\"seeds\":%llu}", i ? "," : "",
+                __atomic_load_n(&(worker->stats.nodes), __ATOMIC_RELAXED), __atomic_load_n(&(worker->stats.pruned), __ATOMIC_RELAXED),
+                __atomic_load_n(&(worker->stats.codes), __ATOMIC_RELAXED), __atomic_load_n(&(worker->count), __ATOMIC_RELAXED));
+        }
+        fprintf(file, "]");
+    }
+
+    // The extrapolation threads
+    fprintf(file, ",\"extrapolate_threads\":[");
+    for(int i = 0; i < stats->numExtrapolateThreads; i++) {
+        ExtrapolateThreadStruct *thread = stats->extrapolateThreads + i;
+        double waitSeconds;
+        __atomic_load(&(thread->waitSeconds), &waitSeconds, __ATOMIC_RELAXED);
+        fprintf(file, "%s{\"seeds\":%llu,\"permutations\":%llu,\"codes\":%llu,\"wait_seconds\":%.3f}", i ? "," : "",
+            __atomic_load_n(&(thread->numSeeds), __ATOMIC_RELAXED), __atomic_load_n(&(thread->numPermutations), __ATOMIC_RELAXED),
+            __atomic_load_n(&(thread->numGreyCodes), __ATOMIC_RELAXED), waitSeconds);
+    }
+    fprintf(file, "]");
+
+    // And at the end, the stages
+    if(cpuSeconds >= 0) {
+        fprintf(file, ",\"final\":true,\"stage_seconds\":{");
+        for(int s = STAGE_SETUP; s < STAGE_DONE; s++)
+            fprintf(file, "%s\"%s\":%.3f", s ? "," : "", runStageNames[s], stats->stageStarts[s + 1] - stats->stageStarts[s]);
+        fprintf(file, "},\"cpu_seconds\":%.3f", cpuSeconds);
+    }
+    fprintf(file, "}\n");
+    fflush(file);
+}
+
+
+
+/**
+ * (Stats) The thread function for the stats writer. Writes a line every interval seconds until the run is done. main
+ * writes the final line itself, once everything's joined.
+ * @param context Pointer to the RunStats.
+ * @return Nothing, but a void * return type is necessary to make the thread.
+*/
+void *writeRunStats(void *context)
+{
+    RunStats *stats = (RunStats *)context;
+    struct timespec wakeTime;
+
+    pthread_mutex_lock(&(stats->lock));
+    while(!stats->done) {
+        clock_gettime(CLOCK_REALTIME, &wakeTime);
+        wakeTime.tv_sec += stats->interval;
+        while(!stats->done && pthread_cond_timedwait(&(stats->stop), &(stats->lock), &wakeTime) == 0);
+        if(stats->done) break;
+
+        writeStatsLine(stats, -1);
+    }
+    pthread_mutex_unlock(&(stats->lock));
     return NULL;
 }
 
 
 
+/**
+ * (Distributed) Searches and extrapolates one work unit for a distributed worker. It's the same as the search in main,
+ * just on a range of the tasks and without saving anything, since the coordinator keeps track of what's done.
+ * @param firstTask The first task of the unit.
+ * @param numTasks How many tasks are in the unit.
+ * @param context The DistributedWorkerContext.
+ * @param result Where the seeds and codes found are written.
+*/
+void runDistributedUnit(uint64_t firstTask, uint64_t numTasks, void *context, DistributedResult *result)
+{
+    DistributedWorkerContext *workerContext = (DistributedWorkerContext *)context;
+    int numWorkers = workerContext->numWorkers;
+    int numExtrapolateThreads = workerContext->numExtrapolateThreads;
+
+    // Start the extrapolation threads
+    const NumaTopology *numa = workerContext->numa;
+    int numNodes = numa != NULL ? numa->numNodes : 1;
+    SeedQueue *seedQueue = createSeedQueue(numNodes);
+    pthread_t extrapolateThreadIds[numExtrapolateThreads];
+    ExtrapolateThreadStruct *extrapolateThreadVals = (ExtrapolateThreadStruct *)calloc(numExtrapolateThreads, sizeof(ExtrapolateThreadStruct));
+    for(int i = 0; i < numExtrapolateThreads; i++) {
+        extrapolateThreadVals[i].seedQueue = seedQueue;
+        extrapolateThreadVals[i].mode = DEFAULT_EXTRAPOLATION_MODE;
+        extrapolateThreadVals[i].seedFile = NULL;
+        extrapolateThreadVals[i].permutations = workerContext->permutations;
+        #ifndef FIXED_WIDTH_KEYS
+        extrapolateThreadVals[i].multiplesTablePointer = workerContext->multiplesTablePointer;
+        #endif
+        extrapolateThreadVals[i].numa = numa;
+        extrapolateThreadVals[i].numaNode = getNumaNodeFor(i, numExtrapolateThreads, numNodes);
+        pthread_create(extrapolateThreadIds + i, NULL, &extrapolateSeeds, (void *)(extrapolateThreadVals + i));
+    }
+
+    // Set up the search workers on just this unit's tasks
+    CodeSearchContext searchContext;
+    memset(&searchContext, 0, sizeof(searchContext));
+    searchContext.tasks = workerContext->tasks + firstTask;
+    searchContext.numTasks = numTasks;
+    searchContext.numWorkers = numWorkers;
+    searchContext.workers = (CodeSearchWorker *)calloc(numWorkers, sizeof(CodeSearchWorker));
+    searchContext.completedTasks = (uint8_t *)calloc(numTasks, sizeof(uint8_t));
+    searchContext.numa = numa;
+    for(int i = 0; i < numWorkers; i++) {
+        searchContext.workers[i].numaNode = getNumaNodeFor(i, numWorkers, numNodes);
+        searchContext.workers[i].seedArena = createSeedArena(searchContext.workers[i].numaNode);
+        searchContext.workers[i].seedQueue = seedQueue;
+    }
+
+    // Run the pool, then push every worker's last batch and close the queue
+    WorkStealingPool *searchPool = createWorkStealingPool(numWorkers, numTasks, &runCodeSearchTask, (void *)&searchContext);
+    searchPool->startWorker = &startCodeSearchWorker;
+    startWorkStealingPool(searchPool);
+    joinWorkStealingPool(searchPool);
+    freeWorkStealingPool(searchPool);
+    for(int i = 0; i < numWorkers; i++) {
+        pushSeedBatch(seedQueue, searchContext.workers[i].batch);
+        result->numSeeds += searchContext.workers[i].count;
+        for(int c = 0; c < MAX_PREFIX_CLASSES; c++)
+            result->classSeeds[c] += searchContext.workers[i].classSeeds[c];
+    }
+    closeSeedQueue(seedQueue);
+
+    // Wait for all the extrapolation threads, add up their totals
+    for(int i = 0; i < numExtrapolateThreads; i++) {
+        pthread_join(extrapolateThreadIds[i], NULL);
+        result->numGreyCodes += extrapolateThreadVals[i].numGreyCodes;
+    }
+    freeSeedQueue(seedQueue);
+    free(extrapolateThreadVals);
+    for(int i = 0; i < numWorkers; i++)
+        freeSeedArena(searchContext.workers[i].seedArena);
+    free(searchContext.workers);
+    free(searchContext.completedTasks);
+}
+
+
+
+// The benchmarks and the verification run the search and extrapolation above, so they come after them
+#include "Benchmarks.c"
+#include "Verify.c"
+
+
+
+/**
+ * Sorts a seed file by signature with bucketSeedFileBySignature, and says how it went.
+ * @param path The seed file.
+ * @return True if it was sorted.
+*/
+bool bucketSeedFile(const char *path)
+{
+    unsigned long long numSignatures, numDistinct;
+    printf(" ------- Bucketing the seeds in %s by signature...\n", path);
+    if(!bucketSeedFileBySignature(path, &numSignatures, &numDistinct)) {
+        fprintf(stderr, "Couldn't bucket the seeds in %s\n", path);
+        return false;
+    }
+    printf(" ------- There are %llu signatures, and %llu seeds have every digit flip a different number of times.\n\n",
+        numSignatures, numDistinct);
+    return true;
+}
+
+
+
+/**
+ * Prints all the options.
+ * @param stream Where to print them.
+ * @param program The name the program was run as.
+*/
+void printUsage(FILE *stream, const char *program)
+{
+    int indent = (int)strlen(program);
+    fprintf(stream, "Usage: %s [--digits N] [--seeds PATH | --resume PATH] [--checkpoint-interval SECONDS] [--extrapolate PATH] [--check-duplicates]\n", program);
+    fprintf(stream, "       %*s [--threads N] [--search-threads N] [--extrapolate-threads N] [--extrapolate-batch N]\n", indent, "");
+    fprintf(stream, "       %*s [--task-depth N] [--search-only] [--progress SECONDS] [--time] [--stats PATH] [--stats-interval SECONDS]\n", indent, "");
+    fprintf(stream, "       %*s [--numa] [--gpu] [--gpu-kernel PATH] [--gpu-batch N] [--bucket-signatures]\n", indent, "");
+    fprintf(stream, "       %*s [--dump-codes PATH | --dump-seeds PATH] [--dump-prefix DIGITS] [--dump-packed] [--dump-compress]\n", indent, "");
+    fprintf(stream, "       %s --coordinator PORT [--unit-tasks N] [--unit-timeout SECONDS] [--task-depth N] [--time]\n", program);
+    fprintf(stream, "       %s --worker HOST:PORT [--threads N] [--search-threads N] [--extrapolate-threads N] [--task-depth N] [--numa]\n", program);
+    fprintf(stream, "       %s --count [--time]\n", program);
+    fprintf(stream, "       %s --benchmark [--benchmark-seeds PATH] [--benchmark-save PATH] [--benchmark-baseline PATH]\n", program);
+    fprintf(stream, "       %s --verify-extrapolation PATH [--threads N] [--extrapolate-threads N] [--extrapolate-batch N] [--gpu]\n", program);
+    fprintf(stream, "       %s --verify-search PATH [search options]\n", program);
+    #ifdef DIGIT_DISPATCH
+    fprintf(stream, "The number of digits is %d. Pick it with --digits N, see GreyCodeDigits.c for which ones there are.\n", NUM_DIGITS);
+    #else
+    fprintf(stream, "The number of digits is %d. It's set when compiling, with -DNUM_DIGITS=X, and --digits N has to match it.\n",
+        NUM_DIGITS);
+    #endif
+}
+
+
+
 /**
  * Starts the program.
+ * @param argc The number of arguments.
+ * @param argv The arguments, see the top of the file for the options.
  * @return Exit status.
 */
-int main() 
+int main(int argc, char *argv[]) 
 {
     // ----- STAGE 1: INITIALIZATION
+    // Read the options
+    const char *seedPath = NULL;                             // Where to save the seeds as they're found, if anywhere
+    const char *extrapolatePath = NULL;                      // The seed file to extrapolate instead of searching, if any
+    bool resuming = false;                                   // Whether to pick the search saving to seedPath back up from its checkpoint
+    bool countOnly = false;                                  // Whether to just count the codes by meeting in the middle, without any seeds
+    bool checkDuplicates = false;                            // Whether to make sure no seed gets found twice
+    int coordinatorPort = 0;                                 // The port to coordinate a distributed search on, if coordinating
+    char *workerHost = NULL;                                 // The coordinator to work for, if a distributed worker
+    int workerPort = 0;                                      // The coordinator's port
+    int unitTasks = DEFAULT_WORK_UNIT_TASKS;                 // How many tasks go in each distributed work unit
+    int unitTimeout = 0;                                     // Seconds before a distributed work unit is handed out again, 0 for never
+    int checkpointInterval = DEFAULT_CHECKPOINT_INTERVAL;    // Seconds between checkpoints when saving the seeds
+    int numThreads = 0;                                      // How many search workers and extrapolation threads to run, 0 for one per core
+    int numSearchThreads = 0;                                // How many search workers to run, 0 for numThreads
+    int numExtrapolateThreads = 0;                           // How many extrapolation threads to run, 0 for numThreads
+    int extrapolateBatch = DEFAULT_EXTRAPOLATE_BATCH;        // How many seeds the extrapolation threads take out of a seed file at a time
+    int taskDepth = TASK_DEPTH;                              // How many steps each search task has set
+    bool searchOnly = false;                                 // Whether to just search for the seeds and not extrapolate them
+    int progressInterval = DEFAULT_PROGRESS_INTERVAL;        // Seconds between progress reports, 0 for none
+    bool showRuntime = DEFAULT_SHOW_RUNTIME;                 // Whether to print how long the run took
+    const char *statsPath = NULL;                            // Where to write the stats lines, if anywhere
+    int statsInterval = DEFAULT_STATS_INTERVAL;              // Seconds between stats lines
+    bool benchmark = false;                                  // Whether to run the benchmarks instead
+    const char *benchmarkSeedPath = DEFAULT_BENCHMARK_SEED_PATH; // The seeds and group sizes for the extrapolation benchmarks
+    const char *benchmarkSavePath = NULL;                    // Where to save the benchmark results, if anywhere
+    const char *benchmarkBaselinePath = NULL;                // The benchmark results to compare to, if any
+    const char *verifyExtrapolationPath = NULL;              // The seeds and group sizes to check the extrapolation against, if any
+    const char *verifySearchPath = NULL;                     // The seeds and group sizes to check the search against, if any
+    bool placeOnNuma = false;                                // Whether to pin the threads to the NUMA nodes
+    bool bucketSignatures = false;                           // Whether to sort the seed file by signature
+    bool useGpu = false;                                     // Whether to extrapolate on the GPU
+    const char *gpuKernelPath = NULL;                        // Where the GPU kernel is, NULL for the default
+    int gpuBatch = 0;                                        // How many seeds go to the GPU at a time, 0 for the default
+    CodeDumpOptions dumpOptions = {};                        // How to dump the codes or seeds, if dumpOptions.path is set
+    const char *dumpPrefix = NULL;                           // The digits the dumped codes have to start with, if any
+    if(getenv("GREY_CODE_THREADS") != NULL)
+        numThreads = atoi(getenv("GREY_CODE_THREADS"));
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "--seeds") == 0 && i + 1 < argc)
+            seedPath = argv[++i];
+        else if(strcmp(argv[i], "--checkpoint-interval") == 0 && i + 1 < argc)
+            checkpointInterval = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--extrapolate") == 0 && i + 1 < argc)
+            extrapolatePath = argv[++i];
+        else if(strcmp(argv[i], "--resume") == 0 && i + 1 < argc) {
+            seedPath = argv[++i];
+            resuming = true;
+        }
+        else if(strcmp(argv[i], "--coordinator") == 0 && i + 1 < argc)
+            coordinatorPort = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--worker") == 0 && i + 1 < argc && strrchr(argv[i + 1], ':') != NULL) {
+            workerHost = argv[++i];
+            workerPort = atoi(strrchr(workerHost, ':') + 1);
+            *strrchr(workerHost, ':') = '\0';
+        }
+        else if(strcmp(argv[i], "--unit-tasks") == 0 && i + 1 < argc)
+            unitTasks = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--unit-timeout") == 0 && i + 1 < argc)
+            unitTimeout = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--count") == 0)
+            countOnly = true;
+        else if(strcmp(argv[i], "--check-duplicates") == 0)
+            checkDuplicates = true;
+        else if(strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+            numThreads = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--extrapolate-batch") == 0 && i + 1 < argc)
+            extrapolateBatch = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--search-threads") == 0 && i + 1 < argc)
+            numSearchThreads = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--extrapolate-threads") == 0 && i + 1 < argc)
+            numExtrapolateThreads = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--task-depth") == 0 && i + 1 < argc)
+            taskDepth = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--search-only") == 0)
+            searchOnly = true;
+        else if(strcmp(argv[i], "--progress") == 0 && i + 1 < argc)
+            progressInterval = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--time") == 0)
+            showRuntime = true;
+        else if(strcmp(argv[i], "--stats") == 0 && i + 1 < argc)
+            statsPath = argv[++i];
+        else if(strcmp(argv[i], "--stats-interval") == 0 && i + 1 < argc)
+            statsInterval = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--benchmark") == 0)
+            benchmark = true;
+        else if(strcmp(argv[i], "--benchmark-seeds") == 0 && i + 1 < argc)
+            benchmarkSeedPath = argv[++i];
+        else if(strcmp(argv[i], "--benchmark-save") == 0 && i + 1 < argc)
+            benchmarkSavePath = argv[++i];
+        else if(strcmp(argv[i], "--benchmark-baseline") == 0 && i + 1 < argc)
+            benchmarkBaselinePath = argv[++i];
+        else if(strcmp(argv[i], "--verify-extrapolation") == 0 && i + 1 < argc)
+            verifyExtrapolationPath = argv[++i];
+        else if(strcmp(argv[i], "--verify-search") == 0 && i + 1 < argc)
+            verifySearchPath = argv[++i];
+        else if(strcmp(argv[i], "--numa") == 0)
+            placeOnNuma = true;
+        else if(strcmp(argv[i], "--bucket-signatures") == 0)
+            bucketSignatures = true;
+        else if(strcmp(argv[i], "--gpu") == 0)
+            useGpu = true;
+        else if(strcmp(argv[i], "--gpu-kernel") == 0 && i + 1 < argc)
+            gpuKernelPath = argv[++i];
+        else if(strcmp(argv[i], "--gpu-batch") == 0 && i + 1 < argc)
+            gpuBatch = atoi(argv[++i]);
+        else if((strcmp(argv[i], "--dump-codes") == 0 || strcmp(argv[i], "--dump-seeds") == 0) && i + 1 < argc) {
+            dumpOptions.seedsOnly = strcmp(argv[i], "--dump-seeds") == 0;
+            dumpOptions.path = argv[++i];
+        }
+        else if(strcmp(argv[i], "--dump-prefix") == 0 && i + 1 < argc)
+            dumpPrefix = argv[++i];
+        else if(strcmp(argv[i], "--dump-packed") == 0)
+            dumpOptions.packed = true;
+        else if(strcmp(argv[i], "--dump-compress") == 0)
+            dumpOptions.compress = true;
+        else if(strcmp(argv[i], "--digits") == 0 && i + 1 < argc) {
+            if(atoi(argv[++i]) != NUM_DIGITS) {
+                fprintf(stderr, "This was compiled for %d digits, not %s\n", NUM_DIGITS, argv[i]);
+                return EXIT_FAILURE;
+            }
+        }
+        else if(strcmp(argv[i], "--help") == 0) {
+            printUsage(stdout, argv[0]);
+            return EXIT_SUCCESS;
+        }
+        else {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            printUsage(stderr, argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if(checkpointInterval < 1) checkpointInterval = 1;
+    if(extrapolateBatch < 1) extrapolateBatch = 1;
+    if(progressInterval < 0) progressInterval = 0;
+    if(statsInterval < 1) statsInterval = 1;
+    if(benchmark && (seedPath != NULL || extrapolatePath != NULL || countOnly || searchOnly || coordinatorPort || workerHost != NULL || statsPath != NULL)) {
+        fprintf(stderr, "The benchmarks run on their own, without any seeds to save or extrapolate, counting, or a distributed search\n");
+        return EXIT_FAILURE;
+    }
+    if(verifyExtrapolationPath != NULL && (benchmark || seedPath != NULL || extrapolatePath != NULL || countOnly || searchOnly
+            || coordinatorPort || workerHost != NULL || statsPath != NULL || verifySearchPath != NULL)) {
+        fprintf(stderr, "Verifying the extrapolation runs on its own, without a search, saved seeds, counting, or a distributed search\n");
+        return EXIT_FAILURE;
+    }
+    if(verifySearchPath != NULL && (benchmark || extrapolatePath != NULL || countOnly || coordinatorPort || workerHost != NULL)) {
+        fprintf(stderr, "Verifying the search needs a search on this machine, not a seed file, counting, or a distributed search\n");
+        return EXIT_FAILURE;
+    }
+    if(statsPath != NULL && (countOnly || coordinatorPort || workerHost != NULL)) {
+        fprintf(stderr, "The stats are only for a search or extrapolation on this machine, not counting or a distributed search\n");
+        return EXIT_FAILURE;
+    }
+    if(taskDepth < 1 || taskDepth > MAX_TASK_DEPTH) {
+        fprintf(stderr, "The task depth has to be from 1 to %d with %d digits\n", MAX_TASK_DEPTH, NUM_DIGITS);
+        return EXIT_FAILURE;
+    }
+    if(searchOnly && (extrapolatePath != NULL || countOnly || coordinatorPort || workerHost != NULL)) {
+        fprintf(stderr, "Only searching doesn't go with extrapolating a seed file, counting, or a distributed search\n");
+        return EXIT_FAILURE;
+    }
+    if(resuming && extrapolatePath != NULL) {
+        fprintf(stderr, "Can't resume a search and extrapolate a seed file at the same time\n");
+        return EXIT_FAILURE;
+    }
+    if((coordinatorPort || workerHost != NULL) && (seedPath != NULL || extrapolatePath != NULL || (coordinatorPort && workerHost != NULL))) {
+        fprintf(stderr, "A distributed coordinator or worker can't also save, resume, or extrapolate seeds\n");
+        return EXIT_FAILURE;
+    }
+    if(countOnly && (seedPath != NULL || extrapolatePath != NULL || coordinatorPort || workerHost != NULL)) {
+        fprintf(stderr, "Counting by meeting in the middle doesn't have any seeds to save, resume, extrapolate, or distribute\n");
+        return EXIT_FAILURE;
+    }
+    #ifndef GPU_EXTRAPOLATION
+    if(useGpu || gpuKernelPath != NULL || gpuBatch) {
+        fprintf(stderr, "Extrapolating on the GPU needs it to be compiled with -DGPU_EXTRAPOLATION\n");
+        return EXIT_FAILURE;
+    }
+    #endif
+    if(useGpu && (benchmark || searchOnly || countOnly || coordinatorPort || workerHost != NULL)) {
+        fprintf(stderr, "The GPU is only for extrapolating on this machine, not the benchmarks, counting, or a distributed search\n");
+        return EXIT_FAILURE;
+    }
+    if(bucketSignatures && seedPath == NULL && extrapolatePath == NULL) {
+        fprintf(stderr, "Bucketing by signature needs a seed file, from --seeds, --resume, or --extrapolate\n");
+        return EXIT_FAILURE;
+    }
+    if(dumpOptions.path != NULL && (benchmark || extrapolatePath != NULL || resuming || countOnly || coordinatorPort || workerHost != NULL)) {
+        fprintf(stderr, "Dumping the codes needs a whole new search on this machine, not a seed file, resuming, counting, or a distributed search\n");
+        return EXIT_FAILURE;
+    }
+    if(dumpOptions.path == NULL && (dumpPrefix != NULL || dumpOptions.packed || dumpOptions.compress)) {
+        fprintf(stderr, "The dump options need --dump-codes or --dump-seeds\n");
+        return EXIT_FAILURE;
+    }
+    #ifndef CODE_DUMP_ZLIB
+    if(dumpOptions.compress) {
+        fprintf(stderr, "Compressing the dumps needs it to be compiled with -DCODE_DUMP_ZLIB\n");
+        return EXIT_FAILURE;
+    }
+    #endif
+    if(dumpPrefix != NULL) {
+        for(const char *digit = dumpPrefix; *digit; digit++) {
+            if(*digit < '0' || *digit >= '0' + NUM_DIGITS || dumpOptions.prefixLen == len) {
+                fprintf(stderr, "The dump prefix has to be up to %d digits from 0 to %d\n", len, NUM_DIGITS - 1);
+                return EXIT_FAILURE;
+            }
+            dumpOptions.prefix[dumpOptions.prefixLen++] = 1 << (*digit - '0');
+        }
+    }
+    #ifndef MEET_IN_THE_MIDDLE
+    if(countOnly) {
+        fprintf(stderr, "Counting by meeting in the middle only goes up to 5 digits\n");
+        return EXIT_FAILURE;
+    }
+    #endif
+
     // Print opening empty line
     printf("\n");
 
-    #ifdef RUNTIME
-    // Get starting benchmark time
+    // Get starting benchmark time, the wall time for the stats and the CPU time too
     clock_t start_time = clock();
-    #endif
+    RunStats runStats;
+    memset(&runStats, 0, sizeof(runStats));
+    runStats.startSeconds = getWallSeconds();
+    runStats.interval = statsInterval;
+    if(statsPath != NULL && (runStats.file = fopen(statsPath, "w")) == NULL) {
+        perror(statsPath);
+        return EXIT_FAILURE;
+    }
 
 
     // First, calculate the "lowest" grey code, the 01020103...
@@ -647,48 +2326,47 @@ int main()
     }
     lowest[len - 1] >>= 1; // The last number will be over, so decrement it to get the the "first" grey code.
 
+    #ifdef MEET_IN_THE_MIDDLE
+    // If only counting, meet in the middle (see MeetInTheMiddle.c) and that's it
+    if(countOnly) {
+        size_t numFirstHalves;
+        printf(" ------- Counting the codes by meeting in the middle...\n");
+        unsigned long long totalCodes = countCodesMeetInTheMiddle(&numFirstHalves);
+        printf(" ---------- There were %zu different first halves.\n", numFirstHalves);
+        printf("\n ---------- The number of grey codes with %d digits is \e[31m%lld\e[0m.", NUM_DIGITS, totalCodes);
+        if(showRuntime)
+            printf("\n-- This run took %f seconds, %f seconds of CPU time.\n", getWallSeconds() - runStats.startSeconds,
+                ((double) (clock() - start_time)) / CLOCKS_PER_SEC );
+        printf("\n");
+        return EXIT_SUCCESS;
+    }
+    #endif
 
-    // Create the queue of swaps (to get through all swap permutations of each seed), n! swaps long (The first being a non-swap).
-    queueSize = 1;
-    for(int i = NUM_DIGITS; i > 1; i--) 
-        queueSize *= i;
-    step queue[queueSize][2];
-    queue[0][0] = 99;
-    queue[0][1] = 99;
-    unsigned int indicesToSwap[NUM_DIGITS];
-    for(int i = 0; i < NUM_DIGITS; i++) 
-        indicesToSwap[i] = i;
-    addQueueSwaps(NUM_DIGITS, 1, queue, indicesToSwap);
-
-    // Create two queues of swaps, one for n-3 digits, one for n-4 digits. Used to swap the non-set digits when 
-    //    finding relevant children in code and seed searching.
-    unsigned long long nMinus3Factorial = 1;
-    unsigned long long nMinus4Factorial = 1;
-    for(int i = NUM_DIGITS - 3; i > 1; i--)
-        nMinus3Factorial *= i;
-    for(int i = NUM_DIGITS - 4; i > 1; i--)
-        nMinus4Factorial *= i;
-    
-    stepMask queueMinus3[nMinus3Factorial][2];
-    stepMask queueMinus4[nMinus4Factorial][2];
-    // The initial useless swaps
-    queueMinus3[0][0] = 99;
-    queueMinus3[0][1] = 99;
-    queueMinus4[0][0] = 99;
-    queueMinus4[0][1] = 99;
-
-    // Add the extra swaps, if they are needed.
-    if(NUM_DIGITS > 4) {
-        unsigned int indicesToSwapMinus3[NUM_DIGITS - 3];
-        for(int i = NUM_DIGITS - 1; i >= 3; i--)
-            indicesToSwapMinus3[NUM_DIGITS - 1 - i] = (1 << i);
-        addQueueSwapsMasks(NUM_DIGITS - 3, 1, queueMinus3, indicesToSwapMinus3);
-    }
-    if(NUM_DIGITS > 5) {
-        unsigned int indicesToSwapMinus4[NUM_DIGITS - 4];
-        for(int i = NUM_DIGITS - 1; i >= 4; i--) 
-            indicesToSwapMinus4[NUM_DIGITS - 1 - i] = (1 << i);
-        addQueueSwapsMasks(NUM_DIGITS - 4, 1, queueMinus4, indicesToSwapMinus4);
+
+    // Create the table of all the relabelings (to get through all the permutations of each seed), n! long (The first being the identity).
+    PermutationTable *permutations = createPermutationTable();
+    queueSize = permutations->count;
+
+    // Create the queues of swaps for each number of digits the prefix classes can use. The queue for m digits goes
+    //    through all the permutations of the other n-m digits, and is used to swap the non-set digits when finding
+    //    relevant children in code and seed searching.
+    stepMask (*extraSwapQueues[NUM_DIGITS + 1])[2];
+    unsigned long long extraSwapQueueLens[NUM_DIGITS + 1];
+    for(int m = 0; m <= NUM_DIGITS; m++) {
+        extraSwapQueueLens[m] = 1;
+        for(int i = NUM_DIGITS - m; i > 1; i--)
+            extraSwapQueueLens[m] *= i;
+        extraSwapQueues[m] = malloc(sizeof(stepMask) * 2 * extraSwapQueueLens[m]);
+
+        // The initial useless swap, then the extra swaps, if they are needed.
+        extraSwapQueues[m][0][0] = 99;
+        extraSwapQueues[m][0][1] = 99;
+        if(NUM_DIGITS - m > 1) {
+            unsigned int indicesToSwap[NUM_DIGITS - m];
+            for(int i = NUM_DIGITS - 1; i >= m; i--)
+                indicesToSwap[NUM_DIGITS - 1 - i] = (1 << i);
+            addQueueSwapsMasks(NUM_DIGITS - m, 1, extraSwapQueues[m], indicesToSwap);
+        }
     }
     
     
@@ -697,7 +2375,8 @@ int main()
 
 
 
-    // Create the quick rotation lookup table
+    #ifndef FIXED_WIDTH_KEYS
+    // Create the quick rotation lookup table, only needed when the extrapolation has to use GMP sequenceNums
     /*  I got to a nice formula for calculating rotations. Where N is the sequence number and n is the number of digits, and
         f is the first step in the sequence, the next rotation (moving the first step to the end) can be calculated by doing:
         N*n - f( n^(2^n) - 1 ). Everything in the parentheses is based on constants, so we can calculate that and all the possible
@@ -716,160 +2395,461 @@ int main()
         mpz_init(multiplesTable[i]);
         mpz_mul_ui(multiplesTable[i], multiplesTable[1], i);
     }
+    #endif
 
 
 
-    // ----- STAGE 2: CODE AND SEED SEARCHING
-    /* This stage involves using the main.c algorithm to find all of the grey codes starting with either
-    01020, 01021, or 01023 using three different threads. The threads are created and passed in a struct with their initial
-    step values, then the thread exits after filling the struct with how many codes it found, and an allocated array of
-    pointers to allocated sequnces (which are arrays of steps)
+    // ----- STAGE 2 AND 3: CODE AND SEED SEARCHING, AND EXTRAPOLATION
+    /* This stage involves using the main.c algorithm to find all of the seeds. Every seed starts with one of the set starts
+    made in PrefixClasses.c, like 01020 or 01203, which are the prefix classes. The classes are split into lots of tasks by setting
+    more steps after the class's set start, and the tasks are ran by a work-stealing pool with one worker per core. Each
+    worker fills batches of allocated sequences (which are arrays of steps) and pushes them onto the seed queue, and at the
+    same time the extrapolation threads pop the batches off and extrapolate them. So the extrapolation is done pretty much
+    as soon as the search is.
     */
 
     // Total count for all the threads. This is out final answer.
     unsigned long long totalNumGreyCodes = 0;
     unsigned long long totalNumSeeds = 0;
+    unsigned long long resumedClassSeeds[MAX_PREFIX_CLASSES] = {};   // When resuming, the seeds from before the checkpoint in each class
 
-    // Array of the thread ids
-    pthread_t threadIds[THREAD_COUNT_CODE_SEARCH];
+    // Array of all the prefix classes
+    PrefixClass *prefixClasses = (PrefixClass *)malloc(sizeof(PrefixClass) * MAX_PREFIX_CLASSES);
 
-    // Initialize the extrapolate val's unchanging references.
-    ExtrapolateThreadStruct extrapolateVal;
-    extrapolateVal.multiplesTablePointer = multiplesTable;
-    extrapolateVal.queueStepPointer = queue;
-    extrapolateVal.exitOrNo = false;
-
-    // Array of all the initial steps
-    CodeSearchThreadStruct threadVals[THREAD_COUNT_CODE_SEARCH];
+    // Create all the prefix classes that will be used
+    int numPrefixClasses = makePrefixClasses(prefixClasses, extraSwapQueues, extraSwapQueueLens);
+    if(!numPrefixClasses) {
+        fprintf(stderr, "There are more than %d prefix classes with %d set steps.\n", MAX_PREFIX_CLASSES, PREFIX_CLASS_STEPS);
+        return EXIT_FAILURE;
+    }
 
-    // Create all the initial step values that will be used
-    threadVals[0] = (CodeSearchThreadStruct){5, {1,2,1,4,1}, NULL, NULL, 0, checkStepsIn01020, queueMinus3, nMinus3Factorial};
-    threadVals[1] = (CodeSearchThreadStruct){5, {1,2,1,4,2}, NULL, checkStepsForLower01021, 4, checkStepsIn01021, queueMinus3, nMinus3Factorial};
-    threadVals[2] = (CodeSearchThreadStruct){5, {1,2,1,4,8}, NULL, checkStepsForLower01023, 4, checkStepsIn01023, queueMinus4, nMinus4Factorial};
-    threadVals[3] = (CodeSearchThreadStruct){4, {1,2,4,1}, NULL, checkStepsForLower0120, 2, checkStepsIn0120, queueMinus3, nMinus3Factorial};
-    threadVals[4] = (CodeSearchThreadStruct){4, {1,2,4,8}, NULL, checkStepsForLower0123, 3, checkStepsIn0123, queueMinus4, nMinus4Factorial};
+    // Split the classes into tasks, counting them first so the array can be allocated
+    CodeSearchContext searchContext;
+    size_t numTasks = makeSearchTasks(prefixClasses, numPrefixClasses, taskDepth, NULL);
+    searchContext.tasks = (CodeSearchTask *)malloc(sizeof(CodeSearchTask) * numTasks);
+    makeSearchTasks(prefixClasses, numPrefixClasses, taskDepth, searchContext.tasks);
+
+    // If benchmarking, that's all that needs to be set up
+    if(benchmark) {
+        #ifdef FIXED_WIDTH_KEYS
+        void *benchmarkMultiples = NULL;
+        #else
+        void *benchmarkMultiples = multiplesTable;
+        #endif
+        bool benchmarkOk = runBenchmarks(searchContext.tasks, numTasks, permutations, benchmarkMultiples, benchmarkSeedPath,
+                                         benchmarkSavePath, benchmarkBaselinePath);
+        free(searchContext.tasks);
+        printf("\n");
+        return benchmarkOk ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
 
-    // Generate the threads and pass in the value.
+    // One search worker and one extrapolation thread per core, unless they were given. None if only searching.
+    if(numThreads < 1) numThreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if(numThreads < 1) numThreads = 1;
+    int numWorkers = numSearchThreads > 0 ? numSearchThreads : numThreads;
+    if(numExtrapolateThreads < 1) numExtrapolateThreads = useGpu ? 1 : numThreads;
+    if(searchOnly) numExtrapolateThreads = 0;
+
+    // If extrapolating on the GPU, find it and build the kernel. The extrapolation threads just feed it.
+    ExtrapolationMode extrapolationMode = DEFAULT_EXTRAPOLATION_MODE;
+    void *gpu = NULL;
+    #ifdef GPU_EXTRAPOLATION
+    if(useGpu) {
+        GpuExtrapolator *gpuExtrapolator = createGpuExtrapolator(gpuKernelPath != NULL ? gpuKernelPath : DEFAULT_GPU_KERNEL_PATH,
+                                                                 gpuBatch > 0 ? gpuBatch : DEFAULT_GPU_BATCH, queueSize * len);
+        if(gpuExtrapolator == NULL) return EXIT_FAILURE;
+        printf(" ------- Extrapolating on %s, fed by %d thread%s.\n\n", gpuExtrapolator->deviceName, numExtrapolateThreads,
+            numExtrapolateThreads == 1 ? "" : "s");
+        extrapolationMode = EXTRAPOLATE_GPU;
+        gpu = gpuExtrapolator;
+    }
+    #endif
 
-    for(int i = 0; i < THREAD_COUNT_CODE_SEARCH; i++) {
-        //if(i == 0) pthread_create(threadIds + i, NULL, &calculateCodesWithSetStart, (void *)(threadVals + i));
-        pthread_create(threadIds + i, NULL, &calculateCodesWithSetStart, (void *)(threadVals + i));
+    // If placing the threads, find the nodes to put them on
+    NumaTopology numaTopology;
+    const NumaTopology *numa = NULL;
+    int numNodes = 1;
+    if(placeOnNuma) {
+        numNodes = readNumaTopology(&numaTopology);
+        numa = &numaTopology;
+        printf(" ------- Placing the threads on %d NUMA node%s.\n\n", numNodes, numNodes == 1 ? "" : "s");
     }
 
-    // Wait for all the earlier threads and add up their totals.
-    for(int i = THREAD_COUNT_CODE_SEARCH - 1; i; i--) {
+    // If verifying the extrapolation, that doesn't need the search at all
+    if(verifyExtrapolationPath != NULL) {
+        #ifdef FIXED_WIDTH_KEYS
+        void *verifyMultiples = NULL;
+        #else
+        void *verifyMultiples = multiplesTable;
+        #endif
+        free(searchContext.tasks);
+        bool verifyOk = verifyExtrapolation(verifyExtrapolationPath, numExtrapolateThreads, extrapolateBatch, permutations, verifyMultiples, gpu);
+        if(showRuntime)
+            printf("\n-- This run took %f seconds, %f seconds of CPU time.\n", getWallSeconds() - runStats.startSeconds,
+                ((double) (clock() - start_time)) / CLOCKS_PER_SEC );
+        printf("\n");
+        return verifyOk ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
 
-        // Wait for it to finish
-        pthread_join(threadIds[i], NULL);
-        totalNumSeeds += threadVals[i].count;
+    // If verifying the search, read what it should find before starting it
+    SeedTextFile verifyReference;
+    bool verifyOk = true;
+    if(verifySearchPath != NULL && !readSeedTextFile(verifySearchPath, 0, &verifyReference)) return EXIT_FAILURE;
+
+    // If this is part of a distributed search, the coordinator hands out ranges of the tasks to the workers, which
+    //    search and extrapolate them and send back the totals.
+    DistributedSearchShape searchShape = {NUM_DIGITS, taskDepth, numTasks};
+    if(workerHost != NULL) {
+        DistributedWorkerContext workerContext;
+        workerContext.tasks = searchContext.tasks;
+        workerContext.numWorkers = numWorkers;
+        workerContext.numExtrapolateThreads = numExtrapolateThreads;
+        workerContext.permutations = permutations;
+        #ifndef FIXED_WIDTH_KEYS
+        workerContext.multiplesTablePointer = multiplesTable;
+        #endif
+        workerContext.numa = numa;
+        bool workerDone = runDistributedWorker(workerHost, workerPort, &searchShape, &runDistributedUnit, (void *)&workerContext);
+        free(searchContext.tasks);
+        printf("\n ------- %s.\n", workerDone ? "Every unit is done" : "Stopped");
+        return workerDone ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    if(coordinatorPort) {
+        DistributedResult distributedTotal;
+        free(searchContext.tasks);
+        if(!runDistributedCoordinator(coordinatorPort, &searchShape, unitTasks, unitTimeout, &distributedTotal))
+            return EXIT_FAILURE;
+
+        for(int c = 0; c < numPrefixClasses; c++) {
+            char className[PREFIX_CLASS_STEPS + 1];
+            getPrefixClassName(prefixClasses + c, className);
+            printf(" ---- Seeds found was %lld with %d digits in class %s. \n\n", distributedTotal.classSeeds[c], NUM_DIGITS, className);
+        }
+        printf(" ---------- The num of seeds found total for %d digits was: \e[31m%lld\e[0m\n", NUM_DIGITS, distributedTotal.numSeeds);
+        printf("\n ---------- The number of grey codes with %d digits is \e[31m%lld\e[0m.", NUM_DIGITS, distributedTotal.numGreyCodes);
+        if(showRuntime)
+            printf("\n-- This run took %f seconds, %f seconds of the coordinator's CPU time.\n", getWallSeconds() - runStats.startSeconds,
+                ((double) (clock() - start_time)) / CLOCKS_PER_SEC );
+        printf("\n");
+        return EXIT_SUCCESS;
+    }
 
-        // Initialize the struct
-        extrapolateVal.seeds = threadVals[i].seeds;
-        extrapolateVal.numSeedsToExtrapolate = threadVals[i].count;
+    // If resuming, read the checkpoint and make sure it's for the same tasks. Then cut the seed file back to it.
+    CheckpointFileHeader checkpoint;
+    SearchPosition *checkpointPositions = NULL;
+    uint8_t *checkpointTasks = NULL;
+    SeedStore *seedStore = NULL;
+    if(resuming) {
+        if(!readSearchCheckpoint(seedPath, &checkpoint, &checkpointTasks, &checkpointPositions)) return EXIT_FAILURE;
+        if(checkpoint.taskDepth != (unsigned int)taskDepth || checkpoint.numTasks != numTasks) {
+            fprintf(stderr, "%s.ckpt: the checkpoint has %llu tasks of %u set steps, but this search has %zu tasks of %d\n", seedPath, 
+                (unsigned long long)checkpoint.numTasks, checkpoint.taskDepth, numTasks, taskDepth);
+            return EXIT_FAILURE;
+        }
+        if((seedStore = openSeedStore(seedPath, checkpoint.seedCount)) == NULL) return EXIT_FAILURE;
+    }
 
-        // Extrapolate this thread's seeds
-        extrapolateSeeds((void *)&extrapolateVal);
+    // If extrapolating a seed file, or the seeds from before the checkpoint when resuming, map it so every extrapolation
+    //    thread can read its own slice of it
+    MappedSeedFile seedFile;
+    const char *mappedPath = resuming ? seedPath : extrapolatePath;
+    if(bucketSignatures && extrapolatePath != NULL && !bucketSeedFile(extrapolatePath)) return EXIT_FAILURE;
+    if(mappedPath != NULL) {
+        if(!mapSeedFile(mappedPath, &seedFile)) return EXIT_FAILURE;
+        printf(" ------- Extrapolating %llu seeds from %s...\n\n", (unsigned long long)seedFile.count, mappedPath);
+    }
 
-        // Add it's count to the total
-        totalNumGreyCodes += extrapolateVal.numGreyCodes;
+    // Start the extrapolation threads first, they just wait on the queue until the first batch comes in
+    SeedQueue *seedQueue = createSeedQueue(numNodes);
+    pthread_t *extrapolateThreadIds = (pthread_t *)malloc(sizeof(pthread_t) * numExtrapolateThreads);
+    ExtrapolateThreadStruct *extrapolateThreadVals = (ExtrapolateThreadStruct *)calloc(numExtrapolateThreads, sizeof(ExtrapolateThreadStruct));
+    uint64_t fileCursor = 0;                                 // The next seed in the seed file to hand out, if there is one
+    for(int i = 0; i < numExtrapolateThreads; i++) {
+        extrapolateThreadVals[i].seedQueue = seedQueue;
+        extrapolateThreadVals[i].mode = extrapolationMode;
+        extrapolateThreadVals[i].seedFile = mappedPath != NULL ? &seedFile : NULL;
+        extrapolateThreadVals[i].fileCursor = &fileCursor;
+        extrapolateThreadVals[i].fileBatchSize = extrapolateBatch;
+        extrapolateThreadVals[i].permutations = permutations;
+        #ifndef FIXED_WIDTH_KEYS
+        extrapolateThreadVals[i].multiplesTablePointer = multiplesTable;
+        #endif
+        extrapolateThreadVals[i].numa = numa;
+        extrapolateThreadVals[i].numaNode = getNumaNodeFor(i, numExtrapolateThreads, numNodes);
+        #ifdef GPU_EXTRAPOLATION
+        extrapolateThreadVals[i].gpu = (const GpuExtrapolator *)gpu;
+        #endif
+        pthread_create(extrapolateThreadIds + i, NULL, &extrapolateSeeds, (void *)(extrapolateThreadVals + i));
+    }
 
-        // Free the seeds and the seed list
-        for(int j = 0; j < threadVals[i].count; j++)
-            free(threadVals[i].seeds[j]);
-        free(threadVals[i].seeds);
+    // If writing the stats, start the writer too. It picks the search up once it starts.
+    pthread_t statsThreadId;
+    runStats.extrapolateThreads = extrapolateThreadVals;
+    runStats.numExtrapolateThreads = numExtrapolateThreads;
+    if(runStats.file != NULL) {
+        pthread_mutex_init(&(runStats.lock), NULL);
+        pthread_cond_init(&(runStats.stop), NULL);
+        pthread_create(&statsThreadId, NULL, &writeRunStats, (void *)&runStats);
     }
 
-    // Wait for the long thread
-    pthread_join(threadIds[0], NULL);
+    // Unless extrapolating a seed file, run the search
+    if(extrapolatePath == NULL) {
+        // Set up the search workers
+        searchContext.numTasks = numTasks;
+        searchContext.taskDepth = taskDepth;
+        searchContext.tasksRun = 0;
+        searchContext.numWorkers = numWorkers;
+        searchContext.workers = (CodeSearchWorker *)calloc(numWorkers, sizeof(CodeSearchWorker));
+        searchContext.completedTasks = (uint8_t *)calloc(numTasks, sizeof(uint8_t));
+        searchContext.resumePositions = NULL;
+        searchContext.checkpointEpoch = 0;
+        searchContext.checkpointInterval = checkpointInterval;
+        searchContext.progressInterval = progressInterval;
+        searchContext.searchDone = false;
+        searchContext.seedStore = seedStore;
+        searchContext.numa = numa;
+        SeqHashTable *seenSeeds = checkDuplicates || verifySearchPath != NULL ? createSeqTable(12) : NULL;
+        if(seedPath != NULL && !resuming) {
+            // Every seed starts with 0,1, so that's the prefix of the file
+            step seedPrefix[2] = {0, 1};
+            if((searchContext.seedStore = createSeedStore(seedPath, seedPrefix, 2)) == NULL) return EXIT_FAILURE;
+        }
 
-    // Add it's count
-    totalNumSeeds += threadVals[0].count;
+        // When resuming, the tasks done in the checkpoint are done already, and the partway done ones get their positions
+        if(resuming) {
+            memcpy(searchContext.completedTasks, checkpointTasks, numTasks);
+            searchContext.resumePositions = (const step **)calloc(numTasks, sizeof(const step *));
+            for(uint64_t i = 0; i < checkpoint.numPositions; i++)
+                if(checkpointPositions[i].taskIndex >= 0 && checkpointPositions[i].hasPosition)
+                    searchContext.resumePositions[checkpointPositions[i].taskIndex] = checkpointPositions[i].position;
+
+            // The seeds from before the checkpoint count too
+            step seed[len];
+            for(uint64_t i = 0; i < seedFile.count; i++) {
+                unpackSequence(seedFile.seeds[i], seed);
+                if(seenSeeds != NULL && !seqHashInsertIfNotContains(seenSeeds, seedFile.seeds[i]))
+                    printf("Seed in %s twice: %llu\n", seedPath, (unsigned long long)i);
+                for(int c = 0; c < numPrefixClasses; c++) {
+                    int j;
+                    for(j = 0; j < prefixClasses[c].numSetSteps && seed[j] == log2(prefixClasses[c].setSteps[j]); j++);
+                    if(j == prefixClasses[c].numSetSteps) resumedClassSeeds[c]++;
+                }
+            }
+            totalNumSeeds += seedFile.count;
+
+            int numDone = 0;
+            for(size_t t = 0; t < numTasks; t++) numDone += searchContext.completedTasks[t] != 0;
+            printf(" ------- Resuming from the checkpoint with %d of the tasks done and %llu seeds found...\n\n", 
+                numDone, (unsigned long long)seedFile.count);
+        }
+        for(int i = 0; i < numWorkers; i++) {
+            searchContext.workers[i].numaNode = getNumaNodeFor(i, numWorkers, numNodes);
+            searchContext.workers[i].seedArena = createSeedArena(searchContext.workers[i].numaNode);
+            searchContext.workers[i].seedQueue = searchOnly ? NULL : seedQueue;
+            searchContext.workers[i].seedStore = searchContext.seedStore;
+            searchContext.workers[i].completedTasks = searchContext.completedTasks;
+            searchContext.workers[i].checkpointEpoch = &(searchContext.checkpointEpoch);
+            searchContext.workers[i].published.taskIndex = -1;
+            searchContext.workers[i].seenSeeds = seenSeeds;
+            pthread_mutex_init(&(searchContext.workers[i].publishLock), NULL);
+            if(dumpOptions.path != NULL && (searchContext.workers[i].codeDump = openCodeDump(&dumpOptions, i)) == NULL)
+                return EXIT_FAILURE;
+        }
+        if(searchOnly)
+            printf(" ------- Searching %zu tasks of %d set steps with %d workers, not extrapolating...\n\n", 
+                numTasks, taskDepth, numWorkers);
+        else
+            printf(" ------- Searching %zu tasks of %d set steps with %d workers, extrapolating with %d threads...\n\n", 
+                numTasks, taskDepth, numWorkers, numExtrapolateThreads);
+
+        // Run the pool and wait for it to run out of tasks
+        // If saving the seeds, the checkpointer runs alongside it, and the progress reporter if there's an interval
+        pthread_t checkpointThreadId, progressThreadId;
+        bool watchingSearch = searchContext.seedStore != NULL || progressInterval > 0;
+        if(watchingSearch) {
+            pthread_mutex_init(&(searchContext.checkpointLock), NULL);
+            pthread_cond_init(&(searchContext.checkpointStop), NULL);
+        }
+        if(searchContext.seedStore != NULL)
+            pthread_create(&checkpointThreadId, NULL, &checkpointSearch, (void *)&searchContext);
+        if(progressInterval > 0)
+            pthread_create(&progressThreadId, NULL, &reportSearchProgress, (void *)&searchContext);
+        WorkStealingPool *searchPool = createWorkStealingPool(numWorkers, numTasks, &runCodeSearchTask, (void *)&searchContext);
+        searchPool->startWorker = &startCodeSearchWorker;
+        runStats.searchContext = &searchContext;
+        setRunStage(&runStats, STAGE_SEARCH);
+        startWorkStealingPool(searchPool);
+        joinWorkStealingPool(searchPool);
+        setRunStage(&runStats, STAGE_EXTRAPOLATE);
+        freeWorkStealingPool(searchPool);
+        free(searchContext.tasks);
+
+        // Stop the checkpointer and the progress reporter, and take one last checkpoint, now with every task done and
+        //    every seed in the file
+        if(watchingSearch) {
+            pthread_mutex_lock(&(searchContext.checkpointLock));
+            searchContext.searchDone = true;
+            pthread_cond_broadcast(&(searchContext.checkpointStop));
+            pthread_mutex_unlock(&(searchContext.checkpointLock));
+            if(progressInterval > 0) pthread_join(progressThreadId, NULL);
+        }
+        if(searchContext.seedStore != NULL) {
+            pthread_join(checkpointThreadId, NULL);
+            takeSearchCheckpoint(&searchContext);
+            printf(" ------- Saved %llu seeds to %s.\n\n", (unsigned long long)searchContext.seedStore->count, seedPath);
+            closeSeedStore(searchContext.seedStore);
+        }
+        if(watchingSearch) {
+            pthread_mutex_destroy(&(searchContext.checkpointLock));
+            pthread_cond_destroy(&(searchContext.checkpointStop));
+        }
+        for(int i = 0; i < numWorkers; i++)
+            pthread_mutex_destroy(&(searchContext.workers[i].publishLock));
+
+        // Write out the rest of the dumps
+        if(dumpOptions.path != NULL) {
+            unsigned long long dumped = 0;
+            for(int i = 0; i < numWorkers; i++)
+                dumped += closeCodeDump(searchContext.workers[i].codeDump);
+            printf(" ------- Dumped %llu %s to %s.0", dumped, dumpOptions.seedsOnly ? "seeds" : "codes", dumpOptions.path);
+            if(numWorkers > 1) printf(" through %s.%d", dumpOptions.path, numWorkers - 1);
+            printf(".\n\n");
+        }
+        free(searchContext.completedTasks);
+        free(searchContext.resumePositions);
+        free(checkpointTasks);
+        free(checkpointPositions);
+
+        // Push every worker's last partly full batch, then close the queue so the extrapolation threads finish up
+        unsigned long long duplicates = 0;
+        for(int i = 0; i < numWorkers; i++) {
+            if(!searchOnly) pushSeedBatch(seedQueue, searchContext.workers[i].batch);
+            totalNumSeeds += searchContext.workers[i].count;
+            duplicates += searchContext.workers[i].duplicates;
+        }
+        closeSeedQueue(seedQueue);
+
+        // If checking for duplicates, say how it went
+        if(seenSeeds != NULL) {
+            if(duplicates)
+                printf(" ------- \e[31m%llu seeds were found more than once!\e[0m\n\n", duplicates);
+            else
+                printf(" ------- All %zu seeds were only found once.\n\n", getSeqTableCount(seenSeeds));
+            if(verifySearchPath != NULL) {
+                printf(" ------- Verifying the seeds against %s...\n", verifySearchPath);
+                verifyOk = verifySearchSeeds(&verifyReference, verifySearchPath, seenSeeds) && duplicates == 0;
+                printf("\n");
+            }
+            freeSeqTable(seenSeeds);
+        }
+
+        // Print the final statistics for each class
+        for(int c = 0; c < numPrefixClasses; c++) {
+            unsigned long long classSeeds = resumedClassSeeds[c];
+            for(int i = 0; i < numWorkers; i++)
+                classSeeds += searchContext.workers[i].classSeeds[c];
+            char className[PREFIX_CLASS_STEPS + 1];
+            getPrefixClassName(prefixClasses + c, className);
+            printf(" ---- Seeds found was %lld with %d digits in class %s. \n\n", classSeeds, NUM_DIGITS, className);
+        }
+
+    } else {
+        // The seed file is already split up between the extrapolation threads, so there's nothing to search
+        setRunStage(&runStats, STAGE_EXTRAPOLATE);
+        free(searchContext.tasks);
+        totalNumSeeds = seedFile.count;
+        closeSeedQueue(seedQueue);
+    }
 
     // Print message of how many were found
     printf(" ---------- The num of seeds found total for %d digits was: \e[31m%lld\e[0m\n", NUM_DIGITS, totalNumSeeds);
     printf(" ---------- Using the upper bound, we can say that the number of codes is close to but less than \e[33m%lld\e[0m.\n", 
         (unsigned long long)(((double)totalNumSeeds - (double)3/4) * queueSize * len));
 
-    #ifdef RUNTIME
-    // Get end benchmarking time
-    clock_t end_time = clock();
-    printf("\n-- Got here in %f seconds.\n", ((double) (end_time - start_time)) / CLOCKS_PER_SEC );
-    #endif
-
-
-    // ----- STAGE 3: FINAL EXTRAPOLATION
-
-    #ifdef RUNTIME
     // Get end benchmarking time
-    clock_t segment_start_time = clock();
-    #endif
+    if(showRuntime)
+        printf("\n-- The search finished in %f seconds.\n", runStats.stageStarts[STAGE_EXTRAPOLATE]);
 
     // Update message
-    printf("\n ------- Beginning the seed extrapolating...\n");
-
-    // Variables
-    int seedsPerThread = threadVals[0].count / THREAD_COUNT_EXTRAPOLATION;  // The amount of seeds per thread
-
-    // Array of the thread ids
-    pthread_t extrapolateThreadIds[THREAD_COUNT_EXTRAPOLATION];
+    if(!searchOnly)
+        printf("\n ------- Finishing the seed extrapolating...\n");
 
-    // Array of all the values
-    ExtrapolateThreadStruct extrapolateThreadVals[THREAD_COUNT_EXTRAPOLATION];
-
-    // Initialize all the values.
-    for(int i = 0; i < THREAD_COUNT_EXTRAPOLATION; i++) {
-        // Each one gets a different start in the seeds array
-        extrapolateThreadVals[i].seeds = threadVals[0].seeds + (seedsPerThread * i);
-
-        // The first ones get their fraction, the last does the rest.
-        if(i != THREAD_COUNT_EXTRAPOLATION - 1) 
-            extrapolateThreadVals[i].numSeedsToExtrapolate = seedsPerThread;
-        else 
-            extrapolateThreadVals[i].numSeedsToExtrapolate = threadVals[0].count - (seedsPerThread * 3);
-        
-        // Pass in the list references it needs
-        extrapolateThreadVals[i].queueStepPointer = queue;
-        extrapolateThreadVals[i].multiplesTablePointer = multiplesTable;
-
-        // Make it exit at the end
-        extrapolateThreadVals[i].exitOrNo = true;
+    // Wait for all the extrapolation threads, add up their totals, and say how each one did
+    for(int i = 0; i < numExtrapolateThreads; i++) {
+        pthread_join(extrapolateThreadIds[i], NULL);
+        totalNumGreyCodes += extrapolateThreadVals[i].numGreyCodes;
     }
-
-    // Start each of the threads
-    for(int i = 0; i < THREAD_COUNT_EXTRAPOLATION; i++) {
-        pthread_create(extrapolateThreadIds + i, NULL, &extrapolateSeeds, (void *)(extrapolateThreadVals + i));
+    setRunStage(&runStats, STAGE_DONE);
+
+    // Everything's stopped, so stop the stats writer and write the final line
+    if(runStats.file != NULL) {
+        pthread_mutex_lock(&(runStats.lock));
+        runStats.done = true;
+        pthread_cond_signal(&(runStats.stop));
+        pthread_mutex_unlock(&(runStats.lock));
+        pthread_join(statsThreadId, NULL);
+        writeStatsLine(&runStats, ((double) (clock() - start_time)) / CLOCKS_PER_SEC);
+        fclose(runStats.file);
+        pthread_mutex_destroy(&(runStats.lock));
+        pthread_cond_destroy(&(runStats.stop));
+    }
+    for(int i = 0; i < numExtrapolateThreads; i++)
+        printf(" ---- Extrapolation thread %d did %llu seeds in %f seconds, %f of them waiting for seeds.\n", i,
+            extrapolateThreadVals[i].numSeeds, extrapolateThreadVals[i].seconds, extrapolateThreadVals[i].waitSeconds);
+    freeSeedQueue(seedQueue);
+    if(mappedPath != NULL) unmapSeedFile(&seedFile);
+
+    // The seed file is done being written and read, so it can be bucketed now
+    if(bucketSignatures && seedPath != NULL) {
+        printf("\n");
+        if(!bucketSeedFile(seedPath)) return EXIT_FAILURE;
     }
 
-    // Wait for all the threads, add up their totals
-    for(int i = 0; i < THREAD_COUNT_EXTRAPOLATION; i++) {
-        pthread_join(extrapolateThreadIds[i], NULL);
-        totalNumGreyCodes += extrapolateThreadVals[i].numGreyCodes;
+    // Now that the extrapolation is done with all the batches, the search workers' arenas can go
+    if(extrapolatePath == NULL) {
+        for(int i = 0; i < numWorkers; i++)
+            freeSeedArena(searchContext.workers[i].seedArena);
+        free(searchContext.workers);
     }
+    free(extrapolateThreadIds);
+    free(extrapolateThreadVals);
+    freePermutationTable(permutations);
+    #ifdef GPU_EXTRAPOLATION
+    if(gpu != NULL) freeGpuExtrapolator((GpuExtrapolator *)gpu);
+    #endif
 
-    printf("\n ---------- The number of grey codes with %d digits is \e[31m%lld\e[0m.", NUM_DIGITS, totalNumGreyCodes);
+    if(!searchOnly)
+        printf("\n ---------- The number of grey codes with %d digits is \e[31m%lld\e[0m.", NUM_DIGITS, totalNumGreyCodes);
 
 
-    #ifdef RUNTIME
     // Get end benchmarking time
-    end_time = clock();
-    printf("\n-- This segment took %f seconds.\n", ((double) (end_time - segment_start_time)) / CLOCKS_PER_SEC );
-    printf("-- This run took %f seconds.\n", ((double) (end_time - start_time)) / CLOCKS_PER_SEC );
-    #endif
+    if(showRuntime)
+        printf("\n-- This run took %f seconds, %f seconds of CPU time.\n", getWallSeconds() - runStats.startSeconds,
+            ((double) (clock() - start_time)) / CLOCKS_PER_SEC );
+
+    // If verifying the search, check the totals too, now that they're all in
+    if(verifySearchPath != NULL) {
+        printf("\n\n ------- Verifying the totals against %s...\n", verifySearchPath);
+        verifyOk &= verifySearchTotals(&verifyReference, totalNumSeeds, !searchOnly, totalNumGreyCodes);
+        printf(verifyOk ? "\n ---------- The search matches %s.\n" : "\n ---------- \e[31mThe search doesn't match %s!\e[0m\n",
+            verifySearchPath);
+        freeSeedTextFile(&verifyReference);
+    }
 
     // ----- FINAL STAGE: CLOSING
-    // Free all of the seeds and the list itself
-    for(int i = 0; i < threadVals[0].count; i++) {
-        free(threadVals[0].seeds[i]);
-    }
-    free(threadVals[0].seeds);
-    
+    free(prefixClasses);
+    for(int m = 0; m <= NUM_DIGITS; m++)
+        free(extraSwapQueues[m]);
 
+    #ifndef FIXED_WIDTH_KEYS
     // Free the quick rotation lookup table
     for(int i = 0; i < NUM_DIGITS; i++) {
         mpz_clear(multiplesTable[i]);
     }
+    #endif
 
-    // Exit, success!!
+    // Exit, success!! Unless the verification failed
+    if(!verifyOk) return EXIT_FAILURE;
     pthread_exit(NULL);
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,73 @@
+/**
+ * @file GreyCodeDigits.c
+ * @author Joey Hughes
+ * This is the one binary that covers every digit count, so there doesn't have to be a GreyCodeChimera built for each
+ * one on every machine. Everything in GreyCodeChimera.c is sized by NUM_DIGITS when it's compiled (the keys, the packed
+ * seeds, the tables, the kernels), so it can't be switched at runtime. Instead GreyCodeChimera.c gets compiled once per
+ * digit count, with its main renamed to greyCodeMainN and every other symbol made local so the copies don't clash,
+ * and this main picks which one runs with --digits N. The rest of the options go straight through to it.
+ *
+ * To build it with 4, 5 and 6 digits:
+ * for n in 4 5 6; do
+ *     gcc -Wall -std=c99 -O2 -DNUM_DIGITS=$n -DDIGIT_DISPATCH -Dmain=greyCodeMain$n -c GreyCodeChimera.c -o GreyCodeChimera$n.o
+ *     objcopy --keep-global-symbol=greyCodeMain$n GreyCodeChimera$n.o
+ * done
+ * gcc -Wall -std=c99 -O2 GreyCodeDigits.c GreyCodeChimera4.o GreyCodeChimera5.o GreyCodeChimera6.o -o GreyCodeChimera -lpthread -lgmp
+ * and run it like GreyCodeChimera.c, with --digits N added, like ./GreyCodeChimera --digits 5 --time.
+ * Any of the digit counts from 4 to MAX_DIGIT_COUNT can be left out or put in, the ones that aren't linked in are
+ * just NULL. The other compile flags, like -DBITSET_SEARCH or -mavx2, go on the per digit count lines.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+
+/** The most digits there can be a main for. */
+#define MAX_DIGIT_COUNT 8
+
+/** The mains of GreyCodeChimera.c for each digit count. They're weak, so the ones that weren't linked in are NULL. */
+int greyCodeMain4(int argc, char *argv[]) __attribute__((weak));
+int greyCodeMain5(int argc, char *argv[]) __attribute__((weak));
+int greyCodeMain6(int argc, char *argv[]) __attribute__((weak));
+int greyCodeMain7(int argc, char *argv[]) __attribute__((weak));
+int greyCodeMain8(int argc, char *argv[]) __attribute__((weak));
+
+
+
+/**
+ * Starts the program. Finds --digits N, takes it out of the arguments, and runs the main for N digits with the rest.
+ * @param argc The number of arguments.
+ * @param argv The arguments, see the top of GreyCodeChimera.c for the options.
+ * @return Exit status.
+*/
+int main(int argc, char *argv[])
+{
+    int (*mains[MAX_DIGIT_COUNT + 1])(int, char *[]) = {
+        NULL, NULL, NULL, NULL, greyCodeMain4, greyCodeMain5, greyCodeMain6, greyCodeMain7, greyCodeMain8
+    };
+
+    // Find the digits and take them out
+    int digits = 0;
+    int numArgs = 0;
+    char **args = (char **)malloc(sizeof(char *) * (argc + 1));
+    for(int i = 0; i < argc; i++) {
+        if(i > 0 && strcmp(argv[i], "--digits") == 0 && i + 1 < argc)
+            digits = atoi(argv[++i]);
+        else
+            args[numArgs++] = argv[i];
+    }
+    args[numArgs] = NULL;
+
+    if(digits < 0 || digits > MAX_DIGIT_COUNT || mains[digits] == NULL) {
+        fprintf(stderr, "Usage: %s --digits N [options], where N is one of", argv[0]);
+        for(int d = 0; d <= MAX_DIGIT_COUNT; d++)
+            if(mains[d] != NULL) fprintf(stderr, " %d", d);
+        fprintf(stderr, ". Run it with --digits N --help for the options.\n");
+        free(args);
+        return EXIT_FAILURE;
+    }
+    int status = mains[digits](numArgs, args);
+    free(args);
+    return status;
+}
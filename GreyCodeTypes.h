@@ -35,3 +35,32 @@ typedef sequence **seqPtrArray;
 /** This defines a short name for a large number type to store the sequence numbers.*/
 typedef mpz_t sequenceNum;
 
+/** How many bits each step takes up when a sequence is packed into a fixed width key. Enough for up to 8 digits. */
+#define BITS_PER_STEP 3
+
+/** How many bits a whole packed sequence takes up. */
+#define SEQUENCE_KEY_BITS (BITS_PER_STEP * len)
+
+/** How many bytes a sequence takes up packed at BITS_PER_STEP bits per step, rounded up to a whole byte. 6 bytes at 4 digits, 12 at 5, 24 at 6. */
+#define PACKED_SEQUENCE_BYTES ((SEQUENCE_KEY_BITS + 7) / 8)
+
+/** A sequence packed into bytes, 3 bits per step with the first step in the highest bits of the first byte. This is how
+ * the seeds are held in memory between the search and the extrapolation, and how they're saved in seed files. */
+typedef unsigned char packedSequence[PACKED_SEQUENCE_BYTES];
+
+/** For up to 6 digits, a packed sequence fits in a fixed width integer instead of a GMP integer, so the extrapolation can
+ * use these keys without any allocating. For 7 and up, FIXED_WIDTH_KEYS isn't defined and it falls back on sequenceNum. */
+#if NUM_DIGITS <= 5
+#define FIXED_WIDTH_KEYS 1
+/** A sequence packed into one 128 bit integer, 3 bits per step with the first step in the highest bits. 96 bits are used at 5 digits. */
+__extension__ typedef unsigned __int128 sequenceKey;
+#elif NUM_DIGITS == 6
+#define FIXED_WIDTH_KEYS 1
+/** How many 64 bit words a packed sequence takes up. 64 steps * 3 bits is exactly 192 bits. */
+#define SEQUENCE_KEY_WORDS 3
+/** A sequence packed into three 64 bit words, 3 bits per step with the first step in the highest bits of words[0]. */
+typedef struct {
+    unsigned long long words[SEQUENCE_KEY_WORDS];
+} sequenceKey;
+#endif
+
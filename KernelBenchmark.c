@@ -0,0 +1,199 @@
+/**
+ * @file KernelBenchmark.c
+ * @author Joey Hughes
+ * This is a little benchmark for the kernels in SequenceKernels.c. It runs the scalar and the AVX2 versions of swap,
+ * swapMasks, isLower, and relabelSequence on the same random sequences, makes sure they get the same answers, and prints how long each
+ * one takes per call and how much faster the AVX2 one is. The sequences are the same lengths as in GreyCodeChimera.c,
+ * len for swap, isLower and relabelSequence and len * 2 for swapMasks. relabelSequence goes through the maps of a
+ * PermutationTable in order, like the extrapolation does.
+ *
+ * To run it, compile with AVX2 on, like:
+ * gcc -Wall -std=c99 -O2 -mavx2 -DNUM_DIGITS=5 KernelBenchmark.c -o KernelBenchmark
+ * Without AVX2 it just times the scalar ones.
+*/
+
+/** For clock_gettime with -std=c99. Has to be before any of the system headers. */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "GreyCodeTypes.h"
+#include "PermutationTable.c"
+#include "SequenceKernels.c"
+
+
+/** How many different random sequences to go through. */
+#define NUM_SEQUENCES 1024
+
+/** How many times to go through all of them for each kernel. */
+#ifndef BENCHMARK_ROUNDS
+#define BENCHMARK_ROUNDS 20000
+#endif
+
+
+/** Adds up the results so the compiler can't throw the work away. */
+volatile unsigned long long benchmarkSink;
+
+
+
+/**
+ * Gets the time in seconds.
+ * @return The time in seconds from the monotonic clock.
+*/
+double getSeconds()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + (now.tv_nsec / 1e9);
+}
+
+
+
+/**
+ * Prints how long the scalar and vector versions took and the speedup.
+ * @param name The name of the kernel.
+ * @param scalarSeconds How long the scalar one took.
+ * @param vectorSeconds How long the vector one took, or less than 0 if there wasn't one.
+ * @param calls How many calls there were.
+*/
+void printTimes(const char *name, double scalarSeconds, double vectorSeconds, double calls)
+{
+    if(vectorSeconds < 0) {
+        printf("%-10s scalar %7.2f ns/call\n", name, (scalarSeconds / calls) * 1e9);
+        return;
+    }
+    printf("%-10s scalar %7.2f ns/call   avx2 %7.2f ns/call   %.2fx faster\n", name, (scalarSeconds / calls) * 1e9,
+        (vectorSeconds / calls) * 1e9, scalarSeconds / vectorSeconds);
+}
+
+
+
+/**
+ * Starts the program.
+ * @return Exit status.
+*/
+int main()
+{
+    // Random sequences, with steps and stepMasks for the digits
+    step (*steps)[len] = malloc(sizeof(step) * len * NUM_SEQUENCES);
+    step (*stepsCheck)[len] = malloc(sizeof(step) * len * NUM_SEQUENCES);
+    stepMask (*masks)[len * 2] = malloc(sizeof(stepMask) * len * 2 * NUM_SEQUENCES);
+    stepMask (*masksCheck)[len * 2] = malloc(sizeof(stepMask) * len * 2 * NUM_SEQUENCES);
+    stepMask (*others)[len] = malloc(sizeof(stepMask) * len * NUM_SEQUENCES);
+    step swapsA[NUM_SEQUENCES], swapsB[NUM_SEQUENCES];
+    srand(12345);
+    for(int s = 0; s < NUM_SEQUENCES; s++) {
+        for(int i = 0; i < len; i++) steps[s][i] = rand() % NUM_DIGITS;
+        for(int i = 0; i < len * 2; i++) masks[s][i] = 1 << (rand() % NUM_DIGITS);
+        // The others match for a random stretch first, since that's the case isLower has to loop for
+        int same = rand() % len;
+        for(int i = 0; i < len; i++) others[s][i] = i < same ? masks[s][i] : (stepMask)(1 << (rand() % NUM_DIGITS));
+        swapsA[s] = rand() % NUM_DIGITS;
+        swapsB[s] = rand() % NUM_DIGITS;
+    }
+    memcpy(stepsCheck, steps, sizeof(step) * len * NUM_SEQUENCES);
+    memcpy(masksCheck, masks, sizeof(stepMask) * len * 2 * NUM_SEQUENCES);
+
+    double calls = (double)BENCHMARK_ROUNDS * NUM_SEQUENCES;
+    double start, scalarSeconds, vectorSeconds = -1;
+    unsigned long long lowerCount = 0;
+    printf("%d digits, %.0f calls each\n\n", NUM_DIGITS, calls);
+
+    // swap
+    start = getSeconds();
+    for(int r = 0; r < BENCHMARK_ROUNDS; r++)
+        for(int s = 0; s < NUM_SEQUENCES; s++)
+            swapScalar(stepsCheck[s], swapsA[s], swapsB[s], len);
+    scalarSeconds = getSeconds() - start;
+    #ifdef AVX2_KERNELS
+    start = getSeconds();
+    for(int r = 0; r < BENCHMARK_ROUNDS; r++)
+        for(int s = 0; s < NUM_SEQUENCES; s++)
+            swapAVX2(steps[s], swapsA[s], swapsB[s], len);
+    vectorSeconds = getSeconds() - start;
+    if(memcmp(steps, stepsCheck, sizeof(step) * len * NUM_SEQUENCES) != 0) {
+        printf("swap doesn't match!\n");
+        return EXIT_FAILURE;
+    }
+    #endif
+    printTimes("swap", scalarSeconds, vectorSeconds, calls);
+
+    // swapMasks
+    start = getSeconds();
+    for(int r = 0; r < BENCHMARK_ROUNDS; r++)
+        for(int s = 0; s < NUM_SEQUENCES; s++)
+            swapMasksScalar(masksCheck[s], 1 << swapsA[s], 1 << swapsB[s], len * 2);
+    scalarSeconds = getSeconds() - start;
+    #ifdef AVX2_KERNELS
+    start = getSeconds();
+    for(int r = 0; r < BENCHMARK_ROUNDS; r++)
+        for(int s = 0; s < NUM_SEQUENCES; s++)
+            swapMasksAVX2(masks[s], 1 << swapsA[s], 1 << swapsB[s], len * 2);
+    vectorSeconds = getSeconds() - start;
+    if(memcmp(masks, masksCheck, sizeof(stepMask) * len * 2 * NUM_SEQUENCES) != 0) {
+        printf("swapMasks doesn't match!\n");
+        return EXIT_FAILURE;
+    }
+    #endif
+    printTimes("swapMasks", scalarSeconds, vectorSeconds, calls);
+
+    // isLower, which doesn't change anything, so the masks are the same for both
+    start = getSeconds();
+    for(int r = 0; r < BENCHMARK_ROUNDS; r++)
+        for(int s = 0; s < NUM_SEQUENCES; s++)
+            lowerCount += isLowerScalar(masks[s], others[s]);
+    scalarSeconds = getSeconds() - start;
+    #ifdef AVX2_KERNELS
+    unsigned long long vectorLowerCount = 0;
+    start = getSeconds();
+    for(int r = 0; r < BENCHMARK_ROUNDS; r++)
+        for(int s = 0; s < NUM_SEQUENCES; s++)
+            vectorLowerCount += isLowerAVX2(masks[s], others[s]);
+    vectorSeconds = getSeconds() - start;
+    if(vectorLowerCount != lowerCount) {
+        printf("isLower doesn't match!\n");
+        return EXIT_FAILURE;
+    }
+    #endif
+    printTimes("isLower", scalarSeconds, vectorSeconds, calls);
+    benchmarkSink = lowerCount;
+
+    // relabelSequence, into stepsCheck and steps, which get overwritten
+    PermutationTable *permutations = createPermutationTable();
+    start = getSeconds();
+    for(int r = 0; r < BENCHMARK_ROUNDS; r++)
+        for(int s = 0; s < NUM_SEQUENCES; s++)
+            relabelSequenceScalar(steps[s], permutations->maps[(r + s) % permutations->count], stepsCheck[s ^ 1]);
+    scalarSeconds = getSeconds() - start;
+    #ifdef AVX2_KERNELS
+    start = getSeconds();
+    for(int r = 0; r < BENCHMARK_ROUNDS; r++)
+        for(int s = 0; s < NUM_SEQUENCES; s++)
+            relabelSequenceAVX2(stepsCheck[s], permutations->maps[(r + s) % permutations->count], steps[s ^ 1]);
+    vectorSeconds = getSeconds() - start;
+    #endif
+    // Both of those feed into each other, so for checking, relabel one fresh set both ways
+    for(int s = 0; s < NUM_SEQUENCES; s++)
+        for(int i = 0; i < len; i++) steps[s][i] = rand() % NUM_DIGITS;
+    for(int s = 0; s < NUM_SEQUENCES; s++) {
+        step scalarOut[len], vectorOut[len];
+        relabelSequenceScalar(steps[s], permutations->maps[s % permutations->count], scalarOut);
+        relabelSequence(steps[s], permutations->maps[s % permutations->count], vectorOut);
+        if(memcmp(scalarOut, vectorOut, sizeof(step) * len) != 0) {
+            printf("relabelSequence doesn't match!\n");
+            return EXIT_FAILURE;
+        }
+    }
+    printTimes("relabel", scalarSeconds, vectorSeconds, calls);
+    freePermutationTable(permutations);
+
+    free(steps);
+    free(stepsCheck);
+    free(masks);
+    free(masksCheck);
+    free(others);
+    return EXIT_SUCCESS;
+}
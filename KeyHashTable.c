@@ -0,0 +1,147 @@
+/**
+ * @file KeyHashTable.c
+ * @author Joey Hughes
+ * This is code for a hash table implementation that stores fixed width sequenceKeys. It's the same as the GMPHashTable
+ * and is used in the same place, the seed extrapolation in GreyCodeChimera.c, but the keys are stored right in the
+ * buckets so nothing has to be allocated or followed through a pointer.
+ * The capacity is always a power of 2 so finding the bucket is a mask instead of a mod, and collisions just go on to the
+ * next bucket (linear probing), which is usually in the same cache line. The buckets are 32 bytes and the array is
+ * 64 byte aligned, so a bucket never gets split across two lines.
+ * The table gets emptied once for every seed, so instead of clearing anything, every bucket has the generation it was
+ * filled in, and it's only occupied if that's the table's current generation. Emptying is just going to the next one.
+ * This hash table supports inserting, checking if it contains a key, and emptying the entire table of all the keys.
+ * This does not support removing or resizing. Everything in here is only defined if FIXED_WIDTH_KEYS is.
+*/
+
+#include <stdbool.h>
+#include <string.h>
+#include <stdlib.h>
+
+#ifndef GREY_CODE_TYPES_DEFINED
+    #include "GreyCodeTypes.h"
+#endif
+#include "SequenceKeys.c"
+
+#ifdef FIXED_WIDTH_KEYS
+
+
+/** How the bucket array is aligned, a cache line. */
+#define KEY_TABLE_ALIGNMENT 64
+
+
+/** One bucket of the table. 32 bytes with the key at 5 or 6 digits, so two to a cache line. */
+typedef struct {
+    /** The key in the bucket. */
+    sequenceKey key;
+    /** The generation the bucket was filled in. The bucket is only occupied if this is the table's generation. */
+    unsigned int generation;
+} KeyBucket;
+
+/** Struct for a whole HashTable. Used in the seed extrapolation part. */
+typedef struct {
+    /** The hash table array. Holds the keys right in the buckets. */
+    KeyBucket *buckets;
+    /** The generation of the keys that are in the table now. Never 0, so the calloced buckets start out empty. */
+    unsigned int generation;
+    /** The total size of the hash table, how many buckets it has. Always a power of 2. */
+    size_t size;
+    /** size - 1, for masking the hash into an index. */
+    size_t mask;
+    /** The number of actual elements in the hash table. */
+    size_t count;
+} KeyHashTable;
+
+
+
+/**
+ * Creates a new KeyHashTable and allocates it.
+ * @param size The capacity to give the new KeyHashTable. It gets rounded up to a power of 2.
+ * @return Pointer to the new KeyHashTable.
+*/
+KeyHashTable *createKeyTable(size_t size)
+{
+    KeyHashTable *table = (KeyHashTable *)malloc(sizeof(KeyHashTable));
+    table->size = 1;
+    while(table->size < size)
+        table->size <<= 1;
+    table->mask = table->size - 1;
+    table->count = 0;
+    table->generation = 1;
+    void *buckets;
+    if(posix_memalign(&buckets, KEY_TABLE_ALIGNMENT, table->size * sizeof(KeyBucket)) != 0) {
+        free(table);
+        return NULL;
+    }
+    table->buckets = (KeyBucket *)buckets;
+    memset(table->buckets, 0, table->size * sizeof(KeyBucket));
+    return table;
+}
+
+
+
+/**
+ * Inserts an element into the KeyHashTable, going on to the next bucket if there is a collision.
+ * @param table The pointer to the KeyHashTable to put the key in.
+ * @param key The sequenceKey to put into the KeyHashTable.
+*/
+static inline void keyHashInsert(KeyHashTable *table, const sequenceKey key)
+{
+    size_t index = hashSequenceKey(key) & table->mask;
+    while(table->buckets[index].generation == table->generation)
+        index = (index + 1) & table->mask;
+
+    table->buckets[index].key = key;
+    table->buckets[index].generation = table->generation;
+    table->count++;
+}
+
+
+
+/**
+ * Returns a bool of whether or not the given table contains the given key.
+ * @param table The pointer to the KeyHashTable to search in.
+ * @param key The sequenceKey to look for.
+ * @return True if the hash table already contains the key, false if not.
+*/
+static inline bool keyHashContains(KeyHashTable *table, const sequenceKey key)
+{
+    size_t index = hashSequenceKey(key) & table->mask;
+
+    // Keep going until an empty bucket, then it's not there.
+    while(table->buckets[index].generation == table->generation) {
+        if(sequenceKeysEqual(table->buckets[index].key, key))
+            return true; // Key found
+        index = (index + 1) & table->mask;
+    }
+    return false; // Key not found
+}
+
+
+
+/**
+ * Empties the table by going to the next generation, so none of the buckets count as occupied anymore, and sets the
+ * count to 0. Only once every 4 billion or so times, when the generation wraps around, does it actually clear them.
+ * @param table The pointer to the KeyHashTable to empty.
+*/
+void emptyKeyTable(KeyHashTable *table)
+{
+    if(++table->generation == 0) {
+        memset(table->buckets, 0, table->size * sizeof(KeyBucket));
+        table->generation = 1;
+    }
+    table->count = 0;
+}
+
+
+
+/**
+ * Frees the KeyHashTable.
+ * @param table The pointer to the KeyHashTable to free.
+*/
+void freeKeyTable(KeyHashTable *table)
+{
+    free(table->buckets);
+    free(table);
+}
+
+#endif
@@ -0,0 +1,244 @@
+/**
+ * @file MeetInTheMiddle.c
+ * @author Joey Hughes
+ * This is the other way GreyCodeChimera.c can get the number of codes, with --count, for when only the total is needed
+ * and not the seeds. Instead of searching whole codes, it splits every code in half. The first half is the first len/2
+ * steps from 0, and the second half, backwards, is another len/2 steps from 0. Both end at the same number, and
+ * between them they go through every number exactly once with only 0 and that end in both. So all the first halves
+ * are counted up in a table by which numbers they go through and where they end, and then every second half just
+ * looks up how many first halves go through exactly the other numbers and end in the same place.
+ *
+ * Every code can be relabeled exactly one way so that its digits first show up in order, 0 then 1 then 2 and so on
+ * (relabelToLowest in PrefixClasses.c does the same thing on a few steps), and half a code already has every digit in
+ * it, since with one less digit it could only get to len/2 numbers. So only the first halves that are already like
+ * that are put in the table, which is n! times smaller, and the total is multiplied by n! at the end. That's the same
+ * idea as the 0120/0123 classes, just taken all the way down the half.
+ *
+ * The numbers a half goes through fit in 32 bits up to 5 digits, which is as far as this goes. At 6 digits there'd be
+ * way too many halves anyway.
+*/
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#ifndef GREY_CODE_TYPES_DEFINED
+    #include "GreyCodeTypes.h"
+#endif
+
+#if NUM_DIGITS <= 5
+/** A flag to mark that the meet in the middle count is there. It's only defined up to 5 digits. */
+#define MEET_IN_THE_MIDDLE 1
+
+
+/** How many steps are in each half. */
+#define HALF_STEPS (len / 2)
+
+/** Every number, one bit each. */
+#define ALL_HALF_NUMBERS ((uint32_t)((1ULL << len) - 1))
+
+/** The numbers every first half goes through right at the start, since the first two steps are always 0 then 1. A
+ * second half can't go through them. */
+#define FIRST_HALF_START ((1u << 1) | (1u << 3))
+
+/** How many buckets the table of first halves has, as a power of 2. There are about 1.5 million different first halves at
+ * 5 digits, so it's less than a fifth full. */
+#define HALF_TABLE_BITS (NUM_DIGITS == 5 ? 23 : 12)
+
+
+/** The table of first halves. Open addressing with linear probing, the keys and their counts right in the buckets. */
+typedef struct {
+    /** The keys. The numbers a half goes through in the low 32 bits and the number it ends at above that. A key always
+     * has 0 in it, so 0 is an empty bucket. */
+    uint64_t *keys;
+    /** How many first halves have each key. */
+    unsigned long long *counts;
+    /** The number of buckets - 1, for masking the hash. */
+    size_t mask;
+    /** How many different keys are in the table. */
+    size_t count;
+} HalfPathTable;
+
+
+
+/**
+ * Gets the key for a half.
+ * @param visited The numbers the half goes through, one bit each.
+ * @param end The number it ends at.
+ * @return The key.
+*/
+static inline uint64_t getHalfKey(uint32_t visited, int end)
+{
+    return (uint64_t)visited | ((uint64_t)end << 32);
+}
+
+
+
+/**
+ * Turns a key into the bucket to start looking in.
+ * @param table The HalfPathTable.
+ * @param key The key.
+ * @return The bucket.
+*/
+static inline size_t halfHash(const HalfPathTable *table, uint64_t key)
+{
+    return (size_t)((key * 0x9E3779B97F4A7C15ULL) >> (64 - HALF_TABLE_BITS)) & table->mask;
+}
+
+
+
+/**
+ * Creates an empty HalfPathTable with 2^HALF_TABLE_BITS buckets.
+ * @return Pointer to the new HalfPathTable.
+*/
+HalfPathTable *createHalfPathTable()
+{
+    HalfPathTable *table = (HalfPathTable *)malloc(sizeof(HalfPathTable));
+    table->mask = ((size_t)1 << HALF_TABLE_BITS) - 1;
+    table->keys = (uint64_t *)calloc(table->mask + 1, sizeof(uint64_t));
+    table->counts = (unsigned long long *)calloc(table->mask + 1, sizeof(unsigned long long));
+    table->count = 0;
+    return table;
+}
+
+
+
+/**
+ * Adds one first half with the given key to the table.
+ * @param table The HalfPathTable.
+ * @param key The key of the half.
+*/
+static inline void halfPathAdd(HalfPathTable *table, uint64_t key)
+{
+    size_t index = halfHash(table, key);
+    while(table->keys[index] != 0 && table->keys[index] != key)
+        index = (index + 1) & table->mask;
+    if(table->keys[index] == 0) {
+        table->keys[index] = key;
+        table->count++;
+    }
+    table->counts[index]++;
+}
+
+
+
+/**
+ * Gets how many first halves have the given key.
+ * @param table The HalfPathTable.
+ * @param key The key to look for.
+ * @return How many there are, 0 if it isn't in the table.
+*/
+static inline unsigned long long halfPathCount(const HalfPathTable *table, uint64_t key)
+{
+    size_t index = halfHash(table, key);
+    while(table->keys[index] != 0) {
+        if(table->keys[index] == key) return table->counts[index];
+        index = (index + 1) & table->mask;
+    }
+    return 0;
+}
+
+
+
+/**
+ * Frees the HalfPathTable.
+ * @param table The pointer to the HalfPathTable to free.
+*/
+void freeHalfPathTable(HalfPathTable *table)
+{
+    free(table->keys);
+    free(table->counts);
+    free(table);
+}
+
+
+
+/**
+ * Gets the steps from the number value to a number a half hasn't gone through yet, one bit each. 0 is always in
+ * visited, so a half never gets back to it.
+ * @param visited The numbers the half has gone through, one bit each.
+ * @param value The number the half is at.
+ * @return The steps.
+*/
+static inline stepMask getHalfSteps(uint32_t visited, int value)
+{
+    stepMask steps = 0;
+    for(int d = 0; d < NUM_DIGITS; d++)
+        steps |= (stepMask)((~visited >> (value ^ (1 << d))) & 1) << d;
+    return steps;
+}
+
+
+
+/**
+ * Adds every first half that goes on from here to the table, if its digits first show up in order. It goes through the
+ * steps lowest first like the code search does.
+ * @param table The HalfPathTable to add them to.
+ * @param visited The numbers the half has gone through so far, one bit each.
+ * @param value The number the half is at.
+ * @param numSteps How many steps the half has so far.
+ * @param numUsed How many digits the half has used so far. The next step can be any of them or the next new one.
+*/
+void addFirstHalves(HalfPathTable *table, uint32_t visited, int value, int numSteps, int numUsed)
+{
+    if(numSteps == HALF_STEPS) {
+        halfPathAdd(table, getHalfKey(visited, value));
+        return;
+    }
+    stepMask untried = getHalfSteps(visited, value) & ((2 << numUsed) - 1);
+    while(untried) {
+        stepMask nextStep = untried & -untried;
+        untried ^= nextStep;
+        int next = value ^ nextStep;
+        addFirstHalves(table, visited | (1u << next), next, numSteps + 1, numUsed + (nextStep == (1 << numUsed)));
+    }
+}
+
+
+
+/**
+ * Counts the first halves in the table that go with every second half that goes on from here. A second half is
+ * searched from 0 backwards, so it's any half at all, and it goes with the first halves that go through every number it
+ * doesn't, plus 0 and the end they share. It never goes through FIRST_HALF_START, which starts off in visited.
+ * @param table The HalfPathTable of first halves.
+ * @param visited The numbers the second half has gone through so far, one bit each, and FIRST_HALF_START.
+ * @param value The number the second half is at.
+ * @param numSteps How many steps the second half has so far.
+ * @return How many codes the first halves and those second halves make up.
+*/
+unsigned long long countSecondHalves(const HalfPathTable *table, uint32_t visited, int value, int numSteps)
+{
+    if(numSteps == HALF_STEPS)
+        return halfPathCount(table, getHalfKey((~visited & ALL_HALF_NUMBERS) | FIRST_HALF_START | 1u | (1u << value), value));
+    unsigned long long total = 0;
+    stepMask untried = getHalfSteps(visited, value);
+    while(untried) {
+        stepMask nextStep = untried & -untried;
+        untried ^= nextStep;
+        int next = value ^ nextStep;
+        total += countSecondHalves(table, visited | (1u << next), next, numSteps + 1);
+    }
+    return total;
+}
+
+
+
+/**
+ * Counts all the grey codes by meeting in the middle.
+ * @param numFirstHalves Where the number of different first halves in the table goes, or NULL.
+ * @return The number of grey codes.
+*/
+unsigned long long countCodesMeetInTheMiddle(size_t *numFirstHalves)
+{
+    HalfPathTable *table = createHalfPathTable();
+    addFirstHalves(table, 1u, 0, 0, 0);
+    if(numFirstHalves != NULL) *numFirstHalves = table->count;
+
+    unsigned long long total = countSecondHalves(table, 1u | FIRST_HALF_START, 0, 0);
+    for(int i = NUM_DIGITS; i > 1; i--)
+        total *= i;
+
+    freeHalfPathTable(table);
+    return total;
+}
+
+#endif
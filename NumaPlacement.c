@@ -0,0 +1,125 @@
+/**
+ * @file NumaPlacement.c
+ * @author Joey Hughes
+ * This is how GreyCodeChimera.c places its threads on the NUMA nodes of machines with more than one socket, with --numa.
+ * The nodes and their cores are read from /sys/devices/system/node, so it doesn't need libnuma. Each search worker and
+ * extrapolation thread gets a node and pins itself to that node's cores before it allocates anything, so the batches
+ * of its arena and the hash table of an extrapolation thread are first touched there and end up in that node's memory.
+ * The seed queue keeps the batches from each node apart (see SeedQueue.c), so the extrapolation threads mostly get the
+ * seeds that were found on their own socket.
+*/
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+
+/** Where the kernel lists the NUMA nodes. Each node has a nodeX directory with a cpulist file in it. */
+#define NUMA_NODE_PATH "/sys/devices/system/node"
+
+/** The most nodes that are looked for. */
+#define MAX_NUMA_NODES 64
+
+
+/** The NUMA nodes of the machine and which cores are on each one. */
+typedef struct {
+    /** How many nodes have cores on them. Nodes with only memory are skipped. */
+    int numNodes;
+    /** The cores on each node. */
+    cpu_set_t nodeCpus[MAX_NUMA_NODES];
+    /** The kernel's number for each node, for printing. */
+    int nodeIds[MAX_NUMA_NODES];
+} NumaTopology;
+
+
+
+/**
+ * Reads a cpulist like "0-3,8-11" into a set of cores.
+ * @param list The cpulist.
+ * @param cpus Where the cores are put.
+ * @return How many cores there were.
+*/
+static int parseCpuList(const char *list, cpu_set_t *cpus)
+{
+    CPU_ZERO(cpus);
+    while(*list >= '0' && *list <= '9') {
+        char *end;
+        long first = strtol(list, &end, 10);
+        long last = first;
+        if(*end == '-') last = strtol(end + 1, &end, 10);
+        for(long cpu = first; cpu <= last && cpu < CPU_SETSIZE; cpu++)
+            CPU_SET(cpu, cpus);
+        list = *end == ',' ? end + 1 : end;
+    }
+    return CPU_COUNT(cpus);
+}
+
+
+
+/**
+ * Reads the NUMA nodes of the machine. If the kernel doesn't list any, it's all one node with every core the process
+ * is allowed to use, so pinning to it doesn't change anything.
+ * @param topology Where the nodes go.
+ * @return How many nodes there are, always at least 1.
+*/
+int readNumaTopology(NumaTopology *topology)
+{
+    char path[64];
+    char list[4096];
+    topology->numNodes = 0;
+    for(int node = 0; node < MAX_NUMA_NODES; node++) {
+        snprintf(path, sizeof(path), NUMA_NODE_PATH "/node%d/cpulist", node);
+        FILE *file = fopen(path, "r");
+        if(file == NULL) continue;
+        bool read = fgets(list, sizeof(list), file) != NULL;
+        fclose(file);
+        if(read && parseCpuList(list, topology->nodeCpus + topology->numNodes)) {
+            topology->nodeIds[topology->numNodes] = node;
+            topology->numNodes++;
+        }
+    }
+
+    if(topology->numNodes == 0) {
+        if(sched_getaffinity(0, sizeof(cpu_set_t), topology->nodeCpus) != 0) {
+            CPU_ZERO(topology->nodeCpus);
+            for(long cpu = 0; cpu < sysconf(_SC_NPROCESSORS_ONLN) && cpu < CPU_SETSIZE; cpu++)
+                CPU_SET(cpu, topology->nodeCpus);
+        }
+        topology->nodeIds[0] = 0;
+        topology->numNodes = 1;
+    }
+    return topology->numNodes;
+}
+
+
+
+/**
+ * Picks the node for one of a group of threads, so the group is split into even runs of threads, one run per node.
+ * With fewer threads than nodes, some nodes just don't get any.
+ * @param index Which thread of the group it is.
+ * @param count How many threads are in the group.
+ * @param numNodes How many nodes there are.
+ * @return The index of the node, from 0 to numNodes - 1.
+*/
+int getNumaNodeFor(int index, int count, int numNodes)
+{
+    return (int)(((long long)index * numNodes) / count);
+}
+
+
+
+/**
+ * Pins the thread that calls this to the cores of a node. Anything it allocates and touches after this comes out of
+ * that node's memory.
+ * @param topology The nodes, from readNumaTopology.
+ * @param node The index of the node.
+ * @return True if it worked. If not, the thread just keeps running wherever.
+*/
+bool pinThreadToNumaNode(const NumaTopology *topology, int node)
+{
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), topology->nodeCpus + node) == 0;
+}
@@ -0,0 +1,100 @@
+/**
+ * @file PackedSequence.c
+ * @author Joey Hughes
+ * This is the code for packing sequences into packedSequences from GreyCodeTypes.h and back. A packed sequence is 3 bits
+ * per step with the first step in the highest bits of the first byte, so it's less than half the size of a sequence
+ * (12 bytes instead of 32 at 5 digits, 24 instead of 64 at 6). The seeds are held like this from when the search finds
+ * them until they're extrapolated, and seed files are just a header and a bunch of these one after another.
+ * When there are fixed width keys, a packed sequence is the same bits as a sequenceKey, so unpacking goes through the
+ * key and is just shifts on a couple of registers. Otherwise it goes byte by byte.
+*/
+
+#ifndef GREY_CODE_TYPES_DEFINED
+    #include "GreyCodeTypes.h"
+#endif
+#include "SequenceKeys.c"
+
+// This file gets included from a couple places, so only define everything once
+#ifndef PACKED_SEQUENCE_DEFINED
+#define PACKED_SEQUENCE_DEFINED 1
+
+
+/** The mask that takes a step out of the bottom of some packed bits. */
+#define PACKED_STEP_MASK ((1 << BITS_PER_STEP) - 1)
+
+
+
+/**
+ * Packs a sequence into a packedSequence.
+ * @param seq The sequence to pack, len steps long.
+ * @param packed Where the packed bytes are written, PACKED_SEQUENCE_BYTES long.
+*/
+static inline void packSequence(const step *seq, unsigned char *packed)
+{
+    unsigned int bits = 0;     // Bits waiting to be written out, in the low end
+    int numBits = 0;           // How many bits are waiting
+    unsigned char *bytePtr = packed;
+    for(int i = 0; i < len; i++) {
+        bits = (bits << BITS_PER_STEP) | seq[i];
+        numBits += BITS_PER_STEP;
+        if(numBits >= 8) {
+            numBits -= 8;
+            *(bytePtr++) = (unsigned char)(bits >> numBits);
+        }
+    }
+    // Any leftover bits go in the top of the last byte
+    if(numBits) *bytePtr = (unsigned char)(bits << (8 - numBits));
+}
+
+
+
+/**
+ * Packs a sequence of stepMasks, like the test array in the code search, into a packedSequence.
+ * @param seq The stepMasks to pack, len of them.
+ * @param packed Where the packed bytes are written, PACKED_SEQUENCE_BYTES long.
+*/
+static inline void packStepMasks(const stepMask *seq, unsigned char *packed)
+{
+    unsigned int bits = 0;
+    int numBits = 0;
+    unsigned char *bytePtr = packed;
+    for(int i = 0; i < len; i++) {
+        bits = (bits << BITS_PER_STEP) | __builtin_ctz(seq[i]);
+        numBits += BITS_PER_STEP;
+        if(numBits >= 8) {
+            numBits -= 8;
+            *(bytePtr++) = (unsigned char)(bits >> numBits);
+        }
+    }
+    if(numBits) *bytePtr = (unsigned char)(bits << (8 - numBits));
+}
+
+
+
+/**
+ * Unpacks a packedSequence back into a sequence.
+ * @param packed The packed bytes, PACKED_SEQUENCE_BYTES long.
+ * @param seq Where the sequence is written, len steps long.
+*/
+static inline void unpackSequence(const unsigned char *packed, step *seq)
+{
+    #ifdef FIXED_WIDTH_KEYS
+    sequenceKey key;
+    getPackedSequenceKey(packed, &key);
+    unpackSequenceKey(key, seq);
+    #else
+    unsigned int bits = 0;
+    int numBits = 0;
+    const unsigned char *bytePtr = packed;
+    for(int i = 0; i < len; i++) {
+        if(numBits < BITS_PER_STEP) {
+            bits = (bits << 8) | *(bytePtr++);
+            numBits += 8;
+        }
+        numBits -= BITS_PER_STEP;
+        seq[i] = (bits >> numBits) & PACKED_STEP_MASK;
+    }
+    #endif
+}
+
+#endif
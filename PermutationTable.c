@@ -0,0 +1,85 @@
+/**
+ * @file PermutationTable.c
+ * @author Joey Hughes
+ * This is the table of every relabeling of the digits for GreyCodeChimera.c, all n! of them. Each one is a map from a
+ * step's digit number to the digit number it gets relabeled to, padded out to 16 bytes so it can be used straight as
+ * the lookup table of a pshufb (see relabelSequence in SequenceKernels.c). So instead of getting to each relabeling by
+ * doing one more swap pass over a copy of the sequence, any of them can be applied to the original in one go, in any
+ * order. It's only 16 * n! bytes, 80KB at 7 digits.
+ * The first map is always the identity.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef GREY_CODE_TYPES_DEFINED
+    #include "GreyCodeTypes.h"
+#endif
+
+
+/** How many bytes each map takes up. 16 so a whole map is one SSE register for pshufb. */
+#define PERMUTATION_MAP_BYTES 16
+
+
+/** A relabeling of the digits. map[d] is what digit d becomes, and everything past NUM_DIGITS maps to itself. */
+typedef step permutationMap[PERMUTATION_MAP_BYTES];
+
+/** Struct for the whole table. */
+typedef struct {
+    /** How many maps there are, n!. */
+    unsigned long long count;
+    /** The maps, in lexicographic order. */
+    permutationMap *maps;
+} PermutationTable;
+
+
+
+/**
+ * Creates the table of all n! relabelings, in lexicographic order starting with the identity.
+ * @return Pointer to the new PermutationTable.
+*/
+PermutationTable *createPermutationTable()
+{
+    PermutationTable *table = (PermutationTable *)malloc(sizeof(PermutationTable));
+    table->count = 1;
+    for(int i = NUM_DIGITS; i > 1; i--)
+        table->count *= i;
+
+    table->maps = (permutationMap *)malloc(sizeof(permutationMap) * table->count);
+
+    // Step through them with the usual next permutation: find the last rise, swap it with the smallest bigger digit
+    //    after it, and reverse everything after it.
+    step current[PERMUTATION_MAP_BYTES];
+    for(int i = 0; i < PERMUTATION_MAP_BYTES; i++)
+        current[i] = i;
+    for(unsigned long long p = 0; p < table->count; p++) {
+        memcpy(table->maps[p], current, PERMUTATION_MAP_BYTES);
+
+        int rise = NUM_DIGITS - 2;
+        while(rise >= 0 && current[rise] >= current[rise + 1]) rise--;
+        if(rise < 0) break;
+        int bigger = NUM_DIGITS - 1;
+        while(current[bigger] <= current[rise]) bigger--;
+        step temp = current[rise];
+        current[rise] = current[bigger];
+        current[bigger] = temp;
+        for(int i = rise + 1, j = NUM_DIGITS - 1; i < j; i++, j--) {
+            temp = current[i];
+            current[i] = current[j];
+            current[j] = temp;
+        }
+    }
+    return table;
+}
+
+
+
+/**
+ * Frees the PermutationTable.
+ * @param table The pointer to the PermutationTable to free.
+*/
+void freePermutationTable(PermutationTable *table)
+{
+    free(table->maps);
+    free(table);
+}
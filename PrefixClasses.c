@@ -0,0 +1,311 @@
+/**
+ * @file PrefixClasses.c
+ * @author Joey Hughes
+ * This is the code that makes the prefix classes the code search is split by, for any number of digits and any number
+ * of set steps. It used to be the hand-written checks in ThreadSequenceCheckers.c (now in Old) for the five classes
+ * 01020, 01021, 01023, 0120, and 0123, but everything those did only depends on which steps in a few steps in a row are
+ * the same as each other, so it can all be worked out at the start instead.
+ *
+ * Relabeling a few steps so each new digit is the lowest one not used yet (so 2,0,2,3 becomes 0,1,0,2) gives the
+ * lowest thing they can be relabeled to. Every seed starts with PREFIX_CLASS_STEPS steps that are already like that,
+ * that are a valid path (they don't get back to a number they already reached), and that don't have a later start in
+ * them that would relabel to something lower. Those are the prefix classes, all of them, in order.
+ *
+ * Which steps in a window of PREFIX_CLASS_STEPS steps are the same as each other is packed into a signature, one bit for
+ * every pair of steps that are at least two apart (steps next to each other are never the same). Two windows can be
+ * relabeled to each other exactly when they have the same signature. So:
+ *   - A rotation can be relabeled to a class's set start if the window at the start of it has the class's signature.
+ *     That's what the checkStepsIn functions did.
+ *   - Every class has a table with a bit for every signature, set if a window ending with that signature has a start in
+ *     it that relabels to lower than the class's set start, meaning the code is a child of a seed from a lower class.
+ *     That's what the checkStepsForLower functions did, and it's a load and a shift instead of a call.
+ * The search keeps the equalities of each step with the ones before it, so the signature of the window ending at a step
+ * is just a few shifts.
+ * The default is 5 set steps for up to 5 digits and NUM_DIGITS set steps past that, which splits the search more evenly.
+ * It can be set in compilation with -DPREFIX_CLASS_STEPS=X, from 4 to 7.
+*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifndef GREY_CODE_TYPES_DEFINED
+    #include "GreyCodeTypes.h"
+#endif
+
+
+/** How many steps every prefix class has set. Can be set in compilation with -DPREFIX_CLASS_STEPS=X. */
+#ifndef PREFIX_CLASS_STEPS
+#define PREFIX_CLASS_STEPS (NUM_DIGITS < 5 ? 5 : NUM_DIGITS)
+#endif
+
+#if PREFIX_CLASS_STEPS < 4 || PREFIX_CLASS_STEPS > 7
+#error "PREFIX_CLASS_STEPS has to be from 4 to 7"
+#endif
+
+/** The most prefix classes there can be. There are 49 with 7 set steps. */
+#define MAX_PREFIX_CLASSES 64
+
+/** How many bits are in the signature of a window of PREFIX_CLASS_STEPS steps. One for every pair of steps that are at
+ * least two apart. */
+#define PREFIX_SIGNATURE_BITS (((PREFIX_CLASS_STEPS - 1) * (PREFIX_CLASS_STEPS - 2)) / 2)
+
+/** How many 64 bit words the table of lower signatures takes up. */
+#define PREFIX_LOWER_WORDS (((1 << PREFIX_SIGNATURE_BITS) + 63) / 64)
+
+
+/** One of the prefix classes the code search is split by. Every seed starts with exactly one of these set starts. */
+typedef struct {
+    /** How many steps are set. Always PREFIX_CLASS_STEPS. */
+    int numSetSteps;
+    /** The steps that are preset for this class. */
+    stepMask setSteps[len];
+    /** How many different digits the set steps use. The rest can be swapped with each other without changing the set start. */
+    int numSetDigits;
+    /** The signature of the set steps. A rotation can be relabeled to the set start if the window at its start has this signature. */
+    unsigned int signature;
+    /** True if any window can show that a code is a child of a seed from a lower class. False for the lowest class. */
+    bool hasLower;
+    /** A bit for every signature, set if a window ending with that signature means the code is a child of a seed from a lower class. */
+    uint64_t lowerSignatures[PREFIX_LOWER_WORDS];
+    /** Used to pass in a pointer to the queue so it only has to be made once. */
+    stepMask (*queueStepPointer)[2];
+    /** How long the queue of extra steps is, (n - numSetDigits)! */
+    unsigned long long queueLen;
+    /** Which class this is, the index into the class array. */
+    int classIndex;
+} PrefixClass;
+
+
+
+/**
+ * Finds which of the steps before a step are the same as it, for the window signatures.
+ * @param stepPtr The pointer to the step (checks backward).
+ * @param maxDistance How far back to look, at most PREFIX_CLASS_STEPS - 1. Has to stay inside the array.
+ * @return Bit d - 2 is set if the step d steps back is the same, for d from 2 to maxDistance.
+*/
+static inline unsigned int getStepEqualities(const stepMask *stepPtr, int maxDistance)
+{
+    unsigned int equalities = 0;
+    for(int d = 2; d <= maxDistance; d++)
+        equalities |= (unsigned int)(stepPtr[-d] == stepPtr[0]) << (d - 2);
+    return equalities;
+}
+
+
+
+/**
+ * Puts together the signature of the window of PREFIX_CLASS_STEPS steps ending at a step, from the equalities of the
+ * steps in it. Each step only adds the bits for the steps before it that are still in the window.
+ * @param equalities The pointer to the equalities of the last step of the window (looks backward).
+ * @return The signature.
+*/
+static inline unsigned int getWindowSignature(const unsigned int *equalities)
+{
+    const unsigned int *windowStart = equalities - (PREFIX_CLASS_STEPS - 1);
+    unsigned int signature = 0;
+    for(int i = 2; i < PREFIX_CLASS_STEPS; i++)
+        signature |= (windowStart[i] & ((1u << (i - 1)) - 1)) << (((i - 1) * (i - 2)) / 2);
+    return signature;
+}
+
+
+
+/**
+ * Works out the signature of the window of PREFIX_CLASS_STEPS steps ending at a step straight from the steps, for when
+ * there aren't any equalities kept.
+ * @param stepPtr The pointer to the last step of the window (looks backward).
+ * @return The signature.
+*/
+static inline unsigned int getStepsSignature(const stepMask *stepPtr)
+{
+    unsigned int equalities[PREFIX_CLASS_STEPS];
+    const stepMask *windowStart = stepPtr - (PREFIX_CLASS_STEPS - 1);
+    for(int i = 0; i < PREFIX_CLASS_STEPS; i++)
+        equalities[i] = getStepEqualities(windowStart + i, i);
+    return getWindowSignature(equalities + PREFIX_CLASS_STEPS - 1);
+}
+
+
+
+/**
+ * Returns true if a window ending with the given signature means the code is a child of a seed from a lower class.
+ * @param prefixClass The class being searched.
+ * @param signature The signature of the window.
+ * @return True if the code should be skipped, false if not.
+*/
+static inline bool isLowerSignature(const PrefixClass *prefixClass, unsigned int signature)
+{
+    return (prefixClass->lowerSignatures[signature >> 6] >> (signature & 63)) & 1;
+}
+
+
+
+/**
+ * Relabels some digit numbers so each new one is the lowest one not used yet.
+ * @param steps The digit numbers.
+ * @param length How many there are.
+ * @param relabeled Where the relabeled ones are written.
+*/
+void relabelToLowest(const step *steps, int length, step *relabeled)
+{
+    step relabel[NUM_DIGITS];
+    step numUsed = 0;
+    memset(relabel, 0xFF, sizeof(relabel));
+    for(int i = 0; i < length; i++) {
+        if(relabel[steps[i]] == 0xFF) relabel[steps[i]] = numUsed++;
+        relabeled[i] = relabel[steps[i]];
+    }
+}
+
+
+
+/**
+ * Returns true if the steps have a start in them that relabels to lower than the start of the given steps. The start has
+ * to be at least one step in, and the steps after it are compared with the same number of steps at the start.
+ * @param steps The digit numbers, already relabeled to the lowest.
+ * @param start The first start to try, the ones before it are skipped.
+ * @param length How many steps there are.
+ * @param lowest The steps it has to be lower than, at least length long.
+ * @return True if one of the starts is lower.
+*/
+bool hasLowerStart(const step *steps, int start, int length, const step *lowest)
+{
+    step relabeled[PREFIX_CLASS_STEPS];
+    for(int q = start; q < length; q++) {
+        relabelToLowest(steps + q, length - q, relabeled);
+        for(int i = 0; i < length - q; i++) {
+            if(relabeled[i] != lowest[i]) {
+                if(relabeled[i] < lowest[i]) return true;
+                break;
+            }
+        }
+    }
+    return false;
+}
+
+
+
+/**
+ * Returns true if the steps are a valid piece of a path, so none of the steps in a row flip back to the same number.
+ * @param steps The digit numbers.
+ * @param length How many there are.
+ * @return True if no run of steps in a row adds up to 0.
+*/
+bool isValidPathWindow(const step *steps, int length)
+{
+    for(int q = 0; q < length; q++) {
+        unsigned int reached = 0;
+        for(int i = q; i < length; i++) {
+            reached ^= 1 << steps[i];
+            if(!reached) return false;
+        }
+    }
+    return true;
+}
+
+
+
+/**
+ * Recursively goes through every window of PREFIX_CLASS_STEPS steps, relabeled to the lowest, that could be in a code,
+ * and sets the bits in the class's table for the ones that have a start relabeling to lower than the class's set start.
+ * @param prefixClass The class to fill in the table of.
+ * @param classSteps The class's set start as digit numbers.
+ * @param window The window so far.
+ * @param length How many steps of the window are set so far.
+ * @param numUsed How many different digits the window uses so far.
+*/
+void addLowerSignatures(PrefixClass *prefixClass, const step *classSteps, step *window, int length, int numUsed)
+{
+    if(length == PREFIX_CLASS_STEPS) {
+        if(!hasLowerStart(window, 0, PREFIX_CLASS_STEPS, classSteps)) return;
+        stepMask windowSteps[PREFIX_CLASS_STEPS];
+        for(int i = 0; i < PREFIX_CLASS_STEPS; i++)
+            windowSteps[i] = 1 << window[i];
+        unsigned int signature = getStepsSignature(windowSteps + PREFIX_CLASS_STEPS - 1);
+        prefixClass->lowerSignatures[signature >> 6] |= (uint64_t)1 << (signature & 63);
+        prefixClass->hasLower = true;
+        return;
+    }
+    for(step d = 0; d <= numUsed && d < NUM_DIGITS; d++) {
+        window[length] = d;
+        if(!isValidPathWindow(window, length + 1)) continue;
+        addLowerSignatures(prefixClass, classSteps, window, length + 1, d == numUsed ? numUsed + 1 : numUsed);
+    }
+}
+
+
+
+/**
+ * Recursively finds all the prefix classes, in order, and fills them in. A start is kept going only while it's a valid
+ * path and none of the starts inside it relabel to lower, since adding steps can't fix either of those.
+ * @param prefixClasses The array of the prefix classes to fill in.
+ * @param numClasses How many classes there are so far. Incremented for every class added.
+ * @param steps The set start so far as digit numbers.
+ * @param length How many steps are set so far.
+ * @param numUsed How many different digits are used so far.
+ * @param queues The queues of extra swaps for each number of set digits.
+ * @param queueLens How long each of those queues is.
+ * @return False if there were too many classes.
+*/
+bool addPrefixClasses(PrefixClass *prefixClasses, int *numClasses, step *steps, int length, int numUsed,
+                      stepMask (**queues)[2], const unsigned long long *queueLens)
+{
+    if(length == PREFIX_CLASS_STEPS) {
+        if(*numClasses == MAX_PREFIX_CLASSES) return false;
+        PrefixClass *prefixClass = prefixClasses + *numClasses;
+        memset(prefixClass, 0, sizeof(PrefixClass));
+        prefixClass->numSetSteps = PREFIX_CLASS_STEPS;
+        for(int i = 0; i < PREFIX_CLASS_STEPS; i++)
+            prefixClass->setSteps[i] = 1 << steps[i];
+        prefixClass->numSetDigits = numUsed;
+        prefixClass->signature = getStepsSignature(prefixClass->setSteps + PREFIX_CLASS_STEPS - 1);
+        prefixClass->queueStepPointer = queues[numUsed];
+        prefixClass->queueLen = queueLens[numUsed];
+        prefixClass->classIndex = *numClasses;
+        step window[PREFIX_CLASS_STEPS];
+        addLowerSignatures(prefixClass, steps, window, 0, 0);
+        (*numClasses)++;
+        return true;
+    }
+    for(step d = 0; d <= numUsed && d < NUM_DIGITS; d++) {
+        if(length && d == steps[length - 1]) continue;
+        steps[length] = d;
+        if(!isValidPathWindow(steps, length + 1) || hasLowerStart(steps, 1, length + 1, steps)) continue;
+        if(!addPrefixClasses(prefixClasses, numClasses, steps, length + 1, d == numUsed ? numUsed + 1 : numUsed, queues, queueLens))
+            return false;
+    }
+    return true;
+}
+
+
+
+/**
+ * Makes all the prefix classes for PREFIX_CLASS_STEPS set steps.
+ * @param prefixClasses The array to fill in, MAX_PREFIX_CLASSES long.
+ * @param queues The queues of extra swaps, indexed by how many digits are set. The queue for m set digits swaps the
+ *               other NUM_DIGITS - m digits through all their permutations.
+ * @param queueLens How long each of those queues is.
+ * @return How many classes there are, or 0 if there were more than MAX_PREFIX_CLASSES.
+*/
+int makePrefixClasses(PrefixClass *prefixClasses, stepMask (**queues)[2], const unsigned long long *queueLens)
+{
+    int numClasses = 0;
+    step steps[PREFIX_CLASS_STEPS];
+    if(!addPrefixClasses(prefixClasses, &numClasses, steps, 0, 0, queues, queueLens)) return 0;
+    return numClasses;
+}
+
+
+
+/**
+ * Writes a class's set start as digits, like 01020, for printing.
+ * @param prefixClass The class.
+ * @param name Where the digits are written, PREFIX_CLASS_STEPS + 1 long.
+*/
+void getPrefixClassName(const PrefixClass *prefixClass, char *name)
+{
+    for(int i = 0; i < prefixClass->numSetSteps; i++)
+        name[i] = '0' + __builtin_ctz(prefixClass->setSteps[i]);
+    name[prefixClass->numSetSteps] = '\0';
+}
@@ -0,0 +1,307 @@
+/**
+ * @file SearchBenchmark.c
+ * @author Joey Hughes
+ * This is a little benchmark for the two code search engines in GreyCodeChimera.c, the flags one that shifts each step
+ * up until it works (searchCodesWithSetStart) and the stack of frames one that takes the next unvisited neighbour with
+ * ctz (searchCodesBitset, -DBITSET_SEARCH). It runs the bare loop of each one, without any of the seed checks, over
+ * every code that starts with the first BENCHMARK_SET_STEPS steps of the lowest code, makes sure they find the same number
+ * of codes and go through the same nodes, and prints how many nodes a second each one does. A node is a partial code
+ * that's valid so far and gets a number marked, or a whole code, so it's the same for both of them. It also prints how
+ * many steps each one had to look at, which is where the difference comes from. The bitset one fills in the last
+ * three steps all at once, so that's counted as one step, but the nodes the flags one would have gone through there
+ * are still counted.
+ *
+ * To run it, compile like:
+ * gcc -Wall -std=c99 -O2 -DNUM_DIGITS=5 SearchBenchmark.c -o SearchBenchmark
+ * It only goes up to 6 digits, since that's as far as the bitset engine goes. Set -DBENCHMARK_SET_STEPS=X higher if it
+ * takes too long or lower if it's too quick to time.
+*/
+
+/** For clock_gettime with -std=c99. Has to be before any of the system headers. */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+
+#include "GreyCodeTypes.h"
+
+#if NUM_DIGITS > 6
+#error "The bitset engine only goes up to 6 digits"
+#endif
+
+
+/** How many steps of the lowest code are set, so the benchmark only goes through the codes that start with them. */
+#ifndef BENCHMARK_SET_STEPS
+#if NUM_DIGITS <= 4
+#define BENCHMARK_SET_STEPS 1
+#elif NUM_DIGITS == 5
+#define BENCHMARK_SET_STEPS 8
+#else
+#define BENCHMARK_SET_STEPS 40
+#endif
+#endif
+
+/* The value of a stepMask that changes the highest order bit. */
+#define LAST_DIGIT_STEP (1 << (NUM_DIGITS - 1))
+
+
+/** What each engine counts up. */
+typedef struct {
+    /** How many whole codes it found. */
+    unsigned long long codes;
+    /** How many nodes it went through. */
+    unsigned long long nodes;
+    /** How many steps it looked at, valid or not. */
+    unsigned long long steps;
+} SearchCounts;
+
+
+/** The lowest grey code, the 01020103..., as stepMasks. */
+stepMask lowest[len];
+
+
+
+/**
+ * Gets the time in seconds.
+ * @return The time in seconds from the monotonic clock.
+*/
+double getSeconds()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + (now.tv_nsec / 1e9);
+}
+
+
+
+/**
+ * The bare loop of searchCodesWithSetStart: a flags array, and every step gets shifted up until it's valid.
+ * @param counts Where the counts get added to.
+*/
+void searchFlags(SearchCounts *counts)
+{
+    stepMask test[len];
+    stepMask *sptr = test;
+    int bffr[len + 1];
+    int * const buf = bffr + 1;
+    int *bptr = buf;
+    int * const bufEndPtr = buf + len - 1;
+    bool flags[len] = {};
+    stepMask * const firstFreeStep = test + BENCHMARK_SET_STEPS;
+
+    bffr[0] = 0;
+    memcpy(test, lowest, sizeof(test));
+    while(sptr < firstFreeStep) {
+        *bptr = *(bptr - 1) ^ (*sptr);
+        flags[*bptr] = true;
+        sptr++;
+        bptr++;
+    }
+
+    while(true) {
+        while(true) {
+            counts->steps++;
+            *bptr = *(bptr - 1) ^ (*sptr);
+            if(!*bptr) {
+                if(bptr < bufEndPtr) goto increment; else break;
+            }
+            if(flags[*bptr]) goto increment;
+            counts->nodes++;
+            flags[*bptr] = true;
+            sptr++;
+            bptr++;
+        }
+        counts->codes++;
+        counts->nodes++;
+
+        sptr -= 3;
+        flags[*(--bptr)] = false;
+        flags[*(--bptr)] = false;
+        flags[*(--bptr)] = false;
+
+        increment:
+        while((*sptr) & LAST_DIGIT_STEP) {
+            sptr--;
+            flags[*(--bptr)] = false;
+        }
+        if(sptr < firstFreeStep) break;
+        (*sptr) <<= 1;
+        if(*sptr == *(sptr - 1)) goto increment;
+        memcpy(sptr + 1, lowest, (len - 1 - (sptr - test)) * sizeof(stepMask));
+    }
+}
+
+
+
+/** Every number a code goes through, one bit each. */
+#define ALL_NUMBERS_VISITED (len == 64 ? ~0ULL : (1ULL << (len & 63)) - 1)
+
+/** Whether a number is a single step. */
+#define IS_STEP(x) ((x) && !((x) & ((x) - 1)))
+
+/** One frame of the stack, the same as in GreyCodeChimera.c. */
+typedef struct {
+    /** The number the code is at before this position's step. */
+    int value;
+    /** The steps left to try at this position, one bit each. */
+    stepMask untried;
+} SearchFrame;
+
+
+
+/**
+ * The same as getUnvisitedSteps in GreyCodeChimera.c.
+ * @param visited The numbers that have been reached, one bit each.
+ * @param value The number the code is at.
+ * @return The unvisited steps.
+*/
+static inline stepMask getUnvisitedSteps(uint64_t visited, int value)
+{
+    stepMask steps = 0;
+    for(int d = 0; d < NUM_DIGITS; d++)
+        steps |= (stepMask)((~visited >> (value ^ (1 << d))) & 1) << d;
+    return steps;
+}
+
+
+
+/**
+ * The same as completeForcedSteps in GreyCodeChimera.c, except it also counts the nodes the flags loop would have
+ * gone through searching the last three steps, so the node counts can be compared.
+ * @param visited The numbers that have been reached, one bit each. All but two of them.
+ * @param value The number the code is at.
+ * @param last Where the last three steps go.
+ * @param counts Where the nodes and steps get added to.
+ * @return True if it finishes into a whole code.
+*/
+static inline bool completeForcedSteps(uint64_t visited, int value, stepMask *last, SearchCounts *counts)
+{
+    uint64_t left = ~visited & ALL_NUMBERS_VISITED;
+    int first = __builtin_ctzll(left);
+    int second = __builtin_ctzll(left & (left - 1));
+
+    // Either order might get partway
+    counts->steps++;
+    for(int order = 0; order < 2; order++) {
+        int next = order ? second : first, after = order ? first : second;
+        if(!IS_STEP(value ^ next)) continue;
+        counts->nodes++;
+        if(!IS_STEP(next ^ after)) continue;
+        counts->nodes++;
+        if(IS_STEP(after)) counts->nodes++;
+    }
+
+    if(second & (second - 1)) {
+        int temp = first;
+        first = second;
+        second = temp;
+    }
+    last[0] = value ^ first;
+    last[1] = first ^ second;
+    last[2] = second;
+    return IS_STEP(last[0]) && IS_STEP(last[1]) && IS_STEP(last[2]);
+}
+
+
+
+/**
+ * The bare loop of searchCodesBitset: the reached numbers in one word, a stack of frames with the steps left at each
+ * position as a mask, and the last three steps filled in at once.
+ * @param counts Where the counts get added to.
+*/
+void searchBitset(SearchCounts *counts)
+{
+    const int forced = len - 3;
+    stepMask test[len];
+    SearchFrame frames[len];
+    uint64_t visited = 1;
+    int position, value;
+
+    frames[0].value = 0;
+    for(position = 0; position < BENCHMARK_SET_STEPS; position++) {
+        test[position] = lowest[position];
+        frames[position + 1].value = frames[position].value ^ test[position];
+        visited |= 1ULL << frames[position + 1].value;
+    }
+    frames[position].untried = getUnvisitedSteps(visited, frames[position].value);
+
+    while(true) {
+        if(!frames[position].untried) {
+            visited ^= 1ULL << frames[position].value;
+            if(--position < BENCHMARK_SET_STEPS) break;
+            continue;
+        }
+        counts->steps++;
+        counts->nodes++;
+        test[position] = frames[position].untried & -frames[position].untried;
+        frames[position].untried ^= test[position];
+        value = frames[position].value ^ test[position];
+        visited |= 1ULL << value;
+        position++;
+        frames[position].value = value;
+        if(position < forced) {
+            frames[position].untried = getUnvisitedSteps(visited, value);
+            continue;
+        }
+
+        if(completeForcedSteps(visited, value, test + forced, counts)) counts->codes++;
+        visited ^= 1ULL << frames[forced].value;
+        position = forced - 1;
+    }
+}
+
+
+
+/**
+ * Runs one of the engines and prints how it did.
+ * @param name The name of the engine.
+ * @param search The engine.
+ * @param counts Where its counts go.
+ * @return How long it took, in seconds.
+*/
+double runSearch(const char *name, void (*search)(SearchCounts *), SearchCounts *counts)
+{
+    memset(counts, 0, sizeof(SearchCounts));
+    double start = getSeconds();
+    search(counts);
+    double seconds = getSeconds() - start;
+    printf("%-7s %12llu codes %14llu nodes %14llu steps looked at %8.3f s %8.2f M nodes/s\n", name, counts->codes,
+        counts->nodes, counts->steps, seconds, (counts->nodes / seconds) / 1e6);
+    return seconds;
+}
+
+
+
+/**
+ * Starts the program.
+ * @return Exit status.
+*/
+int main()
+{
+    // First, calculate the "lowest" grey code, the same way as GreyCodeChimera.c
+    lowest[0] = 1;
+    stepMask *init = lowest + 1;
+    for(int i = 0; i < NUM_DIGITS; i++) {
+        memcpy(init, lowest, (init - lowest) * sizeof(stepMask));
+        init += init - lowest - 1;
+        *init <<= 1;
+        init++;
+    }
+    lowest[len - 1] >>= 1;
+
+    printf("%d digits, the codes starting with the first %d steps of the lowest code\n\n", NUM_DIGITS, BENCHMARK_SET_STEPS);
+
+    SearchCounts flagCounts, bitsetCounts;
+    double flagSeconds = runSearch("flags", searchFlags, &flagCounts);
+    double bitsetSeconds = runSearch("bitset", searchBitset, &bitsetCounts);
+    if(flagCounts.codes != bitsetCounts.codes || flagCounts.nodes != bitsetCounts.nodes) {
+        printf("The engines don't match!\n");
+        return EXIT_FAILURE;
+    }
+    printf("\nbitset is %.2fx faster\n", flagSeconds / bitsetSeconds);
+    return EXIT_SUCCESS;
+}
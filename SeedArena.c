@@ -0,0 +1,130 @@
+/**
+ * @file SeedArena.c
+ * @author Joey Hughes
+ * This is the arena the seeds found by the code search live in, for GreyCodeChimera.c. Instead of allocating every seed
+ * on its own, each search worker has its own arena that hands out SeedBatches, which are chunks of SEED_BATCH_SIZE
+ * seeds stored right next to each other. The worker fills a batch up, pushes it onto the seed queue, and once an
+ * extrapolation thread is done with it the batch goes back to the arena it came from to be filled again. So after the
+ * first few batches nothing gets allocated at all, and everything an arena ever allocated is freed at once at the end.
+ * Only the worker that owns an arena allocates its batches, so with --numa they end up on the worker's node.
+*/
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#ifndef GREY_CODE_TYPES_DEFINED
+    #include "GreyCodeTypes.h"
+#endif
+
+
+/** How many seeds go in each batch. Can be set in compilation with -DSEED_BATCH_SIZE=X. */
+#ifndef SEED_BATCH_SIZE
+#define SEED_BATCH_SIZE 1024
+#endif
+
+
+/** Forward declaration so the batches can point back to their arena. */
+typedef struct SeedArenaStruct SeedArena;
+
+/** A batch of seeds. Filled by one search worker, then extrapolated by one extrapolation thread and given back to its arena. */
+typedef struct SeedBatchStruct {
+    /** How many seeds are in the batch. */
+    unsigned long long count;
+    /** The arena the batch came from and goes back to. */
+    SeedArena *arena;
+    /** The next batch in the arena's free list. */
+    struct SeedBatchStruct *nextFree;
+    /** The next batch in the arena's list of every batch it has. */
+    struct SeedBatchStruct *nextAllocated;
+    /** The seeds themselves, packed and one after another. */
+    packedSequence seeds[SEED_BATCH_SIZE];
+} SeedBatch;
+
+/** Struct for a whole arena. Owned by one search worker, but batches are given back to it from the extrapolation threads. */
+struct SeedArenaStruct {
+    /** Lock for the free list, since the batches are given back from other threads. */
+    pthread_mutex_t lock;
+    /** The batches that are ready to be filled again. */
+    SeedBatch *freeBatches;
+    /** Every batch the arena has allocated, to free them all at the end. */
+    SeedBatch *allBatches;
+    /** How many batches the arena has allocated. */
+    unsigned long long numBatches;
+    /** The NUMA node the owner runs on, so the seed queue can keep its batches with the others from that node. 0 if not placing the threads. */
+    int node;
+};
+
+
+
+/**
+ * Creates a new empty SeedArena.
+ * @param node The NUMA node the owner runs on, see NumaPlacement.c. 0 if not placing the threads.
+ * @return Pointer to the new SeedArena.
+*/
+SeedArena *createSeedArena(int node)
+{
+    SeedArena *arena = (SeedArena *)calloc(1, sizeof(SeedArena));
+    pthread_mutex_init(&(arena->lock), NULL);
+    arena->node = node;
+    return arena;
+}
+
+
+
+/**
+ * Gets an empty batch from the arena, reusing one that was given back if there is one.
+ * @param arena The arena to get the batch from.
+ * @return Pointer to the empty batch.
+*/
+SeedBatch *acquireSeedBatch(SeedArena *arena)
+{
+    pthread_mutex_lock(&(arena->lock));
+    SeedBatch *batch = arena->freeBatches;
+    if(batch != NULL) arena->freeBatches = batch->nextFree;
+    pthread_mutex_unlock(&(arena->lock));
+
+    // Nothing to reuse, make a new one. Only the owner ever allocates, so the allocated list doesn't need the lock.
+    if(batch == NULL) {
+        batch = (SeedBatch *)malloc(sizeof(SeedBatch));
+        batch->arena = arena;
+        batch->nextAllocated = arena->allBatches;
+        arena->allBatches = batch;
+        arena->numBatches++;
+    }
+    batch->count = 0;
+    return batch;
+}
+
+
+
+/**
+ * Gives a batch back to the arena it came from, once everything in it is done with.
+ * @param batch The batch to give back.
+*/
+void releaseSeedBatch(SeedBatch *batch)
+{
+    SeedArena *arena = batch->arena;
+    pthread_mutex_lock(&(arena->lock));
+    batch->nextFree = arena->freeBatches;
+    arena->freeBatches = batch;
+    pthread_mutex_unlock(&(arena->lock));
+}
+
+
+
+/**
+ * Frees the arena and every batch it ever allocated, given back or not. Nothing should be using them by now.
+ * @param arena The arena to free.
+*/
+void freeSeedArena(SeedArena *arena)
+{
+    SeedBatch *batch = arena->allBatches;
+    while(batch != NULL) {
+        SeedBatch *next = batch->nextAllocated;
+        free(batch);
+        batch = next;
+    }
+    pthread_mutex_destroy(&(arena->lock));
+    free(arena);
+}
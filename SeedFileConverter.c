@@ -0,0 +1,88 @@
+/**
+ * @file SeedFileConverter.c
+ * @author Joey Hughes
+ * This is a little program to turn a text list of seeds, like 5DigitSeedsAndTheirGroupSize.txt, into a binary seed file
+ * (see SeedStore.c) that GreyCodeChimera.c can extrapolate with --extrapolate. Each line of the text file is a seed as
+ * digits, optionally followed by a colon and its group size. If the group sizes are there, their total is printed, which
+ * should be the same as what the extrapolation gets from the binary file.
+ *
+ * To run it, compile with:
+ * gcc -Wall -std=c99 -O2 -DNUM_DIGITS=5 SeedFileConverter.c -o SeedFileConverter
+ * and run it with the text file and where to put the binary one:
+ * ./SeedFileConverter 5DigitSeedsAndTheirGroupSize.txt 5DigitSeeds.gcs
+ * The binary file isn't kept in the repo, since it's over 5 MB and this makes it in a second. To check the 5 digit
+ * extrapolation without running the whole search, make it like above and then run:
+ * ./GreyCodeChimera --extrapolate 5DigitSeeds.gcs
+ * --verify-extrapolation and --benchmark read the text file straight, so they don't need it.
+*/
+
+/** For fsync, pwrite, mmap and the like with -std=c99. Has to be before any of the system headers. */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "GreyCodeTypes.h"
+#include "SeedStore.c"
+
+
+/**
+ * Starts the program.
+ * @param argc The number of arguments.
+ * @param argv The text file to read and the seed file to write.
+ * @return Exit status.
+*/
+int main(int argc, char *argv[])
+{
+    if(argc != 3) {
+        fprintf(stderr, "Usage: %s SEEDS.txt SEEDS.gcs\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    FILE *textFile = fopen(argv[1], "r");
+    if(textFile == NULL) {
+        perror(argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    // Every seed starts with 0,1, same as the ones saved by the search
+    step seedPrefix[2] = {0, 1};
+    SeedStore *store = createSeedStore(argv[2], seedPrefix, 2);
+    if(store == NULL) return EXIT_FAILURE;
+
+    char line[len + 64];                  // One line of the text file
+    sequence seed;                        // The seed being read
+    packedSequence packedSeed;            // The seed packed for the seed file
+    unsigned long long lineNum = 0;       // Which line we're on, for the error messages
+    unsigned long long totalGroups = 0;   // The total of all the group sizes
+    while(fgets(line, sizeof(line), textFile) != NULL) {
+        lineNum++;
+        if(line[0] == '\n' || line[0] == '\0') continue;
+
+        // Read the digits of the seed
+        int i;
+        for(i = 0; i < len; i++) {
+            if(line[i] < '0' || line[i] >= '0' + NUM_DIGITS) break;
+            seed[i] = line[i] - '0';
+        }
+        if(i != len) {
+            fprintf(stderr, "%s:%llu: not a %d digit seed\n", argv[1], lineNum, NUM_DIGITS);
+            fclose(textFile);
+            closeSeedStore(store);
+            return EXIT_FAILURE;
+        }
+
+        // And the group size, if it's there
+        if(line[len] == ':') totalGroups += strtoull(line + len + 1, NULL, 10);
+
+        packSequence(seed, packedSeed);
+        appendSeedsToStore(store, &packedSeed, 1);
+    }
+    fclose(textFile);
+
+    printf("Wrote %llu seeds to %s.\n", (unsigned long long)store->count, argv[2]);
+    if(totalGroups) printf("The group sizes add up to %llu.\n", totalGroups);
+    closeSeedStore(store);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,150 @@
+/**
+ * @file SeedQueue.c
+ * @author Joey Hughes
+ * This is a bounded queue of seed batches for the GreyCodeChimera.c program. The code search workers fill up batches
+ * of seeds and push them in, and the extrapolation threads pop them out and extrapolate them while the search is still
+ * going. Since it is bounded, a search that gets ahead of the extrapolation just waits, so the seeds that are held in
+ * memory at once stay limited instead of piling up for the whole search. The batches themselves come from the search
+ * workers' SeedArenas. With --numa there's a ring of batches for each node, see NumaPlacement.c.
+*/
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#ifndef GREY_CODE_TYPES_DEFINED
+    #include "GreyCodeTypes.h"
+#endif
+#include "SeedArena.c"
+
+/** How many batches each ring of the queue holds before the search workers have to wait. Can be set in compilation with -DSEED_QUEUE_CAPACITY=X. */
+#ifndef SEED_QUEUE_CAPACITY
+#define SEED_QUEUE_CAPACITY 64
+#endif
+
+
+/** One ring buffer of batch pointers. The queue has one per NUMA node. */
+typedef struct {
+    /** The batches. */
+    SeedBatch *batches[SEED_QUEUE_CAPACITY];
+    /** The index of the next batch to pop. */
+    size_t head;
+    /** How many batches are in the ring. */
+    size_t count;
+} SeedRing;
+
+/** Struct for the whole queue. Every batch goes in the ring of the node its arena is on, and is popped from there by
+ * the extrapolation threads on that node first. */
+typedef struct {
+    /** Lock for everything in the queue. */
+    pthread_mutex_t lock;
+    /** Signaled when a batch is pushed or the queue is closed. */
+    pthread_cond_t notEmpty;
+    /** Broadcast when a batch is popped, since the waiting workers could be waiting on any of the rings. */
+    pthread_cond_t notFull;
+    /** One ring per node. */
+    SeedRing *rings;
+    /** How many rings there are. */
+    int numRings;
+    /** How many batches are in all the rings together. */
+    size_t count;
+    /** Set once no more batches will be pushed. */
+    bool closed;
+} SeedQueue;
+
+
+
+/**
+ * Creates a new empty SeedQueue.
+ * @param numNodes How many NUMA nodes the batches can come from, see NumaPlacement.c. 1 if not placing the threads.
+ * @return Pointer to the new SeedQueue.
+*/
+SeedQueue *createSeedQueue(int numNodes)
+{
+    SeedQueue *queue = (SeedQueue *)calloc(1, sizeof(SeedQueue));
+    pthread_mutex_init(&(queue->lock), NULL);
+    pthread_cond_init(&(queue->notEmpty), NULL);
+    pthread_cond_init(&(queue->notFull), NULL);
+    queue->rings = (SeedRing *)calloc(numNodes, sizeof(SeedRing));
+    queue->numRings = numNodes;
+    return queue;
+}
+
+
+
+/**
+ * Pushes a batch into the ring of its arena's node, waiting while that ring is full. The queue takes ownership of the batch.
+ * @param queue The queue to push into.
+ * @param batch The batch to push.
+*/
+void pushSeedBatch(SeedQueue *queue, SeedBatch *batch)
+{
+    SeedRing *ring = queue->rings + (batch->arena->node < queue->numRings ? batch->arena->node : 0);
+    pthread_mutex_lock(&(queue->lock));
+    while(ring->count == SEED_QUEUE_CAPACITY)
+        pthread_cond_wait(&(queue->notFull), &(queue->lock));
+    ring->batches[(ring->head + ring->count) % SEED_QUEUE_CAPACITY] = batch;
+    ring->count++;
+    queue->count++;
+    pthread_cond_signal(&(queue->notEmpty));
+    pthread_mutex_unlock(&(queue->lock));
+}
+
+
+
+/**
+ * Pops a batch from the queue, waiting while it is empty. It comes from the given node's ring if there's anything in
+ * it, and otherwise from the fullest of the others, so no thread sits waiting while there are seeds somewhere. The
+ * caller takes ownership of the batch.
+ * @param queue The queue to pop from.
+ * @param node The NUMA node of the thread popping. 0 if not placing the threads.
+ * @return The popped batch, or NULL if the queue is closed and there is nothing left in it.
+*/
+SeedBatch *popSeedBatch(SeedQueue *queue, int node)
+{
+    SeedBatch *batch = NULL;
+    pthread_mutex_lock(&(queue->lock));
+    while(queue->count == 0 && !queue->closed)
+        pthread_cond_wait(&(queue->notEmpty), &(queue->lock));
+    if(queue->count) {
+        SeedRing *ring = queue->rings + (node < queue->numRings ? node : 0);
+        for(int i = 0; i < queue->numRings && ring->count == 0; i++)
+            if(queue->rings[i].count > ring->count) ring = queue->rings + i;
+        batch = ring->batches[ring->head];
+        ring->head = (ring->head + 1) % SEED_QUEUE_CAPACITY;
+        ring->count--;
+        queue->count--;
+        pthread_cond_broadcast(&(queue->notFull));
+    }
+    pthread_mutex_unlock(&(queue->lock));
+    return batch;
+}
+
+
+
+/**
+ * Closes the queue, meaning no more batches will be pushed. Once the rest are popped, popSeedBatch returns NULL.
+ * @param queue The queue to close.
+*/
+void closeSeedQueue(SeedQueue *queue)
+{
+    pthread_mutex_lock(&(queue->lock));
+    queue->closed = true;
+    pthread_cond_broadcast(&(queue->notEmpty));
+    pthread_mutex_unlock(&(queue->lock));
+}
+
+
+
+/**
+ * Frees the queue. It should be closed and empty by this point.
+ * @param queue The queue to free.
+*/
+void freeSeedQueue(SeedQueue *queue)
+{
+    pthread_mutex_destroy(&(queue->lock));
+    pthread_cond_destroy(&(queue->notEmpty));
+    pthread_cond_destroy(&(queue->notFull));
+    free(queue->rings);
+    free(queue);
+}
@@ -0,0 +1,186 @@
+/**
+ * @file SeedSignatures.c
+ * @author Joey Hughes
+ * This is the code for seed signatures, for GreyCodeChimera.c. A seed's signature is how many times each digit flips
+ * in it (see Notes.txt). Relabeling a seed just moves the counts around between the digits, and rotating it doesn't
+ * change them at all, so a relabeling can only map a seed onto a rotation of itself if it keeps every digit's count
+ * the same. That means only the relabelings that swap digits with the same count around have to be tried, and for a
+ * seed where every digit flips a different number of times, that's just the identity.
+ * Which relabelings those are only depends on which digits have the same counts, the signature's pattern, so
+ * EXTRAPOLATE_SIGNATURE finds them once and keeps them until a seed with a different pattern comes along. To make
+ * that rare, bucketSeedFileBySignature sorts a seed file by pattern and then signature (--bucket-signatures), so all
+ * the seeds with the same pattern are together.
+ * This uses the SeedStore.c and PermutationTable.c from GreyCodeChimera.c, so it gets included after them.
+*/
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifndef GREY_CODE_TYPES_DEFINED
+    #include "GreyCodeTypes.h"
+#endif
+
+
+/** How many times each digit flips in a seed, by digit number. At most len / 2, so it fits in a byte up to 8 digits. */
+typedef unsigned char seedSignature[NUM_DIGITS];
+
+/** A seed with its signature, for sorting a seed file. */
+typedef struct {
+    /** The signature's pattern, see getSignaturePattern. */
+    unsigned int pattern;
+    /** The signature. */
+    seedSignature signature;
+    /** The seed. */
+    packedSequence seed;
+} SignedSeed;
+
+
+
+/**
+ * Finds the signature of a seed.
+ * @param seq The seed, len steps long.
+ * @param signature Where the signature goes.
+*/
+static inline void getSeedSignature(const step *seq, unsigned char *signature)
+{
+    memset(signature, 0, sizeof(seedSignature));
+    for(int i = 0; i < len; i++)
+        signature[seq[i]]++;
+}
+
+
+
+/**
+ * Finds the pattern of a signature, which is which digits have the same count. Each digit is given the first digit with
+ * the same count as it, and those are put together as a number base NUM_DIGITS. Two signatures keep the same
+ * relabelings exactly when they have the same pattern.
+ * @param signature The signature.
+ * @return The pattern. 0 only if every digit has the same count.
+*/
+static inline unsigned int getSignaturePattern(const unsigned char *signature)
+{
+    unsigned int pattern = 0;
+    for(int d = NUM_DIGITS - 1; d >= 0; d--) {
+        int first = 0;
+        while(signature[first] != signature[d]) first++;
+        pattern = (pattern * NUM_DIGITS) + first;
+    }
+    return pattern;
+}
+
+
+
+/**
+ * Checks if every digit in a signature has a different count, so the identity is the only relabeling that keeps it.
+ * @param signature The signature.
+ * @return True if the counts are all different.
+*/
+static inline bool isSignatureDistinct(const unsigned char *signature)
+{
+    unsigned long long seen = 0;
+    for(int d = 0; d < NUM_DIGITS; d++) {
+        if(seen & (1ULL << (signature[d] & 63))) return false;
+        seen |= 1ULL << (signature[d] & 63);
+    }
+    // Counts 64 apart share a bit, so double check those the long way. Only possible past 6 digits.
+    for(int d = 0; len > 64 && d < NUM_DIGITS; d++)
+        for(int e = d + 1; e < NUM_DIGITS; e++)
+            if(signature[d] == signature[e]) return false;
+    return true;
+}
+
+
+
+/**
+ * Finds every relabeling in the table that keeps a signature the same, so every digit gets relabeled to one with the
+ * same count. The identity is always first, since it's first in the table.
+ * @param permutations The table of all n! relabelings.
+ * @param signature The signature.
+ * @param indices Where the indices of the relabelings in the table go. Has to have room for all n! of them.
+ * @return How many relabelings keep it.
+*/
+int getSignaturePermutations(const PermutationTable *permutations, const unsigned char *signature, int *indices)
+{
+    int count = 0;
+    for(unsigned long long p = 0; p < permutations->count; p++) {
+        int d;
+        for(d = 0; d < NUM_DIGITS && signature[permutations->maps[p][d]] == signature[d]; d++);
+        if(d == NUM_DIGITS) indices[count++] = (int)p;
+    }
+    return count;
+}
+
+
+
+/**
+ * Sorts two SignedSeeds by pattern, then signature, then the seed itself, for qsort.
+ * @param a The first SignedSeed.
+ * @param b The second SignedSeed.
+ * @return Negative, zero, or positive, like memcmp.
+*/
+static int compareSignedSeeds(const void *a, const void *b)
+{
+    const SignedSeed *first = (const SignedSeed *)a, *second = (const SignedSeed *)b;
+    if(first->pattern != second->pattern) return first->pattern < second->pattern ? -1 : 1;
+    int signatureOrder = memcmp(first->signature, second->signature, sizeof(seedSignature));
+    if(signatureOrder) return signatureOrder;
+    return memcmp(first->seed, second->seed, sizeof(packedSequence));
+}
+
+
+
+/**
+ * Sorts the seeds in a finished seed file by their signatures, in place, so the ones with the same pattern are together
+ * for EXTRAPOLATE_SIGNATURE. It's the same seeds and the same count, so the checkpoint next to it is still good.
+ * @param path The seed file.
+ * @param numSignatures Where the number of different signatures goes.
+ * @param numDistinct Where the number of seeds where every digit has a different count goes.
+ * @return True if the file was sorted.
+*/
+bool bucketSeedFileBySignature(const char *path, unsigned long long *numSignatures, unsigned long long *numDistinct)
+{
+    // Read in every seed with its signature
+    MappedSeedFile file;
+    if(!mapSeedFile(path, &file)) return false;
+    SignedSeed *signedSeeds = (SignedSeed *)malloc(sizeof(SignedSeed) * (file.count ? file.count : 1));
+    step seq[len];
+    for(uint64_t i = 0; i < file.count; i++) {
+        memcpy(signedSeeds[i].seed, file.seeds[i], sizeof(packedSequence));
+        unpackSequence(file.seeds[i], seq);
+        getSeedSignature(seq, signedSeeds[i].signature);
+        signedSeeds[i].pattern = getSignaturePattern(signedSeeds[i].signature);
+    }
+    uint64_t count = file.count;
+    unmapSeedFile(&file);
+
+    // Sort them, and count the signatures while they're in order
+    qsort(signedSeeds, count, sizeof(SignedSeed), &compareSignedSeeds);
+    *numSignatures = 0;
+    *numDistinct = 0;
+    for(uint64_t i = 0; i < count; i++) {
+        if(i == 0 || memcmp(signedSeeds[i].signature, signedSeeds[i - 1].signature, sizeof(seedSignature)) != 0)
+            (*numSignatures)++;
+        if(isSignatureDistinct(signedSeeds[i].signature)) (*numDistinct)++;
+    }
+
+    // Write them back over the old ones, in chunks
+    int fd = open(path, O_WRONLY);
+    bool ok = fd >= 0;
+    packedSequence chunk[1024];
+    for(uint64_t first = 0; ok && first < count; first += 1024) {
+        size_t chunkSeeds = count - first < 1024 ? count - first : 1024;
+        for(size_t i = 0; i < chunkSeeds; i++)
+            memcpy(chunk[i], signedSeeds[first + i].seed, sizeof(packedSequence));
+        size_t chunkBytes = sizeof(packedSequence) * chunkSeeds;
+        ok = pwrite(fd, chunk, chunkBytes, sizeof(SeedFileHeader) + (sizeof(packedSequence) * first)) == (ssize_t)chunkBytes;
+    }
+    if(ok) ok = fsync(fd) == 0;
+    if(!ok) perror(path);
+    if(fd >= 0) close(fd);
+    free(signedSeeds);
+    return ok;
+}
@@ -0,0 +1,511 @@
+/**
+ * @file SeedStore.c
+ * @author Joey Hughes
+ * This is the code for saving seeds to disk in a binary seed file, so a long run doesn't lose everything if it dies.
+ * A seed file is a SeedFileHeader followed by every seed as a packedSequence (see PackedSequence.c), 3 bits per step
+ * with the first step in the highest bits of the first byte. The header has the number of digits, the set steps every seed in the file starts with, and how
+ * many seeds are in it for sure.
+ * The search appends seeds as it goes, and every so often the store is committed, which fsyncs the seeds, writes the new
+ * count into the header, and fsyncs again. Next to the seed file is a checkpoint file (the seed file's path with .ckpt on
+ * the end) that has where each search worker was in its DFS and which tasks are done as of that commit. Anything past
+ * the header's count was written after the last commit and can be thrown away.
+ * To pick a search back up after it dies, openSeedStore cuts the seed file back to the count in its checkpoint, which
+ * is read with readSearchCheckpoint.
+ * A finished seed file can be mapped with mapSeedFile and read by any number of threads at once without copying it.
+ * A text file of seeds and their group sizes, like 5DigitSeedsAndTheirGroupSize.txt, can be read with readSeedTextFile
+ * into the same MappedSeedFile, so it gets read the same way, and its group sizes come along next to it.
+ * This needs _POSIX_C_SOURCE to be defined before the system headers are included, for fsync, pwrite, ftruncate, and mmap.
+*/
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#ifndef GREY_CODE_TYPES_DEFINED
+    #include "GreyCodeTypes.h"
+#endif
+#include "PackedSequence.c"
+
+
+/** The magic string at the start of every seed file. Also has the version of the format in it. */
+#define SEED_FILE_MAGIC "GCSEEDS1"
+
+/** The magic string at the start of every checkpoint file. */
+#define CHECKPOINT_FILE_MAGIC "GCCKPT01"
+
+/** The most set steps the header of a seed file can hold. */
+#define SEED_FILE_MAX_PREFIX 32
+
+
+/** The header at the start of every seed file. It is 64 bytes so the packed seeds after it start nicely aligned. */
+typedef struct {
+    /** SEED_FILE_MAGIC, not null terminated. */
+    char magic[8];
+    /** The number of digits the seeds are for. */
+    uint32_t numDigits;
+    /** How many bits each step is packed into. Always BITS_PER_STEP. */
+    uint32_t bitsPerStep;
+    /** How many bytes each packed seed takes up. Always PACKED_SEQUENCE_BYTES. */
+    uint32_t seedBytes;
+    /** How many of the prefix steps are used. */
+    uint32_t numPrefixSteps;
+    /** The set steps, as digit numbers, that every seed in the file starts with. */
+    uint8_t prefix[SEED_FILE_MAX_PREFIX];
+    /** How many seeds are in the file as of the last commit. */
+    uint64_t count;
+} SeedFileHeader;
+
+/** A seed file being written to by the search. */
+typedef struct {
+    /** The open file descriptor of the seed file. */
+    int fd;
+    /** Lock around appending and committing, since every search worker writes to the same file. */
+    pthread_mutex_t lock;
+    /** How many seeds have been appended, committed or not. */
+    uint64_t count;
+    /** How many seeds were in the file as of the last commit. */
+    uint64_t committedCount;
+    /** The path of the seed file. */
+    char *path;
+} SeedStore;
+
+/** A seed file mapped into memory for reading. */
+typedef struct {
+    /** The header at the start of the mapping. */
+    const SeedFileHeader *header;
+    /** The packed seeds, right after the header. */
+    const packedSequence *seeds;
+    /** How many seeds can be read, from the header. */
+    uint64_t count;
+    /** How many bytes are mapped, to unmap it. */
+    size_t mappedSize;
+} MappedSeedFile;
+
+/** A text file of seeds and their group sizes, read into memory. */
+typedef struct {
+    /** The seeds, with no header. The seeds array is allocated instead of mapped, so free it with freeSeedTextFile. */
+    MappedSeedFile file;
+    /** How many codes each seed makes, its group size, by its index in the file. */
+    unsigned long long *groupSizes;
+    /** The total of all the group sizes. */
+    unsigned long long totalCodes;
+} SeedTextFile;
+
+/** Where one search worker was as of a checkpoint. */
+typedef struct {
+    /** The index of the task the worker was running, or -1 if it wasn't running one. */
+    int64_t taskIndex;
+    /** 1 if the position below is filled in, 0 if the worker hadn't found a code in its task yet. */
+    uint8_t hasPosition;
+    /** The last code the worker finished with, as digit numbers. The worker carries on from right after this code. */
+    step position[len];
+} SearchPosition;
+
+/** The header at the start of every checkpoint file. After it are numTasks bytes of which tasks are done, then numPositions SearchPositions. */
+typedef struct {
+    /** CHECKPOINT_FILE_MAGIC, not null terminated. */
+    char magic[8];
+    /** The number of digits the search is for. */
+    uint32_t numDigits;
+    /** How many steps every task has set, so a resume can tell if its tasks are the same ones. */
+    uint32_t taskDepth;
+    /** How many tasks the search was split into. */
+    uint64_t numTasks;
+    /** How many search workers there were, which is how many SearchPositions there are. */
+    uint64_t numPositions;
+    /** How many seeds are in the seed file as of this checkpoint. */
+    uint64_t seedCount;
+} CheckpointFileHeader;
+
+
+
+/**
+ * Creates a new seed file, overwriting one that is already there, and writes an empty header to it.
+ * @param path The path of the seed file.
+ * @param prefix The set steps, as digit numbers, that every seed going in will start with.
+ * @param numPrefixSteps How many set steps there are. At most SEED_FILE_MAX_PREFIX.
+ * @return Pointer to the new SeedStore, or NULL if the file couldn't be made.
+*/
+SeedStore *createSeedStore(const char *path, const step *prefix, int numPrefixSteps)
+{
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0) {
+        perror(path);
+        return NULL;
+    }
+
+    SeedFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SEED_FILE_MAGIC, sizeof(header.magic));
+    header.numDigits = NUM_DIGITS;
+    header.bitsPerStep = BITS_PER_STEP;
+    header.seedBytes = PACKED_SEQUENCE_BYTES;
+    header.numPrefixSteps = numPrefixSteps;
+    memcpy(header.prefix, prefix, numPrefixSteps);
+    if(write(fd, &header, sizeof(header)) != sizeof(header)) {
+        perror(path);
+        close(fd);
+        return NULL;
+    }
+
+    SeedStore *store = (SeedStore *)malloc(sizeof(SeedStore));
+    store->fd = fd;
+    store->count = 0;
+    store->committedCount = 0;
+    store->path = strdup(path);
+    pthread_mutex_init(&(store->lock), NULL);
+    return store;
+}
+
+
+
+/**
+ * Appends packed seeds to the end of the seed file. They aren't for sure on disk until the next commit.
+ * @param store The store to append to.
+ * @param seeds The packed seeds to append, one after another.
+ * @param numSeeds How many seeds to append.
+*/
+void appendSeedsToStore(SeedStore *store, const packedSequence *seeds, unsigned long long numSeeds)
+{
+    if(!numSeeds) return;
+
+    // They're already packed the same as in the file, so it's just one write
+    pthread_mutex_lock(&(store->lock));
+    size_t toWrite = PACKED_SEQUENCE_BYTES * numSeeds;
+    const uint8_t *writePtr = (const uint8_t *)seeds;
+    while(toWrite) {
+        ssize_t written = write(store->fd, writePtr, toWrite);
+        if(written <= 0) {
+            perror(store->path);
+            break;
+        }
+        writePtr += written;
+        toWrite -= written;
+    }
+    store->count += numSeeds;
+    pthread_mutex_unlock(&(store->lock));
+}
+
+
+
+/**
+ * Commits the store. Makes sure every appended seed is on disk, then writes the new count into the header and makes
+ * sure that is on disk too. The caller has to make sure nothing is appended while this is going on.
+ * @param store The store to commit.
+ * @return The count of seeds that was committed.
+*/
+uint64_t commitSeedStore(SeedStore *store)
+{
+    pthread_mutex_lock(&(store->lock));
+    fsync(store->fd);
+    uint64_t count = store->count;
+    if(pwrite(store->fd, &count, sizeof(count), offsetof(SeedFileHeader, count)) != sizeof(count))
+        perror(store->path);
+    fsync(store->fd);
+    store->committedCount = count;
+    pthread_mutex_unlock(&(store->lock));
+    return count;
+}
+
+
+
+/**
+ * Commits the store one last time, closes the file, and frees the store.
+ * @param store The store to close.
+*/
+void closeSeedStore(SeedStore *store)
+{
+    commitSeedStore(store);
+    close(store->fd);
+    pthread_mutex_destroy(&(store->lock));
+    free(store->path);
+    free(store);
+}
+
+
+
+/**
+ * Opens a seed file that the search was saving to before, to keep appending to it. Anything past the given count was
+ * written after the last checkpoint, so it's cut off, and the header is set to that count.
+ * @param path The path of the seed file.
+ * @param count How many seeds to keep, from the checkpoint.
+ * @return Pointer to the SeedStore, or NULL if the file couldn't be opened, isn't a seed file for this many digits, or
+ *         has fewer seeds than the count.
+*/
+SeedStore *openSeedStore(const char *path, uint64_t count)
+{
+    int fd = open(path, O_RDWR);
+    if(fd < 0) {
+        perror(path);
+        return NULL;
+    }
+
+    // Make sure it's a seed file for the right number of digits, with all the seeds there
+    SeedFileHeader header;
+    struct stat fileStat;
+    if(read(fd, &header, sizeof(header)) != sizeof(header) || fstat(fd, &fileStat) != 0
+            || memcmp(header.magic, SEED_FILE_MAGIC, sizeof(header.magic)) != 0 || header.numDigits != NUM_DIGITS
+            || header.bitsPerStep != BITS_PER_STEP || header.seedBytes != PACKED_SEQUENCE_BYTES
+            || (uint64_t)fileStat.st_size < sizeof(SeedFileHeader) + (PACKED_SEQUENCE_BYTES * count)) {
+        fprintf(stderr, "%s: not a seed file for %d digits with %llu seeds\n", path, NUM_DIGITS, (unsigned long long)count);
+        close(fd);
+        return NULL;
+    }
+
+    // Throw away whatever is past the checkpoint and start appending from there
+    off_t end = sizeof(SeedFileHeader) + (PACKED_SEQUENCE_BYTES * count);
+    if(ftruncate(fd, end) != 0 || pwrite(fd, &count, sizeof(count), offsetof(SeedFileHeader, count)) != sizeof(count)
+            || lseek(fd, end, SEEK_SET) != end) {
+        perror(path);
+        close(fd);
+        return NULL;
+    }
+    fsync(fd);
+
+    SeedStore *store = (SeedStore *)malloc(sizeof(SeedStore));
+    store->fd = fd;
+    store->count = count;
+    store->committedCount = count;
+    store->path = strdup(path);
+    pthread_mutex_init(&(store->lock), NULL);
+    return store;
+}
+
+
+
+/**
+ * Writes a checkpoint file for the seed file at seedPath. It's written to a temporary file, fsynced, then renamed over
+ * the old one, so there's always a whole checkpoint on disk even if this gets cut off.
+ * @param seedPath The path of the seed file. The checkpoint goes at this with .ckpt on the end.
+ * @param seedCount How many seeds were committed with this checkpoint.
+ * @param taskDepth How many steps every task has set.
+ * @param numTasks How many tasks there are.
+ * @param completedTasks numTasks bytes, nonzero for each task that is done.
+ * @param numPositions How many search workers there are.
+ * @param positions Where each search worker was.
+ * @return True if the checkpoint was written.
+*/
+bool writeSearchCheckpoint(const char *seedPath, uint64_t seedCount, int taskDepth, uint64_t numTasks,
+                           const uint8_t *completedTasks, uint64_t numPositions, const SearchPosition *positions)
+{
+    char path[strlen(seedPath) + 16];
+    char tempPath[strlen(seedPath) + 16];
+    sprintf(path, "%s.ckpt", seedPath);
+    sprintf(tempPath, "%s.ckpt.tmp", seedPath);
+
+    FILE *file = fopen(tempPath, "wb");
+    if(file == NULL) {
+        perror(tempPath);
+        return false;
+    }
+
+    CheckpointFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CHECKPOINT_FILE_MAGIC, sizeof(header.magic));
+    header.numDigits = NUM_DIGITS;
+    header.taskDepth = taskDepth;
+    header.numTasks = numTasks;
+    header.numPositions = numPositions;
+    header.seedCount = seedCount;
+
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1
+           && fwrite(completedTasks, 1, numTasks, file) == numTasks
+           && fwrite(positions, sizeof(SearchPosition), numPositions, file) == numPositions;
+    ok = (fflush(file) == 0) && ok;
+    fsync(fileno(file));
+    fclose(file);
+
+    if(!ok || rename(tempPath, path) != 0) {
+        perror(path);
+        return false;
+    }
+    return true;
+}
+
+
+
+/**
+ * Reads the checkpoint file for the seed file at seedPath.
+ * @param seedPath The path of the seed file. The checkpoint is at this with .ckpt on the end.
+ * @param header Where the checkpoint's header is written.
+ * @param completedTasks Where an allocated array of header->numTasks bytes of which tasks are done is written.
+ * @param positions Where an allocated array of header->numPositions SearchPositions is written.
+ * @return True if it was read, false if it couldn't be or isn't a checkpoint for this many digits.
+*/
+bool readSearchCheckpoint(const char *seedPath, CheckpointFileHeader *header, uint8_t **completedTasks, SearchPosition **positions)
+{
+    char path[strlen(seedPath) + 16];
+    sprintf(path, "%s.ckpt", seedPath);
+
+    FILE *file = fopen(path, "rb");
+    if(file == NULL) {
+        perror(path);
+        return false;
+    }
+
+    if(fread(header, sizeof(CheckpointFileHeader), 1, file) != 1
+            || memcmp(header->magic, CHECKPOINT_FILE_MAGIC, sizeof(header->magic)) != 0 || header->numDigits != NUM_DIGITS) {
+        fprintf(stderr, "%s: not a checkpoint for %d digits\n", path, NUM_DIGITS);
+        fclose(file);
+        return false;
+    }
+
+    *completedTasks = (uint8_t *)malloc(header->numTasks);
+    *positions = (SearchPosition *)malloc(sizeof(SearchPosition) * header->numPositions);
+    bool ok = fread(*completedTasks, 1, header->numTasks, file) == header->numTasks
+           && fread(*positions, sizeof(SearchPosition), header->numPositions, file) == header->numPositions;
+    fclose(file);
+
+    if(!ok) {
+        fprintf(stderr, "%s: cut off\n", path);
+        free(*completedTasks);
+        free(*positions);
+        return false;
+    }
+    return true;
+}
+
+
+
+/**
+ * Maps a seed file into memory for reading. The mapping is read only and shared, so every thread can read it at once.
+ * @param path The path of the seed file.
+ * @param seedFile Where the mapping is written.
+ * @return True if it was mapped, false if it couldn't be opened or isn't a seed file for this many digits.
+*/
+bool mapSeedFile(const char *path, MappedSeedFile *seedFile)
+{
+    int fd = open(path, O_RDONLY);
+    if(fd < 0) {
+        perror(path);
+        return false;
+    }
+
+    struct stat fileStat;
+    if(fstat(fd, &fileStat) != 0 || (size_t)fileStat.st_size < sizeof(SeedFileHeader)) {
+        fprintf(stderr, "%s: too small to be a seed file\n", path);
+        close(fd);
+        return false;
+    }
+
+    void *mapping = mmap(NULL, fileStat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if(mapping == MAP_FAILED) {
+        perror(path);
+        return false;
+    }
+
+    // Make sure it's a seed file for the right number of digits
+    const SeedFileHeader *header = (const SeedFileHeader *)mapping;
+    if(memcmp(header->magic, SEED_FILE_MAGIC, sizeof(header->magic)) != 0 || header->numDigits != NUM_DIGITS
+            || header->bitsPerStep != BITS_PER_STEP || header->seedBytes != PACKED_SEQUENCE_BYTES) {
+        fprintf(stderr, "%s: not a seed file for %d digits\n", path, NUM_DIGITS);
+        munmap(mapping, fileStat.st_size);
+        return false;
+    }
+
+    seedFile->header = header;
+    seedFile->seeds = (const packedSequence *)((const uint8_t *)mapping + sizeof(SeedFileHeader));
+    seedFile->mappedSize = fileStat.st_size;
+
+    // Only trust as many seeds as are actually there, in case the header is ahead of a cut off file
+    uint64_t seedsThere = (fileStat.st_size - sizeof(SeedFileHeader)) / PACKED_SEQUENCE_BYTES;
+    seedFile->count = header->count < seedsThere ? header->count : seedsThere;
+    return true;
+}
+
+
+
+/**
+ * Unmaps a seed file mapped with mapSeedFile.
+ * @param seedFile The mapped file.
+*/
+void unmapSeedFile(MappedSeedFile *seedFile)
+{
+    munmap((void *)seedFile->header, seedFile->mappedSize);
+    seedFile->header = NULL;
+    seedFile->seeds = NULL;
+    seedFile->count = 0;
+}
+
+
+
+/**
+ * Reads a text file of seeds and their group sizes, one "digits: size" line each like 5DigitSeedsAndTheirGroupSize.txt,
+ * stopping after maxSeeds of them.
+ * @param path The text file.
+ * @param maxSeeds The most seeds to read, 0 for all of them.
+ * @param textFile Where the seeds and group sizes go.
+ * @return True if it was read, false if it can't be or a line isn't a seed for this many digits.
+*/
+bool readSeedTextFile(const char *path, uint64_t maxSeeds, SeedTextFile *textFile)
+{
+    FILE *file = fopen(path, "r");
+    if(file == NULL) {
+        perror(path);
+        return false;
+    }
+
+    uint64_t capacity = 1024, numSeeds = 0;
+    packedSequence *seeds = (packedSequence *)malloc(sizeof(packedSequence) * capacity);
+    unsigned long long *groupSizes = (unsigned long long *)malloc(sizeof(unsigned long long) * capacity);
+    unsigned long long totalCodes = 0;
+    char line[len + 64];
+    step seed[len];
+    while((maxSeeds == 0 || numSeeds < maxSeeds) && fgets(line, sizeof(line), file) != NULL) {
+        unsigned long long groupSize;
+        int i;
+        for(i = 0; i < len && line[i] >= '0' && line[i] < '0' + NUM_DIGITS; i++)
+            seed[i] = line[i] - '0';
+        if(i < len || line[len] != ':' || sscanf(line + len + 1, "%llu", &groupSize) != 1) {
+            fprintf(stderr, "%s: line %llu isn't a %d digit seed and its group size\n", path,
+                (unsigned long long)numSeeds + 1, NUM_DIGITS);
+            fclose(file);
+            free(seeds);
+            free(groupSizes);
+            return false;
+        }
+
+        // Double the arrays when they fill up
+        if(numSeeds == capacity) {
+            capacity *= 2;
+            seeds = (packedSequence *)realloc(seeds, sizeof(packedSequence) * capacity);
+            groupSizes = (unsigned long long *)realloc(groupSizes, sizeof(unsigned long long) * capacity);
+        }
+        packSequence(seed, seeds[numSeeds]);
+        groupSizes[numSeeds++] = groupSize;
+        totalCodes += groupSize;
+    }
+    fclose(file);
+
+    textFile->file.header = NULL;
+    textFile->file.seeds = seeds;
+    textFile->file.count = numSeeds;
+    textFile->file.mappedSize = 0;
+    textFile->groupSizes = groupSizes;
+    textFile->totalCodes = totalCodes;
+    return true;
+}
+
+
+
+/**
+ * Frees a text file read with readSeedTextFile.
+ * @param textFile The text file.
+*/
+void freeSeedTextFile(SeedTextFile *textFile)
+{
+    free((void *)textFile->file.seeds);
+    free(textFile->groupSizes);
+    textFile->file.seeds = NULL;
+    textFile->file.count = 0;
+    textFile->groupSizes = NULL;
+}
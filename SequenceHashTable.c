@@ -1,277 +1,232 @@
 /**
  * @file SequenceHashTable.c
  * @author Joey Hughes
- * This contains an implementation of a resizable hash table that holds sequences. This table does not 
- * support removing elements. This table does support inserting, both checking and not checking for duplicates.
- * can check for if a key is contained, and has a constructor and destructor. This is meant for use in the 
- * GreyCodeChimera program in the main algorithm for finding the amount of seeds.
- * However, this has ended up becoming unused in the Chimera Program.
+ * This contains an implementation of a hash table that holds packed sequences, that any number of threads can insert
+ * into at once. It's used by GreyCodeChimera.c with --check-duplicates, where every seed the search workers find goes
+ * in it, to make sure no two workers ever find the same seed, however finely the search gets split up.
+ * This table does not support removing elements. It supports inserting if the key isn't already there, checking if a
+ * key is contained, and has a constructor and destructor.
+ *
+ * The table is split into SEQ_TABLE_SEGMENTS segments by the top bits of the hash, and each segment is its own little
+ * open addressing table with its own lock. So two threads only ever wait on each other if their keys land in the same
+ * segment, and when a segment gets too full, only that segment gets doubled and rehashed, while the rest carry on.
+ * It used to hold unpacked sequences and multiply its whole size by 8 at once.
 */
 
 #include <stdbool.h>
 #include <string.h>
 #include <stdlib.h>
+#include <pthread.h>
 
 #ifndef GREY_CODE_TYPES_DEFINED
     #include "GreyCodeTypes.h"
 #endif
 
-/** If the fraction of filled buckets in this hash table gets above this ratio, then the hash table will be rehashed. */
-#define SIZE_LIMIT_FRACTION (1.0/3.0)
+/** If the fraction of filled buckets in a segment gets above this ratio, then the segment will be doubled and rehashed. */
+#define SIZE_LIMIT_FRACTION (1.0/2.0)
 
-/** The prime used in calculating the initial hash. */
-#define HASH_PRIME 5
+/** How many segments the table is split into, as a power of 2. */
+#define SEQ_TABLE_SEGMENT_BITS 6
 
-/** The prime used in calculating the double hash. */
-#define DOUBLE_HASH_PRIME 7
+/** How many segments the table is split into. */
+#define SEQ_TABLE_SEGMENTS (1 << SEQ_TABLE_SEGMENT_BITS)
 
 
 
 
 
-/** Struct for a whole HashTable. Used in the seed extrapolation part. */
+/** One segment of the table. Each is padded out to its own cache lines so the locks don't share any. */
 typedef struct {
-    /** The hash table array. Holds HashNodes. */
-    sequence *nodes;
-    /** The array that describes which nodes are occupied. Not included in the structs for storage reasons, and makes emptying easier. */
+    /** Held while looking in or adding to this segment. */
+    pthread_mutex_t lock;
+    /** The buckets. Each holds a packed sequence. */
+    packedSequence *keys;
+    /** The array that describes which buckets are occupied. */
     bool *occupied;
-    /** The total size of the hash table, how many buckets it has. */
+    /** How many buckets the segment has. Always a power of 2. */
     size_t size;
-    /** The number of actual elements in the hash table. */
+    /** size - 1, for masking the hash. */
+    size_t modMask;
+    /** The number of actual elements in the segment. */
     size_t count;
-    /** Instead of having to modulus, since the size is a power of 2 we can use bit AND, this is the mask.*/
-    unsigned long modMask;
-} SeqHashTable;
-
+} __attribute__((aligned(64))) SeqTableSegment;
 
-/**
- * The first hash function for the table. This takes the key and turns it into an index in the table.
- * @param key The sequence to turn into an index.
- * @param table_size The capacity of the hash table.
- * @return The index in the hash table to try to store at.
-*/
-static unsigned long seqHash1(const sequence key, unsigned long modMask)
-{
-    const step *stepPtr = key;
-    register unsigned long hash = 0;
-    while(stepPtr - key < len) 
-        hash = ((hash * HASH_PRIME) + *(stepPtr++)) & modMask;
-    return hash;
-}
+/** Struct for a whole HashTable. */
+typedef struct {
+    /** The segments. A key goes in the segment picked by the top bits of its hash. */
+    SeqTableSegment segments[SEQ_TABLE_SEGMENTS];
+} SeqHashTable;
 
 
 
 /**
- * The double hashing function. This function takes the key and returns a number of indices to jump by in the hash table
- * when there is a collision.
- * @param key The sequence key.
- * @param table_size The capacity of the hash table.
- * @return The number of indices to jump by in the hash table.
+ * The hash function for the table. It mixes all the bytes of the packed sequence into 64 bits. The top bits pick the
+ * segment and the bottom bits the bucket in it.
+ * @param key The packed sequence to hash.
+ * @return The hash.
 */
-static unsigned long seqHash2(const sequence key, unsigned long modMask) 
+static inline unsigned long long seqHash(const packedSequence key)
 {
-    modMask >>= 1; // so we can safely add two if needed.
-    const step *stepPtr = key + len/2;
-    register unsigned long hash = 0;
-    while(stepPtr - key < len) 
-        hash = ((hash * DOUBLE_HASH_PRIME) + *(stepPtr++)) & modMask;
-    return hash + 1 + (hash & 1);
+    unsigned long long hash = 0xCBF29CE484222325ULL;
+    for(int i = 0; i < PACKED_SEQUENCE_BYTES; i++)
+        hash = (hash ^ key[i]) * 0x100000001B3ULL;
+    hash ^= hash >> 29;
+    hash *= 0xBF58476D1CE4E5B9ULL;
+    return hash ^ (hash >> 32);
 }
 
 
 
 /**
- * Creates a new HashTable and allocates it. The size of this type of hash table will always
- * be a power of two. The exponent parameter is which power of two this hash table will start
- * out as. For example, if 3, then this table will start with 2^(3) = 8 buckets.
- * @param size The exponent of two to make the size of the new HashTable.
+ * Creates a new HashTable and allocates it. The size of each segment will always be a power of two. The exponent
+ * parameter is which power of two each segment starts out as. For example, if 3, then every segment will start with
+ * 2^(3) = 8 buckets.
+ * @param exponent The exponent of two to make the size of each segment.
  * @return Pointer to the new HashTable.
 */
 SeqHashTable* createSeqTable(unsigned char exponent)
 {
-    SeqHashTable* table = (SeqHashTable*)malloc(sizeof(SeqHashTable));
-    table->size = (1 << exponent);
-    table->modMask = (table->size - 1);
-    table->count = 0;
-    table->nodes = (sequence *)malloc(table->size * sizeof(sequence));
-    table->occupied = (bool *)calloc(table->size, sizeof(bool));
+    SeqHashTable* table;
+    if(posix_memalign((void **)&table, 64, sizeof(SeqHashTable)) != 0) return NULL;
+    for(int s = 0; s < SEQ_TABLE_SEGMENTS; s++) {
+        SeqTableSegment *segment = table->segments + s;
+        pthread_mutex_init(&(segment->lock), NULL);
+        segment->size = ((size_t)1 << exponent);
+        segment->modMask = (segment->size - 1);
+        segment->count = 0;
+        segment->keys = (packedSequence *)malloc(segment->size * sizeof(packedSequence));
+        segment->occupied = (bool *)calloc(segment->size, sizeof(bool));
+    }
     return table;
 }
 
 
 
 /**
- * Called if the proportion of the table that is full is above the SIZE_LIMIT_FRACTION.
- * Increases the size of the table by a factor of 8 and rehashes all the items inside.
+ * Called if the proportion of a segment that is full is above the SIZE_LIMIT_FRACTION, with its lock held.
+ * Doubles the size of just that segment and rehashes all the items inside.
+ * @param segment The segment to resize.
 */
-static void resizeTable(SeqHashTable* table)
+static void resizeSegment(SeqTableSegment *segment)
 {
-    // Increase the size by 2^3, update the modMask
-    table->size *= 8;
-    table->modMask = (table->size - 1);
-
-    // Allocate the new arrays
-    sequence *newBuckets = (sequence *)malloc(table->size * sizeof(sequence));
-    bool *newOccupied = (bool *)calloc(table->size, sizeof(bool));
-
-    // Loop through the occupied array and rehash every old element into the new arrays
-    size_t rehashesLeft = table->count;        // The amount of rehashes left to do
-    bool *occPtr = table->occupied;            // Pointer to inside occupied that searches for elements in the old table
-    unsigned long index;                       // Holds the rehashed index for each element
-    unsigned long doubleHash;                  // Holds the rehashed doublehash for each element
-    step *beingRehashed;                       // References the sequence currently being rehashed
-    while(rehashesLeft) {
-
-        // Go until we have an occupied element
-        while(!*occPtr) occPtr++;
-
-        // We have found an occupied bucket, grab it's sequence and rehash it with the new size
-        beingRehashed = table->nodes[occPtr - (table->occupied)];
-        index = seqHash1(beingRehashed, table->modMask);
-        if(!newOccupied[index]) goto rehashFunctionAddToTable; // if it's immediately open, don't double hash and just add
-
-        // If it's not immediately open, double hash and start stepping
-        doubleHash = seqHash2(beingRehashed, table->modMask);
-
-        // Now loop until reaching an open spot
-        do
-            index = (index + doubleHash) & (table->modMask);
-        while(newOccupied[index]);
-
-        // We found the next open spot, add it
-        rehashFunctionAddToTable:
-        memcpy(newBuckets[index], beingRehashed, sizeof(step) * len);
-        newOccupied[index] = true;
-        
-        // We have finished a rehash, decrement the counter and increment;
-        rehashesLeft--;
-        occPtr++;
+    size_t oldSize = segment->size;
+    packedSequence *oldKeys = segment->keys;
+    bool *oldOccupied = segment->occupied;
+
+    // Double the size, update the modMask, and allocate the new arrays
+    segment->size *= 2;
+    segment->modMask = (segment->size - 1);
+    segment->keys = (packedSequence *)malloc(segment->size * sizeof(packedSequence));
+    segment->occupied = (bool *)calloc(segment->size, sizeof(bool));
+
+    // Rehash every old element into the new arrays
+    for(size_t i = 0; i < oldSize; i++) {
+        if(!oldOccupied[i]) continue;
+        size_t index = seqHash(oldKeys[i]) & segment->modMask;
+        while(segment->occupied[index])
+            index = (index + 1) & segment->modMask;
+        memcpy(segment->keys[index], oldKeys[i], sizeof(packedSequence));
+        segment->occupied[index] = true;
     }
 
-    // Now we have rehashed and copied all the elements into the new array.
-    // Free the old ones
-    free(table->nodes);
-    free(table->occupied);
-
-    // Set them to the new ones. Now we have new arrays, the size has been increased, count stayed the same, we are done.
-    table->nodes = newBuckets;
-    table->occupied = newOccupied;
+    free(oldKeys);
+    free(oldOccupied);
 }
 
 
 
 /**
- * Inserts an element into the HashTable, using double hashing if there is a collision. If
- * the key is found to already be in the hash table, then it is not inserted again and false
- * is returned. If the sequence is added successfully, then true is returned.
+ * Inserts an element into the HashTable, going on to the next bucket if there is a collision. If the key is found to
+ * already be in the hash table, then it is not inserted again and false is returned. If the sequence is added
+ * successfully, then true is returned. Safe to call from any number of threads at once.
  * @param table The pointer to the HashTable to put the key in.
- * @param key The sequence to put into the HashTable.
- * @return True if the sequence was added, false if it was already in the list.
+ * @param key The packed sequence to put into the HashTable.
+ * @return True if the sequence was added, false if it was already in the table.
 */
-bool seqHashInsertIfNotContains(SeqHashTable* table, const sequence key) 
+bool seqHashInsertIfNotContains(SeqHashTable* table, const packedSequence key)
 {
-    // If we are at the capacity limit, then resize the table.
-    if(((double)table->count)/table->size > SIZE_LIMIT_FRACTION) 
-        resizeTable(table);
-
-    // Otherwise, hash to find the initial index
-    unsigned long index = seqHash1(key, table->modMask);
-
-    // If that index is already open, go ahead and add it there
-    if(!table->occupied[index]) goto insertFunctionAddToTable;
-
-    // Otherwise, check if it's the same sequence, and if so it's a duplicate, return false
-    else if(memcmp(table->nodes[index], key, sizeof(step) * len) == 0) return false;
-
-    // Otherwise, doubleHash and step once, then loop to find the next open spot
-    unsigned long doubleHash = seqHash2(key, table->modMask);
-    index = (index + doubleHash) & (table->modMask);
-    while(table->occupied[index]) {
-        if(memcmp(table->nodes[index], key, sizeof(step) * len) == 0)
-            return false; // Key already in there, return false, don't add
-        index = (index + doubleHash) & (table->modMask);
+    unsigned long long hash = seqHash(key);
+    SeqTableSegment *segment = table->segments + (hash >> (64 - SEQ_TABLE_SEGMENT_BITS));
+    pthread_mutex_lock(&(segment->lock));
+
+    // If the segment is at the capacity limit, then resize it.
+    if(((double)segment->count)/segment->size > SIZE_LIMIT_FRACTION)
+        resizeSegment(segment);
+
+    // Go through the buckets until an open one, and if the key's in one of them, it's a duplicate
+    size_t index = hash & segment->modMask;
+    while(segment->occupied[index]) {
+        if(memcmp(segment->keys[index], key, sizeof(packedSequence)) == 0) {
+            pthread_mutex_unlock(&(segment->lock));
+            return false; // Key already in there, don't add
+        }
+        index = (index + 1) & segment->modMask;
     }
 
     // We found the next open spot and the key's not already in there, so add it
-    insertFunctionAddToTable:
-    memcpy(table->nodes[index], key, sizeof(step) * len);
-    table->occupied[index] = true;
-    table->count++;
+    memcpy(segment->keys[index], key, sizeof(packedSequence));
+    segment->occupied[index] = true;
+    segment->count++;
+    pthread_mutex_unlock(&(segment->lock));
     return true;
 }
 
 
 
 /**
- * Inserts an element into the HashTable, using double hashing if there is a collision.
- * This does not check for duplicates.
- * @param table The pointer to the HashTable to put the key in.
- * @param key The sequence to put into the HashTable.
+ * Returns a bool of whether or not the given table contains the given key. Safe to call while other threads insert.
+ * @param table The pointer to the HashTable to search in.
+ * @param key The packed sequence to find.
+ * @return True if the hash table already contains the key, false if not.
 */
-void seqHashInsert(SeqHashTable* table, const sequence key) 
+bool seqHashContains(SeqHashTable* table, const packedSequence key)
 {
-    // If we are at the capacity limit, then resize the table.
-    if(((double)table->count)/table->size > SIZE_LIMIT_FRACTION) 
-        resizeTable(table);
-
-    // Otherwise, hash to find the initial index
-    unsigned long index = seqHash1(key, table->modMask);
-
-    // If that index is already open, go ahead and add it there
-    if(!table->occupied[index]) goto insertFunctionAddToTable;
-
-    // Otherwise, doubleHash and step once, then loop to find the next open spot
-    unsigned long doubleHash = seqHash2(key, table->modMask);
-    index = (index + doubleHash) & (table->modMask);
-    while(table->occupied[index])
-        index = (index + doubleHash) & (table->modMask);
-
-    // We found the next open spot and the key's not already in there, so add it
-    insertFunctionAddToTable:
-    memcpy(table->nodes[index], key, sizeof(step) * len);
-    table->occupied[index] = true;
-    table->count++;
+    unsigned long long hash = seqHash(key);
+    SeqTableSegment *segment = table->segments + (hash >> (64 - SEQ_TABLE_SEGMENT_BITS));
+    bool found = false;
+    pthread_mutex_lock(&(segment->lock));
+    size_t index = hash & segment->modMask;
+    while(segment->occupied[index]) {
+        if(memcmp(segment->keys[index], key, sizeof(packedSequence)) == 0) {
+            found = true;
+            break;
+        }
+        index = (index + 1) & segment->modMask;
+    }
+    pthread_mutex_unlock(&(segment->lock));
+    return found;
 }
 
 
 
 /**
- * Returns a bool of whether or not the given table contains the given key.
- * @param table The pointer to the HashTable to search in.
- * @param key The sequence to find.
- * @return True if the hash table already contains the key, false if not.
+ * Gets how many sequences are in the table. Only exact once nothing is inserting anymore.
+ * @param table The pointer to the HashTable.
+ * @return The number of sequences in it.
 */
-bool seqHashContains(SeqHashTable* table, const sequence key) {
-
-    // Hash the key, then find if it's in there or not.
-    unsigned long index = seqHash1(key, table->modMask);
-
-    // If that index is already open, go ahead and return false
-    if(!table->occupied[index]) return false;
-
-    // Otherwise, check if it's the same sequence, and if so, return true, we found it
-    else if(memcmp(table->nodes[index], key, sizeof(step) * len) == 0) return true;
-
-    // Otherwise, doubleHash and step once, then loop
-    unsigned long doubleHash = seqHash2(key, table->modMask);
-    index = (index + doubleHash) & (table->modMask);
-    while(table->occupied[index]) {
-        if(memcmp(table->nodes[index], key, sizeof(step) * len) == 0)
-            return true; // We found it, return true
-        index = (index + doubleHash) & (table->modMask);
+size_t getSeqTableCount(SeqHashTable* table)
+{
+    size_t count = 0;
+    for(int s = 0; s < SEQ_TABLE_SEGMENTS; s++) {
+        pthread_mutex_lock(&(table->segments[s].lock));
+        count += table->segments[s].count;
+        pthread_mutex_unlock(&(table->segments[s].lock));
     }
-    return false; // We got to an open spot and never found it.
+    return count;
 }
 
 
 
 /**
- * Frees the HashTable, including clearing all the sequenceNums.
+ * Frees the HashTable and all its segments.
  * @param table The pointer to the HashTable to free.
 */
 void freeSeqTable(SeqHashTable* table)
 {
-    free(table->nodes);
-    free(table->occupied);
+    for(int s = 0; s < SEQ_TABLE_SEGMENTS; s++) {
+        pthread_mutex_destroy(&(table->segments[s].lock));
+        free(table->segments[s].keys);
+        free(table->segments[s].occupied);
+    }
     free(table);
 }
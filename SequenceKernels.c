@@ -0,0 +1,322 @@
+/**
+ * @file SequenceKernels.c
+ * @author Joey Hughes
+ * These are the little loops over whole sequences that GreyCodeChimera.c runs the most: swap and relabelSequence for
+ * the extrapolation, and isRelabelLower for the seed checks in the code search. swapMasks and isLower are what the seed
+ * checks used to do, swapping a copy of the whole sequence and then comparing, and are still here for the benchmark.
+ * Most have a plain scalar version, and if it's compiled with AVX2 (-mavx2 or -march=native) a vectorized version
+ * too. For 5 and 6 digits a sequence is only 32 to 128 bytes, so that's just a few registers.
+ * The swaps compare the whole register against both steps at once and flip the matching ones with an XOR of a ^ b,
+ * which swaps them without any branches. isLower compares 16 stepMasks at a time and uses movemask and ctz to find the
+ * first one that's different. relabelSequence uses the map from PermutationTable.c as a pshufb lookup table, so a whole
+ * register of steps is relabeled in one instruction. isRelabelLower is only scalar, it relabels one step at a time as it
+ * compares and leaves at the first step that's different, which for almost every code is only a few steps in.
+ * Which one is used is picked at compile time. Compiling with -DSCALAR_KERNELS uses the scalar ones even with AVX2.
+ * KernelBenchmark.c times the two against each other.
+*/
+
+#include <stdbool.h>
+
+#ifndef GREY_CODE_TYPES_DEFINED
+    #include "GreyCodeTypes.h"
+#endif
+
+#if defined(__AVX2__) && !defined(SCALAR_KERNELS)
+#define AVX2_KERNELS 1
+#include <immintrin.h>
+#endif
+
+
+
+/**
+ * (Extrapolating) Performs a swap in a sequence, one step at a time. Goes through the sequence and whenever it sees a,
+ * it writes b and when it sees b it writes a.
+ * @param seq The sequence array.
+ * @param a The first step digit number to swap.
+ * @param b The other step digit number to swap.
+ * @param limit How many steps to look at. For normal sequences is len.
+*/
+static inline void swapScalar(step *seq, step a, step b, int limit)
+{
+    while(limit) {
+        if(*seq == a) *seq = b;
+        else if(*seq == b) *seq = a;
+        seq++;
+        limit--;
+    }
+}
+
+
+
+/**
+ * (Seed Searching) Performs a swap in a sequence of stepMasks, one step at a time. Goes through the sequence and
+ * whenever it sees a, it writes b and when it sees b it writes a.
+ * @param seq The sequence array.
+ * @param a The first stepMask to swap.
+ * @param b The other stepMask to swap.
+ * @param limit How many steps to look at. For normal sequences is len.
+*/
+static inline void swapMasksScalar(stepMask *seq, stepMask a, stepMask b, int limit)
+{
+    while(limit) {
+        if(*seq == a) *seq = b;
+        else if(*seq == b) *seq = a;
+        seq++;
+        limit--;
+    }
+}
+
+
+
+/**
+ * (Extrapolating) Relabels the digits of a sequence with a map from the PermutationTable, one step at a time.
+ * @param seq The sequence to relabel, len steps long.
+ * @param map The map, map[d] is what digit d becomes.
+ * @param out Where the relabeled sequence is written, len steps long. Can't be seq.
+*/
+static inline void relabelSequenceScalar(const step *seq, const step *map, step *out)
+{
+    for(int i = 0; i < len; i++)
+        out[i] = map[seq[i]];
+}
+
+
+
+/**
+ * (Seed Searching) Applies a swap of two stepMasks to a relabeling, so the relabeling does whatever it did before and then
+ * the swap, like swapMasks would on a sequence that had already been relabeled.
+ * @param relabel The relabeling, indexed by stepMask. Only the entries for the NUM_DIGITS single bit stepMasks are used.
+ * @param a The first stepMask to swap.
+ * @param b The other stepMask to swap.
+*/
+static inline void swapRelabel(stepMask *relabel, stepMask a, stepMask b)
+{
+    for(int d = 0; d < NUM_DIGITS; d++) {
+        stepMask *entry = relabel + (1 << d);
+        if(*entry == a) *entry = b;
+        else if(*entry == b) *entry = a;
+    }
+}
+
+
+
+/**
+ * (Seed Searching) Returns true if a rotation of a sequence, relabeled, is lower in terms of sequence number than the
+ * sequence itself. It relabels one step at a time while comparing, so nothing is copied or swapped, and it stops at the
+ * first step that is different. If they are equal, false is returned, as it is not strictly lower.
+ * @param seq The sequence, len stepMasks long.
+ * @param rotation Which step of seq the rotation starts at.
+ * @param relabel The relabeling, indexed by stepMask.
+ * @param from How many steps at the start are already known to be the same, so they don't have to be compared.
+ * @return True if the rotation relabeled is lower than seq. If true, seq is not a seed.
+*/
+static inline bool isRelabelLower(const stepMask *seq, int rotation, const stepMask *relabel, int from)
+{
+    const stepMask *rotated = seq + rotation + from;
+    if(rotated >= seq + len) rotated -= len;
+    for(int i = from; i < len; i++) {
+        stepMask relabeled = relabel[*(rotated++)];
+        if(relabeled != seq[i]) return relabeled < seq[i];
+        if(rotated == seq + len) rotated = seq;
+    }
+    return false;
+}
+
+
+
+/**
+ * Returns true if the first sequence, beingTested, is lower in terms of sequence number than the second, original,
+ * one step at a time. If they are equal, false is returned, as it is not strictly lower.
+ * @param beingTested The first sequence.
+ * @param original The second sequence.
+ * @return True if the first is lower than the second. If true, the second is not a seed.
+*/
+static inline bool isLowerScalar(const stepMask *beingTested, const stepMask *original)
+{
+    register int limit = len;
+    while(limit && *beingTested == *original) {
+        original++;
+        beingTested++;
+        limit--;
+    }
+    return limit && *beingTested < *original;
+}
+
+
+
+#ifdef AVX2_KERNELS
+
+/**
+ * (Extrapolating) The AVX2 version of swap. 32 steps at a time, then 16, then whatever is left one at a time.
+ * @param seq The sequence array.
+ * @param a The first step digit number to swap.
+ * @param b The other step digit number to swap.
+ * @param limit How many steps to look at. For normal sequences is len.
+*/
+static inline void swapAVX2(step *seq, step a, step b, int limit)
+{
+    const __m256i va = _mm256_set1_epi8((char)a);
+    const __m256i vb = _mm256_set1_epi8((char)b);
+    const __m256i flip = _mm256_set1_epi8((char)(a ^ b));
+    while(limit >= 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)seq);
+        __m256i matches = _mm256_or_si256(_mm256_cmpeq_epi8(x, va), _mm256_cmpeq_epi8(x, vb));
+        _mm256_storeu_si256((__m256i *)seq, _mm256_xor_si256(x, _mm256_and_si256(matches, flip)));
+        seq += 32;
+        limit -= 32;
+    }
+    if(limit >= 16) {
+        __m128i x = _mm_loadu_si128((const __m128i *)seq);
+        __m128i matches = _mm_or_si128(_mm_cmpeq_epi8(x, _mm256_castsi256_si128(va)), _mm_cmpeq_epi8(x, _mm256_castsi256_si128(vb)));
+        _mm_storeu_si128((__m128i *)seq, _mm_xor_si128(x, _mm_and_si128(matches, _mm256_castsi256_si128(flip))));
+        seq += 16;
+        limit -= 16;
+    }
+    swapScalar(seq, a, b, limit);
+}
+
+
+
+/**
+ * (Seed Searching) The AVX2 version of swapMasks. 16 stepMasks at a time, then whatever is left one at a time.
+ * @param seq The sequence array.
+ * @param a The first stepMask to swap.
+ * @param b The other stepMask to swap.
+ * @param limit How many steps to look at. For normal sequences is len.
+*/
+static inline void swapMasksAVX2(stepMask *seq, stepMask a, stepMask b, int limit)
+{
+    const __m256i va = _mm256_set1_epi16((short)a);
+    const __m256i vb = _mm256_set1_epi16((short)b);
+    const __m256i flip = _mm256_set1_epi16((short)(a ^ b));
+    while(limit >= 16) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)seq);
+        __m256i matches = _mm256_or_si256(_mm256_cmpeq_epi16(x, va), _mm256_cmpeq_epi16(x, vb));
+        _mm256_storeu_si256((__m256i *)seq, _mm256_xor_si256(x, _mm256_and_si256(matches, flip)));
+        seq += 16;
+        limit -= 16;
+    }
+    swapMasksScalar(seq, a, b, limit);
+}
+
+
+
+/**
+ * (Extrapolating) The AVX2 version of relabelSequence. The map is the lookup table for the shuffle in both halves of the
+ * register, so it's 32 steps at a time, then 16, then whatever is left one at a time.
+ * @param seq The sequence to relabel, len steps long.
+ * @param map The map, 16 bytes with map[d] being what digit d becomes.
+ * @param out Where the relabeled sequence is written, len steps long. Can't be seq.
+*/
+static inline void relabelSequenceAVX2(const step *seq, const step *map, step *out)
+{
+    const __m128i table = _mm_loadu_si128((const __m128i *)map);
+    const __m256i wideTable = _mm256_broadcastsi128_si256(table);
+    int i = 0;
+    for(; i + 32 <= len; i += 32)
+        _mm256_storeu_si256((__m256i *)(out + i), _mm256_shuffle_epi8(wideTable, _mm256_loadu_si256((const __m256i *)(seq + i))));
+    for(; i + 16 <= len; i += 16)
+        _mm_storeu_si128((__m128i *)(out + i), _mm_shuffle_epi8(table, _mm_loadu_si128((const __m128i *)(seq + i))));
+    for(; i < len; i++)
+        out[i] = map[seq[i]];
+}
+
+
+
+/**
+ * The AVX2 version of isLower. Compares 16 stepMasks at a time, and the movemask of the compare has two bits per
+ * stepMask, so the ctz of the bits that didn't match over 2 is the first stepMask that's different.
+ * @param beingTested The first sequence.
+ * @param original The second sequence.
+ * @return True if the first is lower than the second. If true, the second is not a seed.
+*/
+static inline bool isLowerAVX2(const stepMask *beingTested, const stepMask *original)
+{
+    int i = 0;
+    for(; i + 16 <= len; i += 16) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(beingTested + i));
+        __m256i y = _mm256_loadu_si256((const __m256i *)(original + i));
+        unsigned int different = ~(unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi16(x, y));
+        if(different) {
+            int first = i + (__builtin_ctz(different) >> 1);
+            return beingTested[first] < original[first];
+        }
+    }
+    // len is a multiple of 16 from 4 digits up, so there's never anything left here, but just in case
+    return i < len && isLowerScalar(beingTested + i, original + i);
+}
+
+#endif
+
+
+
+/**
+ * (Extrapolating) Performs a swap in a sequence. Goes through the sequence and whenever it sees a, it writes b and when it sees b it writes a.
+ * @param seq The sequence array.
+ * @param a The first step digit number to swap.
+ * @param b The other step digit number to swap.
+ * @param limit How many steps to look at. For normal sequences is len.
+*/
+static inline void swap(step *seq, step a, step b, int limit)
+{
+    #ifdef AVX2_KERNELS
+    swapAVX2(seq, a, b, limit);
+    #else
+    swapScalar(seq, a, b, limit);
+    #endif
+}
+
+
+
+/**
+ * (Seed Searching) Performs a swap in a sequence of stepMasks. Goes through the sequence and whenever it sees a,
+ * it writes b and when it sees b it writes a.
+ * @param seq The sequence array.
+ * @param a The first stepMask to swap.
+ * @param b The other stepMask to swap.
+ * @param limit How many steps to look at. For normal sequences is len.
+*/
+static inline void swapMasks(stepMask *seq, stepMask a, stepMask b, int limit)
+{
+    #ifdef AVX2_KERNELS
+    swapMasksAVX2(seq, a, b, limit);
+    #else
+    swapMasksScalar(seq, a, b, limit);
+    #endif
+}
+
+
+
+/**
+ * This function returns true if the first argument, beingTested, is lower in terms
+ * of sequence number than the second argument, original. If they are equal, false
+ * is returned, as it is not strictly lower.
+ * @param beingTested The first sequence.
+ * @param original The second sequence.
+ * @return True if the first is lower than the second. If true, the second is not a seed.
+*/
+static inline bool isLower(const stepMask *beingTested, const stepMask *original)
+{
+    #ifdef AVX2_KERNELS
+    return isLowerAVX2(beingTested, original);
+    #else
+    return isLowerScalar(beingTested, original);
+    #endif
+}
+
+
+
+/**
+ * (Extrapolating) Relabels the digits of a sequence with a map from the PermutationTable.
+ * @param seq The sequence to relabel, len steps long.
+ * @param map The map, 16 bytes with map[d] being what digit d becomes.
+ * @param out Where the relabeled sequence is written, len steps long. Can't be seq.
+*/
+static inline void relabelSequence(const step *seq, const step *map, step *out)
+{
+    #ifdef AVX2_KERNELS
+    relabelSequenceAVX2(seq, map, out);
+    #else
+    relabelSequenceScalar(seq, map, out);
+    #endif
+}
@@ -0,0 +1,288 @@
+/**
+ * @file SequenceKeys.c
+ * @author Joey Hughes
+ * This is the code for the fixed width sequence keys from GreyCodeTypes.h. A key is a sequence of steps packed in at
+ * 3 bits per step, with the first step in the highest bits, so comparing keys as numbers is the same as comparing the
+ * sequences step by step. These replace the GMP sequenceNums in the extrapolation for up to 6 digits, since rotating,
+ * comparing, and hashing them are all just a few instructions on the stack instead of calls into GMP.
+ * Everything in here is only defined if FIXED_WIDTH_KEYS is.
+*/
+
+#include <stdbool.h>
+
+#ifndef GREY_CODE_TYPES_DEFINED
+    #include "GreyCodeTypes.h"
+#endif
+
+// This file gets included from a couple places, so only define everything once
+#ifndef SEQUENCE_KEYS_DEFINED
+#define SEQUENCE_KEYS_DEFINED 1
+
+#ifdef FIXED_WIDTH_KEYS
+
+/** The mask that takes a step out of the bottom of a key. */
+#define STEP_KEY_MASK ((1 << BITS_PER_STEP) - 1)
+
+
+#if NUM_DIGITS <= 5
+
+/** The mask of the bits of a 128 bit key that are actually used. */
+#define SEQUENCE_KEY_MASK ((((sequenceKey)1) << SEQUENCE_KEY_BITS) - 1)
+
+
+
+/**
+ * Packs the given sequence into a key.
+ * @param seq The sequence to pack, len steps long.
+ * @param key Where the key is written.
+*/
+static inline void getSequenceKey(const step *seq, sequenceKey *key)
+{
+    sequenceKey packed = 0;
+    for(int i = 0; i < len; i++)
+        packed = (packed << BITS_PER_STEP) | seq[i];
+    *key = packed;
+}
+
+
+
+/**
+ * Loads a packedSequence into a key. The packed bytes are the key's bits in order from the highest, so it's just
+ * reading them in as one big number.
+ * @param packed The packed sequence, PACKED_SEQUENCE_BYTES long.
+ * @param key Where the key is written.
+*/
+static inline void getPackedSequenceKey(const unsigned char *packed, sequenceKey *key)
+{
+    sequenceKey loaded = 0;
+    for(int i = 0; i < PACKED_SEQUENCE_BYTES; i++)
+        loaded = (loaded << 8) | packed[i];
+    *key = loaded;
+}
+
+
+
+/**
+ * Unpacks a key back into a sequence, from the last step to the first.
+ * @param key The key to unpack.
+ * @param seq Where the sequence is written, len steps long.
+*/
+static inline void unpackSequenceKey(sequenceKey key, step *seq)
+{
+    for(int i = len - 1; i >= 0; i--) {
+        seq[i] = (step)(key & STEP_KEY_MASK);
+        key >>= BITS_PER_STEP;
+    }
+}
+
+
+
+/**
+ * Rotates the key by one step, moving the first step to the end.
+ * @param key The key to rotate.
+*/
+static inline void rotateSequenceKey(sequenceKey *key)
+{
+    *key = ((*key << BITS_PER_STEP) | (*key >> (SEQUENCE_KEY_BITS - BITS_PER_STEP))) & SEQUENCE_KEY_MASK;
+}
+
+
+
+/**
+ * Checks if two keys are the same.
+ * @param a The first key.
+ * @param b The second key.
+ * @return True if they are equal.
+*/
+static inline bool sequenceKeysEqual(const sequenceKey a, const sequenceKey b)
+{
+    return a == b;
+}
+
+
+
+/**
+ * Returns true if the first key is lower than the second, which is the same as the first sequence being lower.
+ * @param a The first key.
+ * @param b The second key.
+ * @return True if a is strictly lower than b.
+*/
+static inline bool sequenceKeyIsLower(const sequenceKey a, const sequenceKey b)
+{
+    return a < b;
+}
+
+
+
+/**
+ * Turns the key into its least rotation, the lowest of all len of them, so every rotation of a sequence gets the same key.
+ * It's just going through all of them, but each one is a shift and a compare with no branches, which beats any of the
+ * clever ways of finding it on the steps.
+ * @param key The key to turn into its least rotation.
+*/
+static inline void getLeastRotationKey(sequenceKey *key)
+{
+    sequenceKey rotation = *key, least = *key;
+    for(int r = 1; r < len; r++) {
+        rotateSequenceKey(&rotation);
+        least = sequenceKeyIsLower(rotation, least) ? rotation : least;
+    }
+    *key = least;
+}
+
+
+
+/**
+ * Hashes a key down to 64 bits. The two halves are mixed together with a multiply so that every step ends up
+ * affecting the low bits, which are the ones the hash table uses.
+ * @param key The key to hash.
+ * @return The 64 bit hash.
+*/
+static inline unsigned long long hashSequenceKey(const sequenceKey key)
+{
+    unsigned long long hash = (unsigned long long)key ^ ((unsigned long long)(key >> 64) * 0x9E3779B97F4A7C15ULL);
+    hash ^= hash >> 29;
+    hash *= 0xBF58476D1CE4E5B9ULL;
+    return hash ^ (hash >> 32);
+}
+
+
+#else
+
+
+/**
+ * Packs the given sequence into a key.
+ * @param seq The sequence to pack, len steps long.
+ * @param key Where the key is written.
+*/
+static inline void getSequenceKey(const step *seq, sequenceKey *key)
+{
+    // 64 is not a multiple of 3, so the steps are packed across word boundaries
+    unsigned long long high = 0, middle = 0, low = 0;
+    for(int i = 0; i < len; i++) {
+        high = (high << BITS_PER_STEP) | (middle >> (64 - BITS_PER_STEP));
+        middle = (middle << BITS_PER_STEP) | (low >> (64 - BITS_PER_STEP));
+        low = (low << BITS_PER_STEP) | seq[i];
+    }
+    key->words[0] = high;
+    key->words[1] = middle;
+    key->words[2] = low;
+}
+
+
+
+/**
+ * Loads a packedSequence into a key. The packed bytes are the key's bits in order from the highest, so each word is
+ * just 8 of the bytes read in as a number.
+ * @param packed The packed sequence, PACKED_SEQUENCE_BYTES long.
+ * @param key Where the key is written.
+*/
+static inline void getPackedSequenceKey(const unsigned char *packed, sequenceKey *key)
+{
+    for(int w = 0; w < SEQUENCE_KEY_WORDS; w++) {
+        unsigned long long word = 0;
+        for(int i = 0; i < 8; i++)
+            word = (word << 8) | packed[(w * 8) + i];
+        key->words[w] = word;
+    }
+}
+
+
+
+/**
+ * Unpacks a key back into a sequence. 64 is not a multiple of 3, so every third step is split across two words.
+ * @param key The key to unpack.
+ * @param seq Where the sequence is written, len steps long.
+*/
+static inline void unpackSequenceKey(sequenceKey key, step *seq)
+{
+    unsigned long long high = key.words[0], middle = key.words[1], low = key.words[2];
+    for(int i = len - 1; i >= 0; i--) {
+        seq[i] = (step)(low & STEP_KEY_MASK);
+        low = (low >> BITS_PER_STEP) | (middle << (64 - BITS_PER_STEP));
+        middle = (middle >> BITS_PER_STEP) | (high << (64 - BITS_PER_STEP));
+        high >>= BITS_PER_STEP;
+    }
+}
+
+
+
+/**
+ * Rotates the key by one step, moving the first step to the end. All 192 bits are used, so there's no masking.
+ * @param key The key to rotate.
+*/
+static inline void rotateSequenceKey(sequenceKey *key)
+{
+    unsigned long long first = key->words[0] >> (64 - BITS_PER_STEP);
+    key->words[0] = (key->words[0] << BITS_PER_STEP) | (key->words[1] >> (64 - BITS_PER_STEP));
+    key->words[1] = (key->words[1] << BITS_PER_STEP) | (key->words[2] >> (64 - BITS_PER_STEP));
+    key->words[2] = (key->words[2] << BITS_PER_STEP) | first;
+}
+
+
+
+/**
+ * Checks if two keys are the same.
+ * @param a The first key.
+ * @param b The second key.
+ * @return True if they are equal.
+*/
+static inline bool sequenceKeysEqual(const sequenceKey a, const sequenceKey b)
+{
+    return ((a.words[0] ^ b.words[0]) | (a.words[1] ^ b.words[1]) | (a.words[2] ^ b.words[2])) == 0;
+}
+
+
+
+/**
+ * Returns true if the first key is lower than the second, which is the same as the first sequence being lower.
+ * @param a The first key.
+ * @param b The second key.
+ * @return True if a is strictly lower than b.
+*/
+static inline bool sequenceKeyIsLower(const sequenceKey a, const sequenceKey b)
+{
+    if(a.words[0] != b.words[0]) return a.words[0] < b.words[0];
+    if(a.words[1] != b.words[1]) return a.words[1] < b.words[1];
+    return a.words[2] < b.words[2];
+}
+
+
+
+/**
+ * Turns the key into its least rotation, the lowest of all len of them, so every rotation of a sequence gets the same key.
+ * It's just going through all of them, but each one is a shift and a compare with no branches, which beats any of the
+ * clever ways of finding it on the steps.
+ * @param key The key to turn into its least rotation.
+*/
+static inline void getLeastRotationKey(sequenceKey *key)
+{
+    sequenceKey rotation = *key, least = *key;
+    for(int r = 1; r < len; r++) {
+        rotateSequenceKey(&rotation);
+        least = sequenceKeyIsLower(rotation, least) ? rotation : least;
+    }
+    *key = least;
+}
+
+
+
+/**
+ * Hashes a key down to 64 bits. The words are mixed together with multiplies so that every step ends up
+ * affecting the low bits, which are the ones the hash table uses.
+ * @param key The key to hash.
+ * @return The 64 bit hash.
+*/
+static inline unsigned long long hashSequenceKey(const sequenceKey key)
+{
+    unsigned long long hash = key.words[2] ^ (key.words[1] * 0x9E3779B97F4A7C15ULL) ^ (key.words[0] * 0xC2B2AE3D27D4EB4FULL);
+    hash ^= hash >> 29;
+    hash *= 0xBF58476D1CE4E5B9ULL;
+    return hash ^ (hash >> 32);
+}
+
+#endif
+
+#endif
+
+#endif
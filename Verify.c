@@ -0,0 +1,255 @@
+/**
+ * @file Verify.c
+ * @author Joey Hughes
+ * This is the correctness check that GreyCodeChimera.c runs with --verify-extrapolation and --verify-search, for making
+ * sure a change to the search or extrapolation (the fixed width keys, stabilizer counting, the task depth, the AVX2
+ * kernels, and so on) still gets the right answer, seed by seed, and not just the right total by luck. Both check
+ * against a text file of every seed and its group size, like 5DigitSeedsAndTheirGroupSize.txt, read with
+ * readSeedTextFile in SeedStore.c. Like Benchmarks.c, it uses the real search and extrapolation, so it gets included
+ * into GreyCodeChimera.c right before main.
+ *   --verify-extrapolation PATH: reads the seeds in PATH into memory and extrapolates them like a seed file, all four
+ *     ways, hashing, hashing least rotations, stabilizer counting, and signature relabelings, with every extrapolation
+ *     thread writing down how many codes each seed made. Then each seed's codes are diffed against its group size in
+ *     the file. With --gpu, it's done on the GPU too.
+ *   --verify-search PATH: runs the search like normal, with every seed going into the --check-duplicates table, then
+ *     looks up every seed in PATH in the table. Any that aren't there are missing, and if the table has more seeds
+ *     than that, the rest are extra.
+ * Both also check the totals against the file, and against KNOWN_TOTAL_SEEDS and KNOWN_TOTAL_CODES if they're known for
+ * this many digits. If anything doesn't match, it says what and the program exits with a failure.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <pthread.h>
+
+
+/** How many seeds the total is known to be for NUM_DIGITS, and how many codes that makes, or 0 if they aren't known. */
+#if NUM_DIGITS == 4
+#define KNOWN_TOTAL_SEEDS 11ULL
+#define KNOWN_TOTAL_CODES 2688ULL
+#elif NUM_DIGITS == 5
+#define KNOWN_TOTAL_SEEDS 473037ULL
+#define KNOWN_TOTAL_CODES 1813091520ULL
+#else
+#define KNOWN_TOTAL_SEEDS 0ULL
+#define KNOWN_TOTAL_CODES 0ULL
+#endif
+
+/** How many of the seeds that don't match get printed out. The rest are just counted. */
+#define VERIFY_MISMATCHES_SHOWN 10
+
+
+
+/**
+ * (Verify) Prints a seed as its digits.
+ * @param seed The seed, packed.
+*/
+void printVerifySeed(const packedSequence seed)
+{
+    step seq[len];
+    unpackSequence(seed, seq);
+    for(int i = 0; i < len; i++)
+        printf("%d", seq[i]);
+}
+
+
+
+/**
+ * (Verify) Checks one total against what it should be, and says if it doesn't match.
+ * @param what What the total is of, for the message.
+ * @param total The total that was gotten.
+ * @param expected What it should be.
+ * @param source Where the expected total comes from, for the message.
+ * @return True if they match.
+*/
+bool checkVerifyTotal(const char *what, unsigned long long total, unsigned long long expected, const char *source)
+{
+    if(total == expected) {
+        printf(" ---- The number of %s, %llu, matches %s.\n", what, total, source);
+        return true;
+    }
+    printf(" ---- \e[31mThe number of %s was %llu, but %s says it should be %llu!\e[0m\n", what, total, source, expected);
+    return false;
+}
+
+
+
+/**
+ * (Verify) Extrapolates every seed in the text file one way, with numThreads threads taking them out of it like a seed
+ * file, and diffs how many codes each seed made against its group size.
+ * @param reference The seeds and group sizes.
+ * @param mode Which way to extrapolate.
+ * @param name The name of that way, for the messages.
+ * @param numThreads How many extrapolation threads to use.
+ * @param batchSize How many seeds each thread takes at a time.
+ * @param permutations The table of all n! relabelings.
+ * @param multiplesTable The multiples lookup table, if the extrapolation uses GMP.
+ * @param gpu The GpuExtrapolator, if extrapolating on the GPU.
+ * @param numGreyCodes Where the total number of codes goes.
+ * @return How many seeds made a different number of codes than their group size.
+*/
+unsigned long long verifyExtrapolationMode(const SeedTextFile *reference, ExtrapolationMode mode, const char *name, int numThreads,
+                                           int batchSize, const PermutationTable *permutations, void *multiplesTable,
+                                           void *gpu, unsigned long long *numGreyCodes)
+{
+    unsigned long long *seedCodes = (unsigned long long *)calloc(reference->file.count, sizeof(unsigned long long));
+    pthread_t *threadIds = (pthread_t *)malloc(sizeof(pthread_t) * numThreads);
+    ExtrapolateThreadStruct *threads = (ExtrapolateThreadStruct *)calloc(numThreads, sizeof(ExtrapolateThreadStruct));
+
+    // The seeds all come out of the file, so the queue is closed right away
+    SeedQueue *seedQueue = createSeedQueue(1);
+    closeSeedQueue(seedQueue);
+    uint64_t fileCursor = 0;
+    double startSeconds = getWallSeconds();
+    for(int i = 0; i < numThreads; i++) {
+        threads[i].mode = mode;
+        threads[i].seedQueue = seedQueue;
+        threads[i].seedFile = &(reference->file);
+        threads[i].fileCursor = &fileCursor;
+        threads[i].fileBatchSize = batchSize;
+        threads[i].seedCodes = seedCodes;
+        threads[i].permutations = permutations;
+        threads[i].quiet = true;
+        #ifndef FIXED_WIDTH_KEYS
+        threads[i].multiplesTablePointer = (mpz_t *)multiplesTable;
+        #endif
+        #ifdef GPU_EXTRAPOLATION
+        threads[i].gpu = (const GpuExtrapolator *)gpu;
+        #endif
+        pthread_create(threadIds + i, NULL, &extrapolateSeeds, (void *)(threads + i));
+    }
+    *numGreyCodes = 0;
+    for(int i = 0; i < numThreads; i++) {
+        pthread_join(threadIds[i], NULL);
+        *numGreyCodes += threads[i].numGreyCodes;
+    }
+    printf(" ------- Extrapolated %llu seeds by %s in %f seconds.\n", (unsigned long long)reference->file.count, name,
+        getWallSeconds() - startSeconds);
+
+    // Diff every seed's codes against its group size
+    unsigned long long mismatches = 0;
+    for(uint64_t i = 0; i < reference->file.count; i++) {
+        if(seedCodes[i] == reference->groupSizes[i]) continue;
+        if(mismatches++ < VERIFY_MISMATCHES_SHOWN) {
+            printf(" ---- \e[31mSeed %llu, ", (unsigned long long)i + 1);
+            printVerifySeed(reference->file.seeds[i]);
+            printf(", made %llu codes, but its group size is %llu!\e[0m\n", seedCodes[i], reference->groupSizes[i]);
+        }
+    }
+    if(mismatches > VERIFY_MISMATCHES_SHOWN)
+        printf(" ---- \e[31m...and %llu more.\e[0m\n", mismatches - VERIFY_MISMATCHES_SHOWN);
+    if(mismatches == 0)
+        printf(" ---- Every seed made as many codes as its group size.\n");
+
+    freeSeedQueue(seedQueue);
+    free(threads);
+    free(threadIds);
+    free(seedCodes);
+    return mismatches;
+}
+
+
+
+/**
+ * (Verify) Runs --verify-extrapolation. Reads the seeds and group sizes, extrapolates them all four ways (and on the
+ * GPU, if there is one), and checks every seed and the totals.
+ * @param path The text file of seeds and their group sizes.
+ * @param numThreads How many extrapolation threads to use.
+ * @param batchSize How many seeds each thread takes at a time.
+ * @param permutations The table of all n! relabelings.
+ * @param multiplesTable The multiples lookup table, if the extrapolation uses GMP.
+ * @param gpu The GpuExtrapolator to check too, or NULL if not using the GPU.
+ * @return True if everything matched.
+*/
+bool verifyExtrapolation(const char *path, int numThreads, int batchSize, const PermutationTable *permutations, void *multiplesTable,
+                         void *gpu)
+{
+    SeedTextFile reference;
+    if(!readSeedTextFile(path, 0, &reference)) return false;
+    printf(" ------- Verifying the extrapolation of the %llu seeds in %s with %d threads...\n\n",
+        (unsigned long long)reference.file.count, path, numThreads);
+
+    // Only if the file is every seed can its totals be checked against the known ones
+    bool whole = KNOWN_TOTAL_SEEDS != 0 && reference.file.count == KNOWN_TOTAL_SEEDS;
+    bool ok = true;
+    if(whole)
+        ok &= checkVerifyTotal("codes in the file's group sizes", reference.totalCodes, KNOWN_TOTAL_CODES, "the known total");
+    else
+        printf(" ---- The file isn't every seed for %d digits, so it's only checked against itself.\n", NUM_DIGITS);
+
+    ExtrapolationMode modes[5] = {EXTRAPOLATE_HASHING, EXTRAPOLATE_CANONICAL, EXTRAPOLATE_STABILIZER, EXTRAPOLATE_SIGNATURE};
+    const char *names[5] = {"hashing", "hashing least rotations", "stabilizer counting", "signature relabelings", "the GPU"};
+    int numModes = 4;
+    #ifdef GPU_EXTRAPOLATION
+    if(gpu != NULL) modes[numModes++] = EXTRAPOLATE_GPU;
+    #endif
+    for(int m = 0; m < numModes; m++) {
+        unsigned long long numGreyCodes;
+        printf("\n");
+        ok &= verifyExtrapolationMode(&reference, modes[m], names[m], numThreads, batchSize, permutations, multiplesTable,
+                                      gpu, &numGreyCodes) == 0;
+        ok &= checkVerifyTotal("codes", numGreyCodes, reference.totalCodes, "the file");
+        if(whole) ok &= checkVerifyTotal("codes", numGreyCodes, KNOWN_TOTAL_CODES, "the known total");
+    }
+
+    printf(ok ? "\n ---------- The extrapolation matches %s.\n" : "\n ---------- \e[31mThe extrapolation doesn't match %s!\e[0m\n", path);
+    freeSeedTextFile(&reference);
+    return ok;
+}
+
+
+
+/**
+ * (Verify) Checks the seeds a search found, in the table from --check-duplicates, against the text file for
+ * --verify-search. Every seed in the file has to be in the table, and the table can't have any more than that.
+ * The table doesn't keep which seeds are which, so the extra ones can only be counted.
+ * @param reference The seeds and group sizes.
+ * @param path Where they came from, for the messages.
+ * @param seenSeeds The table of every seed the search found.
+ * @return True if the seeds are the same.
+*/
+bool verifySearchSeeds(const SeedTextFile *reference, const char *path, SeqHashTable *seenSeeds)
+{
+    unsigned long long missing = 0;
+    for(uint64_t i = 0; i < reference->file.count; i++) {
+        if(seqHashContains(seenSeeds, reference->file.seeds[i])) continue;
+        if(missing++ < VERIFY_MISMATCHES_SHOWN) {
+            printf(" ---- \e[31mSeed %llu in %s, ", (unsigned long long)i + 1, path);
+            printVerifySeed(reference->file.seeds[i]);
+            printf(", wasn't found by the search!\e[0m\n");
+        }
+    }
+    if(missing > VERIFY_MISMATCHES_SHOWN)
+        printf(" ---- \e[31m...and %llu more weren't found.\e[0m\n", missing - VERIFY_MISMATCHES_SHOWN);
+
+    unsigned long long extra = getSeqTableCount(seenSeeds) - (reference->file.count - missing);
+    if(extra)
+        printf(" ---- \e[31mThe search found %llu seeds that aren't in %s!\e[0m\n", extra, path);
+    if(missing == 0 && extra == 0)
+        printf(" ---- The search found every seed in %s, and no others.\n", path);
+    return missing == 0 && extra == 0;
+}
+
+
+
+/**
+ * (Verify) Checks the totals of a search for --verify-search against the text file, and the known totals if there are
+ * any for this many digits.
+ * @param reference The seeds and group sizes.
+ * @param numSeeds How many seeds the search found.
+ * @param extrapolated Whether the seeds were extrapolated, so there's a number of codes to check.
+ * @param numGreyCodes How many codes they made.
+ * @return True if the totals match.
+*/
+bool verifySearchTotals(const SeedTextFile *reference, unsigned long long numSeeds, bool extrapolated, unsigned long long numGreyCodes)
+{
+    bool ok = checkVerifyTotal("seeds", numSeeds, reference->file.count, "the file");
+    if(extrapolated) ok &= checkVerifyTotal("codes", numGreyCodes, reference->totalCodes, "the file");
+    if(KNOWN_TOTAL_SEEDS != 0) {
+        ok &= checkVerifyTotal("seeds", numSeeds, KNOWN_TOTAL_SEEDS, "the known total");
+        if(extrapolated) ok &= checkVerifyTotal("codes", numGreyCodes, KNOWN_TOTAL_CODES, "the known total");
+    }
+    return ok;
+}
@@ -0,0 +1,207 @@
+/**
+ * @file WorkStealingPool.c
+ * @author Joey Hughes
+ * This is a small work-stealing thread pool for the GreyCodeChimera.c program. The tasks are just indices into
+ * an array owned by whoever made the pool, and each worker gets its own deque of them. A worker pops from the back
+ * of its own deque, and once that is empty it goes around the other workers and steals from the front of theirs.
+ * No new tasks are made while the pool is running, so once a worker finds every deque empty it is done.
+*/
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+
+/** One worker's deque of task indices. The owner works from the tail and thieves take from the head. */
+typedef struct {
+    /** Lock for the head and tail. Only held for a couple of instructions, so contention is tiny. */
+    pthread_mutex_t lock;
+    /** The array of task indices. */
+    size_t *tasks;
+    /** The index of the first task that has not been taken yet. Thieves take from here. */
+    size_t head;
+    /** The index just after the last task that has not been taken yet. The owner pushes and pops here. */
+    size_t tail;
+} TaskDeque;
+
+/** Forward declaration so the worker arguments can point back to their pool. */
+typedef struct WorkStealingPoolStruct WorkStealingPool;
+
+/** The struct passed into each worker thread. */
+typedef struct {
+    /** The pool this worker belongs to. */
+    WorkStealingPool *pool;
+    /** Which worker this is, also the index of its deque. */
+    int workerIndex;
+} PoolWorkerArg;
+
+/** Struct for a whole pool. */
+struct WorkStealingPoolStruct {
+    /** How many worker threads there are. */
+    int numWorkers;
+    /** One deque per worker. */
+    TaskDeque *deques;
+    /** The function that is called for each task. Gets the worker index, the task index, and the context pointer. */
+    void (*runTask)(int, size_t, void *);
+    /** Passed through to runTask untouched. */
+    void *context;
+    /** Called once by every worker when it starts, before any tasks, with the worker index and the context. NULL for
+     * nothing. Set it after creating the pool. */
+    void (*startWorker)(int, void *);
+    /** The ids of the worker threads. */
+    pthread_t *threadIds;
+    /** The arguments passed to each worker thread. */
+    PoolWorkerArg *workerArgs;
+};
+
+
+
+/**
+ * Creates a pool and deals out the task indices 0 to numTasks - 1 round robin to the workers. Doesn't start any threads.
+ * @param numWorkers How many worker threads the pool will run.
+ * @param numTasks How many tasks there are.
+ * @param runTask The function called for every task.
+ * @param context Pointer passed into every call of runTask.
+ * @return Pointer to the new pool.
+*/
+WorkStealingPool *createWorkStealingPool(int numWorkers, size_t numTasks, void (*runTask)(int, size_t, void *), void *context)
+{
+    WorkStealingPool *pool = (WorkStealingPool *)malloc(sizeof(WorkStealingPool));
+    pool->numWorkers = numWorkers;
+    pool->runTask = runTask;
+    pool->context = context;
+    pool->startWorker = NULL;
+    pool->deques = (TaskDeque *)calloc(numWorkers, sizeof(TaskDeque));
+    pool->threadIds = (pthread_t *)malloc(sizeof(pthread_t) * numWorkers);
+    pool->workerArgs = (PoolWorkerArg *)malloc(sizeof(PoolWorkerArg) * numWorkers);
+
+    // Every deque can hold its share of the tasks, rounded up
+    size_t perWorker = (numTasks / numWorkers) + 1;
+    for(int i = 0; i < numWorkers; i++) {
+        pthread_mutex_init(&(pool->deques[i].lock), NULL);
+        pool->deques[i].tasks = (size_t *)malloc(sizeof(size_t) * perWorker);
+        pool->workerArgs[i] = (PoolWorkerArg){pool, i};
+    }
+
+    // Deal out the tasks so every worker gets a mix of the early (big) and late (small) ones
+    for(size_t t = 0; t < numTasks; t++) {
+        TaskDeque *deque = pool->deques + (t % numWorkers);
+        deque->tasks[deque->tail++] = t;
+    }
+    return pool;
+}
+
+
+
+/**
+ * Pops a task from the tail of the worker's own deque.
+ * @param deque The worker's deque.
+ * @param taskIndex Where the popped task index is written.
+ * @return True if a task was popped, false if the deque was empty.
+*/
+static bool popOwnTask(TaskDeque *deque, size_t *taskIndex)
+{
+    bool found = false;
+    pthread_mutex_lock(&(deque->lock));
+    if(deque->head < deque->tail) {
+        *taskIndex = deque->tasks[--(deque->tail)];
+        found = true;
+    }
+    pthread_mutex_unlock(&(deque->lock));
+    return found;
+}
+
+
+
+/**
+ * Steals a task from the head of another worker's deque.
+ * @param deque The victim's deque.
+ * @param taskIndex Where the stolen task index is written.
+ * @return True if a task was stolen, false if the deque was empty.
+*/
+static bool stealTask(TaskDeque *deque, size_t *taskIndex)
+{
+    bool found = false;
+    pthread_mutex_lock(&(deque->lock));
+    if(deque->head < deque->tail) {
+        *taskIndex = deque->tasks[(deque->head)++];
+        found = true;
+    }
+    pthread_mutex_unlock(&(deque->lock));
+    return found;
+}
+
+
+
+/**
+ * The thread function for every worker. Runs its own tasks, then steals until there is nothing left anywhere.
+ * @param workerArg The PoolWorkerArg for this worker.
+ * @return Nothing, but a void * return type is necessary to make the thread.
+*/
+static void *workStealingWorker(void *workerArg)
+{
+    PoolWorkerArg *arg = (PoolWorkerArg *)workerArg;
+    WorkStealingPool *pool = arg->pool;
+    size_t taskIndex;
+
+    if(pool->startWorker != NULL) pool->startWorker(arg->workerIndex, pool->context);
+
+    while(true) {
+        // Our own work first
+        if(popOwnTask(pool->deques + arg->workerIndex, &taskIndex)) {
+            pool->runTask(arg->workerIndex, taskIndex, pool->context);
+            continue;
+        }
+
+        // Go around everyone else, starting with our neighbor so the thieves spread out
+        bool stole = false;
+        for(int i = 1; i < pool->numWorkers && !stole; i++)
+            stole = stealTask(pool->deques + ((arg->workerIndex + i) % pool->numWorkers), &taskIndex);
+        if(!stole) break;
+        pool->runTask(arg->workerIndex, taskIndex, pool->context);
+    }
+
+    return NULL;
+}
+
+
+
+/**
+ * Starts all the worker threads of the pool.
+ * @param pool The pool to start.
+*/
+void startWorkStealingPool(WorkStealingPool *pool)
+{
+    for(int i = 0; i < pool->numWorkers; i++)
+        pthread_create(pool->threadIds + i, NULL, &workStealingWorker, (void *)(pool->workerArgs + i));
+}
+
+
+
+/**
+ * Waits for every worker of the pool to run out of tasks.
+ * @param pool The pool to wait on.
+*/
+void joinWorkStealingPool(WorkStealingPool *pool)
+{
+    for(int i = 0; i < pool->numWorkers; i++)
+        pthread_join(pool->threadIds[i], NULL);
+}
+
+
+
+/**
+ * Frees the pool. The workers should have been joined first.
+ * @param pool The pool to free.
+*/
+void freeWorkStealingPool(WorkStealingPool *pool)
+{
+    for(int i = 0; i < pool->numWorkers; i++) {
+        pthread_mutex_destroy(&(pool->deques[i].lock));
+        free(pool->deques[i].tasks);
+    }
+    free(pool->deques);
+    free(pool->threadIds);
+    free(pool->workerArgs);
+    free(pool);
+}